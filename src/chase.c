@@ -39,7 +39,7 @@ void TraceLine(vec3_t start, vec3_t end, vec3_t impact) {
     trace_t trace;
 
     memset (&trace, 0, sizeof(trace));
-    SV_RecursiveHullCheck(cl.worldmodel->hulls, 0, 0, 1, start, end, &trace);
+    SV_HullCheck(cl.worldmodel->hulls, 0, 0, 1, start, end, &trace);
 
     VectorCopy (trace.endpos, impact);
 }
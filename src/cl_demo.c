@@ -247,6 +247,7 @@ void CL_Record_f(void) {
         Con_Printf("ERROR: couldn't open.\n");
         return;
     }
+    COM_FlushMissingFiles();
 
     cls.forcetrack = track;
     fprintf(cls.demofile, "%i\n", cls.forcetrack);
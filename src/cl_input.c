@@ -410,6 +410,14 @@ void CL_SendMove(usercmd_t *cmd) {
     MSG_WriteByte(&buf, in_impulse);
     in_impulse = 0;
 
+//
+// let the server delta against the last snapshot we have in full
+//
+    if(cl.snapshotack >= 0) {
+        MSG_WriteByte(&buf, clc_snapshotack);
+        MSG_WriteByte(&buf, cl.snapshotack);
+    }
+
 //
 // deliver the message
 //
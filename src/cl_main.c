@@ -38,6 +38,7 @@ cvar_t cl_color = { "_cl_color", "0", true };
 
 cvar_t cl_shownet = { "cl_shownet", "0" };    // can be 0, 1, or 2
 cvar_t cl_nolerp = { "cl_nolerp", "0" };
+cvar_t cl_deltasnapshots = { "cl_deltasnapshots", "1" };
 
 cvar_t lookspring = { "lookspring", "0", true };
 cvar_t lookstrafe = { "lookstrafe", "0", true };
@@ -56,6 +57,7 @@ entity_t cl_entities[MAX_EDICTS];
 entity_t cl_static_entities[MAX_STATIC_ENTITIES];
 lightstyle_t cl_lightstyle[MAX_LIGHTSTYLES];
 dlight_t cl_dlights[MAX_DLIGHTS];
+deltaframe_t cl_snapshots[SNAPSHOT_FRAMES];
 
 int cl_numvisedicts;
 entity_t *cl_visedicts[MAX_VISEDICTS];
@@ -85,6 +87,9 @@ void CL_ClearState(void) {
     memset (cl_lightstyle, 0, sizeof(cl_lightstyle));
     memset (cl_temp_entities, 0, sizeof(cl_temp_entities));
     memset (cl_beams, 0, sizeof(cl_beams));
+    memset (cl_snapshots, 0, sizeof(cl_snapshots));
+
+    cl.snapshotack = -1;
 
 //
 // allocate the efrags and chain together into a free list
@@ -188,6 +193,12 @@ void CL_SignonReply(void) {
         case 1:
             MSG_WriteByte(&cls.message, clc_stringcmd);
             MSG_WriteString(&cls.message, "prespawn");
+
+            // servers that don't know it ignore it
+            if(cl_deltasnapshots.value) {
+                MSG_WriteByte(&cls.message, clc_stringcmd);
+                MSG_WriteString(&cls.message, "delta");
+            }
             break;
 
         case 2:
@@ -533,6 +544,8 @@ Read all incoming data from the server
 int CL_ReadFromServer(void) {
     int ret;
 
+    Prof_Begin(PROF_CLIENTREAD);
+
     cl.oldtime = cl.time;
     cl.time += host_frametime;
 
@@ -559,6 +572,7 @@ int CL_ReadFromServer(void) {
 //
 // bring the links up to date
 //
+    Prof_End(PROF_CLIENTREAD);
     return 0;
 }
 
@@ -632,6 +646,7 @@ void CL_Init(void) {
     Cvar_RegisterVariable(&cl_anglespeedkey);
     Cvar_RegisterVariable(&cl_shownet);
     Cvar_RegisterVariable(&cl_nolerp);
+    Cvar_RegisterVariable(&cl_deltasnapshots);
     Cvar_RegisterVariable(&lookspring);
     Cvar_RegisterVariable(&lookstrafe);
     Cvar_RegisterVariable(&sensitivity);
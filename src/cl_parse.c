@@ -73,9 +73,15 @@ char *svc_strings[] = {
         "svc_finale",       // [string] music [string] text
         "svc_cdtrack",      // [byte] track [byte] looptrack
         "svc_sellscreen",
-        "svc_cutscene"
+        "svc_cutscene",
+        "svc_snapshot"      // [byte] sequence [byte] base
 };
 
+// the delta snapshot being parsed, see CL_ParseSnapshot
+static deltaframe_t *cl_snapshot;        // NULL outside of one
+static deltaframe_t *cl_snapshotbase;    // NULL to go against the baselines
+static int cl_snapshotcursor;            // in cl_snapshotbase
+
 //=============================================================================
 
 /*
@@ -315,6 +321,52 @@ void CL_ParseServerInfo(void) {
     noclip_anglehack = false;        // noclip is turned off at start
 }
 
+/*
+==================
+CL_ParseSnapshot
+
+The entity updates that follow in the message only carry what changed since
+the base snapshot.  If the base is gone the missing values come from the
+baselines and the snapshot isn't acknowledged, so the server keeps going
+against an older one until it gives up and uses the baselines too.
+==================
+*/
+void CL_ParseSnapshot(void) {
+    int sequence, base;
+    deltaframe_t *frame;
+
+    sequence = MSG_ReadByte();
+    base = MSG_ReadByte();
+
+    cl_snapshot = &cl_snapshots[sequence & (SNAPSHOT_FRAMES - 1)];
+    cl_snapshot->sequence = sequence;
+    cl_snapshot->valid = true;
+    cl_snapshot->numentities = 0;
+    cl_snapshotbase = NULL;
+    cl_snapshotcursor = 0;
+
+    if(base != sequence) {
+        frame = &cl_snapshots[base & (SNAPSHOT_FRAMES - 1)];
+        if(frame->valid && frame->sequence == base) {
+            cl_snapshotbase = frame;
+        } else {
+            cl_snapshot->valid = false;
+        }
+    }
+}
+
+/*
+==================
+CL_FinishSnapshot
+==================
+*/
+void CL_FinishSnapshot(void) {
+    if(cl_snapshot && cl_snapshot->valid) {
+        cl.snapshotack = cl_snapshot->sequence;
+    }
+    cl_snapshot = NULL;
+}
+
 /*
 ==================
 CL_ParseUpdate
@@ -330,6 +382,8 @@ void CL_ParseUpdate(int bits) {
     int i;
     model_t *model;
     int modnum;
+    int colormap;
+    entity_state_t *from, *to;
     qboolean forcelink;
     entity_t *ent;
     int num;
@@ -361,6 +415,29 @@ void CL_ParseUpdate(int bits) {
         }
     }
 
+// in a delta snapshot what isn't sent is what the base had
+    from = &ent->baseline;
+    to = NULL;
+    if(cl_snapshot) {
+        if(cl_snapshotbase) {
+            while(cl_snapshotcursor < cl_snapshotbase->numentities &&
+                  cl_snapshotbase->entnums[cl_snapshotcursor] < num) {
+                cl_snapshotcursor++;
+            }
+            if(cl_snapshotcursor < cl_snapshotbase->numentities &&
+               cl_snapshotbase->entnums[cl_snapshotcursor] == num) {
+                from = &cl_snapshotbase->entities[cl_snapshotcursor];
+            }
+        }
+
+        if(cl_snapshot->numentities < MAX_SNAPSHOT_ENTITIES) {
+            cl_snapshot->entnums[cl_snapshot->numentities] = num;
+            to = &cl_snapshot->entities[cl_snapshot->numentities++];
+        } else {
+            cl_snapshot->valid = false;
+        }
+    }
+
     if(ent->msgtime != cl.mtime[1]) {
         forcelink = true;    // no previous frame to lerp from
     } else {
@@ -375,7 +452,7 @@ void CL_ParseUpdate(int bits) {
             Host_Error("CL_ParseModel: bad modnum");
         }
     } else {
-        modnum = ent->baseline.modelindex;
+        modnum = from->modelindex;
     }
 
     model = cl.model_precache[modnum];
@@ -402,28 +479,28 @@ void CL_ParseUpdate(int bits) {
     if(bits & U_FRAME) {
         ent->frame = MSG_ReadByte();
     } else {
-        ent->frame = ent->baseline.frame;
+        ent->frame = from->frame;
     }
 
     if(bits & U_COLORMAP) {
-        i = MSG_ReadByte();
+        colormap = MSG_ReadByte();
     } else {
-        i = ent->baseline.colormap;
+        colormap = from->colormap;
     }
-    if(!i) {
+    if(!colormap) {
         ent->colormap = vid.colormap;
     } else {
-        if(i > cl.maxclients) {
+        if(colormap > cl.maxclients) {
             Sys_Error("i >= cl.maxclients");
         }
-        ent->colormap = cl.scores[i - 1].translations;
+        ent->colormap = cl.scores[colormap - 1].translations;
     }
 
 #ifdef RENDER_GL
     if (bits & U_SKIN)
         skin = MSG_ReadByte();
     else
-        skin = ent->baseline.skin;
+        skin = from->skin;
     if (skin != ent->skinnum) {
         ent->skinnum = skin;
         if (num > 0 && num <= cl.maxclients)
@@ -433,14 +510,14 @@ void CL_ParseUpdate(int bits) {
     if(bits & U_SKIN) {
         ent->skinnum = MSG_ReadByte();
     } else {
-        ent->skinnum = ent->baseline.skin;
+        ent->skinnum = from->skin;
     }
 #endif // RENDER_GL
 
     if(bits & U_EFFECTS) {
         ent->effects = MSG_ReadByte();
     } else {
-        ent->effects = ent->baseline.effects;
+        ent->effects = from->effects;
     }
 
 // shift the known values for interpolation
@@ -450,34 +527,44 @@ void CL_ParseUpdate(int bits) {
     if(bits & U_ORIGIN1) {
         ent->msg_origins[0][0] = MSG_ReadCoord();
     } else {
-        ent->msg_origins[0][0] = ent->baseline.origin[0];
+        ent->msg_origins[0][0] = from->origin[0];
     }
     if(bits & U_ANGLE1) {
         ent->msg_angles[0][0] = MSG_ReadAngle();
     } else {
-        ent->msg_angles[0][0] = ent->baseline.angles[0];
+        ent->msg_angles[0][0] = from->angles[0];
     }
 
     if(bits & U_ORIGIN2) {
         ent->msg_origins[0][1] = MSG_ReadCoord();
     } else {
-        ent->msg_origins[0][1] = ent->baseline.origin[1];
+        ent->msg_origins[0][1] = from->origin[1];
     }
     if(bits & U_ANGLE2) {
         ent->msg_angles[0][1] = MSG_ReadAngle();
     } else {
-        ent->msg_angles[0][1] = ent->baseline.angles[1];
+        ent->msg_angles[0][1] = from->angles[1];
     }
 
     if(bits & U_ORIGIN3) {
         ent->msg_origins[0][2] = MSG_ReadCoord();
     } else {
-        ent->msg_origins[0][2] = ent->baseline.origin[2];
+        ent->msg_origins[0][2] = from->origin[2];
     }
     if(bits & U_ANGLE3) {
         ent->msg_angles[0][2] = MSG_ReadAngle();
     } else {
-        ent->msg_angles[0][2] = ent->baseline.angles[2];
+        ent->msg_angles[0][2] = from->angles[2];
+    }
+
+    if(to) {
+        to->modelindex = modnum;
+        to->frame = ent->frame;
+        to->colormap = colormap;
+        to->skin = ent->skinnum;
+        to->effects = ent->effects;
+        VectorCopy (ent->msg_origins[0], to->origin);
+        VectorCopy (ent->msg_angles[0], to->angles);
     }
 
     if(bits & U_NOLERP) {
@@ -735,6 +822,7 @@ void CL_ParseServerMessage(void) {
     }
 
     cl.onground = false;    // unless the server says otherwise
+    cl_snapshot = NULL;
 //
 // parse the message
 //
@@ -749,6 +837,7 @@ void CL_ParseServerMessage(void) {
 
         if(cmd == -1) {
             SHOWNET("END OF MESSAGE");
+            CL_FinishSnapshot();
             return;        // end of message
         }
 
@@ -957,6 +1046,10 @@ void CL_ParseServerMessage(void) {
             case svc_sellscreen:
                 Cmd_ExecuteString("help", src_command);
                 break;
+
+            case svc_snapshot:
+                CL_ParseSnapshot();
+                break;
         }
     }
 }
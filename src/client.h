@@ -218,8 +218,19 @@ typedef struct {
 
 // frag scoreboard
     scoreboard_t *scores;        // [cl.maxclients]
+
+    int snapshotack;    // last delta snapshot decoded in full, -1 if none
 } client_state_t;
 
+// a delta snapshot as it was decoded, see CL_ParseSnapshot
+typedef struct {
+    int sequence;
+    qboolean valid;        // its base was known, so it can be a base itself
+    int numentities;
+    int entnums[MAX_SNAPSHOT_ENTITIES];
+    entity_state_t entities[MAX_SNAPSHOT_ENTITIES];
+} deltaframe_t;
+
 //
 // cvars
 //
@@ -242,6 +253,7 @@ extern cvar_t cl_autofire;
 
 extern cvar_t cl_shownet;
 extern cvar_t cl_nolerp;
+extern cvar_t cl_deltasnapshots;
 
 extern cvar_t cl_pitchdriftspeed;
 extern cvar_t lookspring;
@@ -266,5 +278,6 @@ extern lightstyle_t cl_lightstyle[MAX_LIGHTSTYLES];
 extern dlight_t cl_dlights[MAX_DLIGHTS];
 extern entity_t cl_temp_entities[MAX_TEMP_ENTITIES];
 extern beam_t cl_beams[MAX_BEAMS];
+extern deltaframe_t cl_snapshots[SNAPSHOT_FRAMES];
 
 #endif // !CLIENT_H
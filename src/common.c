@@ -273,6 +273,25 @@ int Q_strcasecmp(char *s1, char *s2) {
     return Q_strncasecmp(s1, s2, 99999);
 }
 
+/*
+============
+COM_HashString
+
+FNV-1a over a null-terminated string. Callers mask the result down to their
+own table size.
+============
+*/
+unsigned int COM_HashString(char *str) {
+    unsigned int hash = 2166136261u;
+
+    while(*str) {
+        hash ^= (byte)*str++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
 int Q_atoi(char *str) {
     int val;
     int sign;
@@ -945,6 +964,7 @@ void COM_CheckRegistered(void) {
 
     COM_OpenFile("gfx/pop.lmp", &h);
     static_registered = 0;
+    COM_FlushMissingFiles();      // registration changes what the directory search can see
 
     if(h == -1) {
 #if WINDED
@@ -1116,9 +1136,12 @@ int com_filesize;
 // in memory
 //
 
+#define PACK_HASH_SIZE          1024    // must be a power of two
+
 typedef struct {
     char name[MAX_QPATH];
     int filepos, filelen;
+    int hashnext;           // next file in the same bucket, or -1
 } packfile_t;
 
 typedef struct pack_s {
@@ -1126,6 +1149,9 @@ typedef struct pack_s {
     int handle;
     int numfiles;
     packfile_t *files;
+    byte *mapped;           // the whole pak, or NULL if it couldn't be mapped
+    int mappedsize;
+    int hashtable[PACK_HASH_SIZE];      // first file in each bucket, or -1
 } pack_t;
 
 //
@@ -1155,6 +1181,62 @@ typedef struct searchpath_s {
 
 searchpath_t *com_searchpaths;
 
+// set by COM_FindFile when the file it found lives in a pak
+static pack_t *com_foundpack;
+static packfile_t *com_foundfile;
+
+//
+// names that weren't found anywhere on the search path, so repeated lookups
+// for optional files don't have to walk every pak and stat the disk again
+//
+#define MISSING_CACHE_SIZE      256     // must be a power of two
+
+static char com_missingfiles[MISSING_CACHE_SIZE][MAX_QPATH];
+
+/*
+============
+COM_FlushMissingFiles
+
+Must be called whenever something could make a missing file appear: the
+engine writing into the gamedir, and every command line the user enters,
+since files may have been copied in from outside
+============
+*/
+void COM_FlushMissingFiles(void) {
+    memset(com_missingfiles, 0, sizeof(com_missingfiles));
+}
+
+static qboolean COM_IsMissingFile(char *filename, unsigned int hash) {
+    return !strcmp(com_missingfiles[hash & (MISSING_CACHE_SIZE - 1)], filename);
+}
+
+static void COM_AddMissingFile(char *filename, unsigned int hash) {
+    if(strlen(filename) >= MAX_QPATH) {
+        return;
+    }
+
+    strcpy(com_missingfiles[hash & (MISSING_CACHE_SIZE - 1)], filename);
+}
+
+/*
+============
+COM_FindPackFile
+
+Returns the index of filename in the pack, or -1
+============
+*/
+static int COM_FindPackFile(pack_t *pak, char *filename, unsigned int hash) {
+    int i;
+
+    for(i = pak->hashtable[hash & (PACK_HASH_SIZE - 1)]; i != -1; i = pak->files[i].hashnext) {
+        if(!strcmp(pak->files[i].name, filename)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
 /*
 ============
 COM_Path_f
@@ -1200,6 +1282,8 @@ void COM_WriteFile(char *filename, void *data, int len) {
     Sys_Printf("COM_WriteFile: %s\n", name);
     Sys_FileWrite(handle, data, len);
     Sys_FileClose(handle);
+
+    COM_FlushMissingFiles();
 }
 
 /*
@@ -1268,6 +1352,7 @@ int COM_FindFile(char *filename, int *handle, FILE **file) {
     pack_t *pak;
     int i;
     int findtime, cachetime;
+    unsigned int hash;
 
     if(file && handle) {
         Sys_Error("COM_FindFile: both handle and file set");
@@ -1276,6 +1361,15 @@ int COM_FindFile(char *filename, int *handle, FILE **file) {
         Sys_Error("COM_FindFile: neither handle or file set");
     }
 
+    com_foundpack = NULL;
+    com_foundfile = NULL;
+
+    hash = COM_HashString(filename);
+
+    if(COM_IsMissingFile(filename, hash)) {
+        goto notfound;
+    }
+
 //
 // search through the path, one element at a time
 //
@@ -1283,23 +1377,26 @@ int COM_FindFile(char *filename, int *handle, FILE **file) {
     for(; search; search = search->next) {
         // is the element a pak file?
         if(search->pack) {
-            // look through all the pak file elements
+            // look the name up in the pak's directory
             pak = search->pack;
-            for(i = 0; i < pak->numfiles; i++) {
-                if(!strcmp(pak->files[i].name, filename)) {       // found it!
+            i = COM_FindPackFile(pak, filename, hash);
+            if(i != -1) {       // found it!
+                if(developer.value) {
                     Sys_Printf("PackFile: %s : %s\n", pak->filename, filename);
-                    if(handle) {
-                        *handle = pak->handle;
-                        Sys_FileSeek(pak->handle, pak->files[i].filepos);
-                    } else {       // open a new file on the pakfile
-                        *file = fopen(pak->filename, "rb");
-                        if(*file) {
-                            fseek(*file, pak->files[i].filepos, SEEK_SET);
-                        }
+                }
+                if(handle) {
+                    *handle = pak->handle;
+                    Sys_FileSeek(pak->handle, pak->files[i].filepos);
+                } else {       // open a new file on the pakfile
+                    *file = fopen(pak->filename, "rb");
+                    if(*file) {
+                        fseek(*file, pak->files[i].filepos, SEEK_SET);
                     }
-                    com_filesize = pak->files[i].filelen;
-                    return com_filesize;
                 }
+                com_foundpack = pak;
+                com_foundfile = &pak->files[i];
+                com_filesize = pak->files[i].filelen;
+                return com_filesize;
             }
         } else {
             // check a file in the directory tree
@@ -1337,7 +1434,9 @@ int COM_FindFile(char *filename, int *handle, FILE **file) {
                 }
             }
 
-            Sys_Printf("FindFile: %s\n", netpath);
+            if(developer.value) {
+                Sys_Printf("FindFile: %s\n", netpath);
+            }
             com_filesize = Sys_FileOpenRead(netpath, &i);
             if(handle) {
                 *handle = i;
@@ -1349,7 +1448,12 @@ int COM_FindFile(char *filename, int *handle, FILE **file) {
         }
     }
 
-    Sys_Printf("FindFile: can't find %s\n", filename);
+    COM_AddMissingFile(filename, hash);
+
+notfound:
+    if(developer.value) {
+        Sys_Printf("FindFile: can't find %s\n", filename);
+    }
 
     if(handle) {
         *handle = -1;
@@ -1415,6 +1519,32 @@ Allways appends a 0 byte.
 cache_user_t *loadcache;
 byte *loadbuf;
 int loadsize;
+qboolean loadmapped;
+
+/*
+============
+COM_MappedData
+
+Returns the file COM_FindFile just found if it can be used in place from a
+mapped pak, otherwise NULL.  Loaders read headers through int pointers, so a
+file that isn't aligned within the pak gets copied instead.
+============
+*/
+static byte *COM_MappedData(void) {
+    if(!com_foundpack || !com_foundpack->mapped) {
+        return NULL;
+    }
+
+    if(com_foundfile->filepos < 0 || com_foundfile->filelen < 0 ||
+       com_foundfile->filepos > com_foundpack->mappedsize - com_foundfile->filelen) {
+        return NULL;
+    }
+    if(com_foundfile->filepos & 3) {
+        return NULL;
+    }
+
+    return com_foundpack->mapped + com_foundfile->filepos;
+}
 
 byte *COM_LoadFile(char *path, int usehunk) {
     int h;
@@ -1430,6 +1560,15 @@ byte *COM_LoadFile(char *path, int usehunk) {
         return NULL;
     }
 
+// no need to copy anything if the caller can work straight out of the pak
+    if(loadmapped) {
+        buf = COM_MappedData();
+        if(buf) {
+            COM_CloseFile(h);
+            return buf;
+        }
+    }
+
 // extract the filename base name for hunk tag
     COM_FileBase(path, base);
 
@@ -1487,6 +1626,36 @@ byte *COM_LoadStackFile(char *path, void *buffer, int bufsize) {
     return buf;
 }
 
+/*
+============
+COM_LoadMappedHunkFile / COM_LoadMappedStackFile
+
+Like their unmapped counterparts, but return a pointer directly into the pak
+when it is memory mapped. Mapped data is not null terminated, and any writes
+to it stick for as long as the game runs, so these are only for binary data
+that is parsed once per load.
+============
+*/
+byte *COM_LoadMappedHunkFile(char *path) {
+    byte *buf;
+
+    loadmapped = true;
+    buf = COM_LoadFile(path, 1);
+    loadmapped = false;
+
+    return buf;
+}
+
+byte *COM_LoadMappedStackFile(char *path, void *buffer, int bufsize) {
+    byte *buf;
+
+    loadmapped = true;
+    buf = COM_LoadStackFile(path, buffer, bufsize);
+    loadmapped = false;
+
+    return buf;
+}
+
 /*
 =================
 COM_LoadPackFile
@@ -1504,10 +1673,13 @@ pack_t *COM_LoadPackFile(char *packfile) {
     int numpackfiles;
     pack_t *pack;
     int packhandle;
+    int packsize;
     dpackfile_t info[MAX_FILES_IN_PACK];
     unsigned short crc;
+    unsigned int hash;
 
-    if(Sys_FileOpenRead(packfile, &packhandle) == -1) {
+    packsize = Sys_FileOpenRead(packfile, &packhandle);
+    if(packsize == -1) {
 //              Con_Printf ("Couldn't open %s\n", packfile);
         return NULL;
     }
@@ -1553,6 +1725,24 @@ pack_t *COM_LoadPackFile(char *packfile) {
     pack->numfiles = numpackfiles;
     pack->files = newfiles;
 
+// map the whole thing so parsers can read lumps in place. loaders swap
+// headers in place, which would be undone on a reload on big endian hosts.
+    if(!bigendien && !COM_CheckParm("-nommap")) {
+        pack->mapped = Sys_FileMap(packhandle, packsize);
+        pack->mappedsize = pack->mapped ? packsize : 0;
+    }
+
+// hash the directory, walking backwards so the first copy of a duplicated
+// name ends up at the head of its bucket, just like the old linear search
+    for(i = 0; i < PACK_HASH_SIZE; i++) {
+        pack->hashtable[i] = -1;
+    }
+    for(i = numpackfiles - 1; i >= 0; i--) {
+        hash = COM_HashString(newfiles[i].name) & (PACK_HASH_SIZE - 1);
+        newfiles[i].hashnext = pack->hashtable[hash];
+        pack->hashtable[hash] = i;
+    }
+
     Con_Printf("Added packfile %s (%i files)\n", packfile, numpackfiles);
     return pack;
 }
@@ -1572,6 +1762,7 @@ void COM_AddGameDirectory(char *dir) {
     char pakfile[MAX_OSPATH];
 
     strcpy (com_gamedir, dir);
+    COM_FlushMissingFiles();
 
 //
 // add the directory to the search path
@@ -1693,6 +1884,8 @@ void COM_InitFilesystem(void) {
             search->next = com_searchpaths;
             com_searchpaths = search;
         }
+
+        COM_FlushMissingFiles();
     }
 }
 
@@ -137,6 +137,8 @@ int Q_strncasecmp(char *s1, char *s2, int n);
 int Q_atoi(char *str);
 float Q_atof(char *str);
 
+unsigned int COM_HashString(char *str);
+
 //============================================================================
 
 extern char com_token[1024];
@@ -171,10 +173,13 @@ void COM_WriteFile(char *filename, void *data, int len);
 int COM_OpenFile(char *filename, int *hndl);
 int COM_FOpenFile(char *filename, FILE **file);
 void COM_CloseFile(int h);
+void COM_FlushMissingFiles(void);
 
 byte *COM_LoadStackFile(char *path, void *buffer, int bufsize);
+byte *COM_LoadMappedStackFile(char *path, void *buffer, int bufsize);
 byte *COM_LoadTempFile(char *path);
 byte *COM_LoadHunkFile(char *path);
+byte *COM_LoadMappedHunkFile(char *path);
 void COM_LoadCacheFile(char *path, struct cache_user_s *cu);
 
 extern struct cvar_s registered;
@@ -259,6 +259,7 @@ void Host_WriteConfiguration(void) {
             Con_Printf("Couldn't write config.cfg.\n");
             return;
         }
+        COM_FlushMissingFiles();
 
         Key_WriteBindings(f);
         Cvar_WriteVariables(f);
@@ -526,6 +527,7 @@ void Host_GetConsoleCommands(void) {
         if(!cmd) {
             break;
         }
+        COM_FlushMissingFiles();    // files may have been copied in since
         Cbuf_AddText(cmd);
     }
 }
@@ -539,12 +541,17 @@ Host_ServerFrame
 */
 
 void Host_ServerFrame(void) {
+    Prof_Begin(PROF_SERVERFRAME);
+
 // run the world state	
     pr_global_struct->frametime = host_frametime;
 
 // set the time and clear the general datagram
     SV_ClearDatagram();
 
+// read everything the clients sent in one go
+    NET_BeginBatch();
+
 // check for new clients
     SV_CheckForNewClients();
 
@@ -559,6 +566,9 @@ void Host_ServerFrame(void) {
 
 // send all messages to the clients
     SV_SendClientMessages();
+    NET_EndBatch();
+
+    Prof_End(PROF_SERVERFRAME);
 }
 
 /*
@@ -585,6 +595,8 @@ void _Host_Frame(float time) {
     if(!Host_FilterTime(time))
         return;            // don't run too fast, or packets will flood out
 
+    Prof_FrameBegin();
+
 // get new key events
     Sys_SendKeyEvents();
 
@@ -656,6 +668,9 @@ void _Host_Frame(float time) {
         Con_Printf("%3i tot %3i server %3i gfx %3i snd\n", pass1 + pass2 + pass3, pass1, pass2, pass3);
     }
 
+    Memory_Frame();
+    Prof_FrameEnd();
+
     host_framecount++;
 }
 
@@ -786,6 +801,7 @@ void Host_Init(quakeparms_t *parms) {
     Cmd_Init();
     V_Init();
     Chase_Init();
+    Prof_Init();
     Host_InitVCR(parms);
     COM_Init(parms->basedir);
     Host_InitLocal();
@@ -457,6 +457,7 @@ void Host_Savegame_f(void) {
         Con_Printf("ERROR: couldn't open.\n");
         return;
     }
+    COM_FlushMissingFiles();
 
     fprintf(f, "%i\n", SAVEGAME_VERSION);
     Host_SavegameComment(comment);
@@ -922,6 +923,24 @@ void Host_PreSpawn_f(void) {
     host_client->sendsignon = true;
 }
 
+/*
+==================
+Host_Delta_f
+
+Sent with prespawn by clients that can decode delta snapshots
+==================
+*/
+void Host_Delta_f(void) {
+    if(cmd_source == src_command) {
+        Con_Printf("delta is not valid from the console\n");
+        return;
+    }
+
+    host_client->delta = sv_deltasnapshots.value != 0;
+    host_client->snapshotfirst = host_client->snapshotseq;
+    host_client->snapshotack = -1;
+}
+
 /*
 ==================
 Host_Spawn_f
@@ -1152,6 +1171,15 @@ DEBUGGING TOOLS
 ===============================================================================
 */
 
+// rogue ammo fields, set by "give" when progs.dat has them
+static edictfield_t ef_ammo_shells1 = { "ammo_shells1" };
+static edictfield_t ef_ammo_nails1 = { "ammo_nails1" };
+static edictfield_t ef_ammo_lava_nails = { "ammo_lava_nails" };
+static edictfield_t ef_ammo_rockets1 = { "ammo_rockets1" };
+static edictfield_t ef_ammo_multi_rockets = { "ammo_multi_rockets" };
+static edictfield_t ef_ammo_cells1 = { "ammo_cells1" };
+static edictfield_t ef_ammo_plasma = { "ammo_plasma" };
+
 /*
 ==================
 Host_Give_f
@@ -1209,7 +1237,7 @@ void Host_Give_f(void) {
 
         case 's':
             if(rogue) {
-                val = GetEdictFieldValue(sv_player, "ammo_shells1");
+                val = GetEdictField(sv_player, &ef_ammo_shells1);
                 if(val) {
                     val->_float = v;
                 }
@@ -1219,7 +1247,7 @@ void Host_Give_f(void) {
             break;
         case 'n':
             if(rogue) {
-                val = GetEdictFieldValue(sv_player, "ammo_nails1");
+                val = GetEdictField(sv_player, &ef_ammo_nails1);
                 if(val) {
                     val->_float = v;
                     if(sv_player->v.weapon <= IT_LIGHTNING) {
@@ -1232,7 +1260,7 @@ void Host_Give_f(void) {
             break;
         case 'l':
             if(rogue) {
-                val = GetEdictFieldValue(sv_player, "ammo_lava_nails");
+                val = GetEdictField(sv_player, &ef_ammo_lava_nails);
                 if(val) {
                     val->_float = v;
                     if(sv_player->v.weapon > IT_LIGHTNING) {
@@ -1243,7 +1271,7 @@ void Host_Give_f(void) {
             break;
         case 'r':
             if(rogue) {
-                val = GetEdictFieldValue(sv_player, "ammo_rockets1");
+                val = GetEdictField(sv_player, &ef_ammo_rockets1);
                 if(val) {
                     val->_float = v;
                     if(sv_player->v.weapon <= IT_LIGHTNING) {
@@ -1256,7 +1284,7 @@ void Host_Give_f(void) {
             break;
         case 'm':
             if(rogue) {
-                val = GetEdictFieldValue(sv_player, "ammo_multi_rockets");
+                val = GetEdictField(sv_player, &ef_ammo_multi_rockets);
                 if(val) {
                     val->_float = v;
                     if(sv_player->v.weapon > IT_LIGHTNING) {
@@ -1270,7 +1298,7 @@ void Host_Give_f(void) {
             break;
         case 'c':
             if(rogue) {
-                val = GetEdictFieldValue(sv_player, "ammo_cells1");
+                val = GetEdictField(sv_player, &ef_ammo_cells1);
                 if(val) {
                     val->_float = v;
                     if(sv_player->v.weapon <= IT_LIGHTNING) {
@@ -1283,7 +1311,7 @@ void Host_Give_f(void) {
             break;
         case 'p':
             if(rogue) {
-                val = GetEdictFieldValue(sv_player, "ammo_plasma");
+                val = GetEdictField(sv_player, &ef_ammo_plasma);
                 if(val) {
                     val->_float = v;
                     if(sv_player->v.weapon > IT_LIGHTNING) {
@@ -1526,6 +1554,7 @@ void Host_InitCommands(void) {
     Cmd_AddCommand("spawn", Host_Spawn_f);
     Cmd_AddCommand("begin", Host_Begin_f);
     Cmd_AddCommand("prespawn", Host_PreSpawn_f);
+    Cmd_AddCommand("delta", Host_Delta_f);
     Cmd_AddCommand("kick", Host_Kick_f);
     Cmd_AddCommand("ping", Host_Ping_f);
     Cmd_AddCommand("load", Host_Loadgame_f);
@@ -103,6 +103,7 @@ void Key_Console(int key) {
     char *cmd;
 
     if(key == K_ENTER) {
+        COM_FlushMissingFiles();    // files may have been copied in since
         Cbuf_AddText(key_lines[edit_line] + 1);    // skip the >
         Cbuf_AddText("\n");
         Con_Printf("%s\n", key_lines[edit_line]);
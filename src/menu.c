@@ -2470,3 +2470,23 @@ void M_ConfigureNetSubsystem(void) {
         net_hostport = lanConfig_port;
     }
 }
+
+/*
+================
+M_ConnectDone
+
+Called by the network drivers once a connect has finished, with the reason
+if it failed, so a connect started from the menu can go back to it
+================
+*/
+void M_ConnectDone(char *reason) {
+    if(reason) {
+        Q_strncpy(m_return_reason, reason, sizeof(m_return_reason) - 1);
+        m_return_reason[sizeof(m_return_reason) - 1] = 0;
+        if(m_return_onerror) {
+            key_dest = key_menu;
+            m_state = m_return_state;
+        }
+    }
+    m_return_onerror = false;
+}
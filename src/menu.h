@@ -35,5 +35,6 @@ void M_Init(void);
 void M_Keydown(int key);
 void M_Draw(void);
 void M_ToggleMenu_f(void);
+void M_ConnectDone(char *reason);
 
 #endif // !MENU_H
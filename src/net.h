@@ -172,6 +172,8 @@ typedef struct {
     int (*AddrCompare)(struct qsockaddr *addr1, struct qsockaddr *addr2);
     int (*GetSocketPort)(struct qsockaddr *addr);
     int (*SetSocketPort)(struct qsockaddr *addr, int port);
+    int (*OpenSharedSocket)(int socket);    // NULL if accepted clients get their own socket
+    void (*Batch)(qboolean state);          // NULL if the driver does not batch
 } net_landriver_t;
 
 #define    MAX_NET_DRIVERS        8
@@ -193,6 +195,7 @@ typedef struct {
     qboolean (*CanSendUnreliableMessage)(qsocket_t *sock);
     void (*Close)(qsocket_t *sock);
     void (*Shutdown)(void);
+    void (*Batch)(qboolean state);
     int controlSock;
 } net_driver_t;
 
@@ -232,21 +235,6 @@ typedef struct {
 extern int hostCacheCount;
 extern hostcache_t hostcache[HOSTCACHESIZE];
 
-#if !defined(_WIN32 )
-#ifndef htonl
-extern unsigned long htonl (unsigned long hostlong);
-#endif
-#ifndef htons
-extern unsigned short htons (unsigned short hostshort);
-#endif
-#ifndef ntohl
-extern unsigned long ntohl (unsigned long netlong);
-#endif
-#ifndef ntohs
-extern unsigned short ntohs (unsigned short netshort);
-#endif
-#endif
-
 //============================================================================
 //
 // public network functions
@@ -299,6 +287,13 @@ void NET_Close(struct qsocket_s *sock);
 
 void NET_Poll(void);
 
+void NET_BeginBatch(void);
+void NET_EndBatch(void);
+// Between these the drivers read whatever is waiting once, at the begin, and
+// hold the writes until the end, so a server frame costs a few system calls
+// however many clients it has.  NET_SendToAll ends the batch since it waits
+// for answers.
+
 typedef struct _PollProcedure {
     struct _PollProcedure *next;
     double nextTime;
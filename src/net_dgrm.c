@@ -0,0 +1,892 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// net_dgrm.c -- reliable and unreliable messages over a lan driver
+
+#include "quakedef.h"
+
+#include "net_dgrm.h"
+
+// these two macros are to make the code more readable
+#define sfunc    net_landrivers[sock->landriver]
+#define dfunc    net_landrivers[net_landriverlevel]
+
+static int net_landriverlevel;
+
+static struct {
+    unsigned int length;
+    unsigned int sequence;
+    byte data[MAX_DATAGRAM];
+} packetBuffer;
+
+static int packetsSent = 0;
+static int packetsReSent = 0;
+static int packetsReceived = 0;
+static int receivedDuplicateCount = 0;
+static int shortPacketCount = 0;
+static int droppedDatagrams;
+
+/*
+==================
+Datagram_WriteControl
+
+Fills in the header of the control message in net_message and sends it
+==================
+*/
+static void Datagram_WriteControl(int socket, struct qsockaddr *addr) {
+    *((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
+    dfunc.Write(socket, net_message.data, net_message.cursize, addr);
+    SZ_Clear(&net_message);
+}
+
+/*
+==================
+Datagram_ReadControl
+
+Checks the header of a control message read into net_message and leaves
+the message positioned after it
+==================
+*/
+static qboolean Datagram_ReadControl(int len) {
+    int control;
+
+    if(len < (int)sizeof(int)) {
+        return false;
+    }
+    net_message.cursize = len;
+
+    MSG_BeginReading();
+    control = BigLong(*((int *)net_message.data));
+    MSG_ReadLong();
+    if(control == -1) {
+        return false;
+    }
+    if((control & (~NETFLAG_LENGTH_MASK)) != (int)NETFLAG_CTL) {
+        return false;
+    }
+    if((control & NETFLAG_LENGTH_MASK) != len) {
+        return false;
+    }
+    return true;
+}
+
+int Datagram_SendMessage(qsocket_t *sock, sizebuf_t *data) {
+    unsigned int packetLen;
+    unsigned int dataLen;
+    unsigned int eom;
+
+    Q_memcpy(sock->sendMessage, data->data, data->cursize);
+    sock->sendMessageLength = data->cursize;
+
+    if(data->cursize <= MAX_DATAGRAM) {
+        dataLen = data->cursize;
+        eom = NETFLAG_EOM;
+    } else {
+        dataLen = MAX_DATAGRAM;
+        eom = 0;
+    }
+    packetLen = NET_HEADERSIZE + dataLen;
+
+    packetBuffer.length = BigLong(packetLen | (NETFLAG_DATA | eom));
+    packetBuffer.sequence = BigLong(sock->sendSequence++);
+    Q_memcpy(packetBuffer.data, sock->sendMessage, dataLen);
+
+    sock->canSend = false;
+
+    if(sfunc.Write(sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1) {
+        return -1;
+    }
+
+    sock->lastSendTime = net_time;
+    packetsSent++;
+    return 1;
+}
+
+static int SendMessageNext(qsocket_t *sock) {
+    unsigned int packetLen;
+    unsigned int dataLen;
+    unsigned int eom;
+
+    if(sock->sendMessageLength <= MAX_DATAGRAM) {
+        dataLen = sock->sendMessageLength;
+        eom = NETFLAG_EOM;
+    } else {
+        dataLen = MAX_DATAGRAM;
+        eom = 0;
+    }
+    packetLen = NET_HEADERSIZE + dataLen;
+
+    packetBuffer.length = BigLong(packetLen | (NETFLAG_DATA | eom));
+    packetBuffer.sequence = BigLong(sock->sendSequence++);
+    Q_memcpy(packetBuffer.data, sock->sendMessage, dataLen);
+
+    sock->sendNext = false;
+
+    if(sfunc.Write(sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1) {
+        return -1;
+    }
+
+    sock->lastSendTime = net_time;
+    packetsSent++;
+    return 1;
+}
+
+static int ReSendMessage(qsocket_t *sock) {
+    unsigned int packetLen;
+    unsigned int dataLen;
+    unsigned int eom;
+
+    if(sock->sendMessageLength <= MAX_DATAGRAM) {
+        dataLen = sock->sendMessageLength;
+        eom = NETFLAG_EOM;
+    } else {
+        dataLen = MAX_DATAGRAM;
+        eom = 0;
+    }
+    packetLen = NET_HEADERSIZE + dataLen;
+
+    packetBuffer.length = BigLong(packetLen | (NETFLAG_DATA | eom));
+    packetBuffer.sequence = BigLong(sock->sendSequence - 1);
+    Q_memcpy(packetBuffer.data, sock->sendMessage, dataLen);
+
+    sock->sendNext = false;
+
+    if(sfunc.Write(sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1) {
+        return -1;
+    }
+
+    sock->lastSendTime = net_time;
+    packetsReSent++;
+    return 1;
+}
+
+qboolean Datagram_CanSendMessage(qsocket_t *sock) {
+    if(sock->sendNext) {
+        SendMessageNext(sock);
+    }
+
+    return sock->canSend;
+}
+
+qboolean Datagram_CanSendUnreliableMessage(qsocket_t *sock) {
+    return true;
+}
+
+int Datagram_SendUnreliableMessage(qsocket_t *sock, sizebuf_t *data) {
+    int packetLen;
+
+    packetLen = NET_HEADERSIZE + data->cursize;
+
+    packetBuffer.length = BigLong(packetLen | NETFLAG_UNRELIABLE);
+    packetBuffer.sequence = BigLong(sock->unreliableSendSequence++);
+    Q_memcpy(packetBuffer.data, data->data, data->cursize);
+
+    if(sfunc.Write(sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1) {
+        return -1;
+    }
+
+    packetsSent++;
+    return 1;
+}
+
+int Datagram_GetMessage(qsocket_t *sock) {
+    int length;
+    unsigned int flags;
+    int ret = 0;
+    struct qsockaddr readaddr;
+    unsigned int sequence;
+    unsigned int count;
+
+    if(!sock->canSend) {
+        if((net_time - sock->lastSendTime) > 1.0) {
+            ReSendMessage(sock);
+        }
+    }
+
+    while(1) {
+        length = sfunc.Read(sock->socket, (byte *)&packetBuffer, NET_DATAGRAMSIZE, &readaddr);
+
+        if(length == 0) {
+            break;
+        }
+
+        if(length == -1) {
+            Con_Printf("Read error\n");
+            return -1;
+        }
+
+        if(sfunc.AddrCompare(&readaddr, &sock->addr) != 0) {
+            Con_DPrintf("Forged packet received\n");
+            Con_DPrintf("Expected: %s\n", sfunc.AddrToString(&sock->addr));
+            Con_DPrintf("Received: %s\n", sfunc.AddrToString(&readaddr));
+            continue;
+        }
+
+        if(length < (int)NET_HEADERSIZE) {
+            shortPacketCount++;
+            continue;
+        }
+
+        flags = BigLong(packetBuffer.length);
+        if((int)(flags & NETFLAG_LENGTH_MASK) != length) {
+            shortPacketCount++;
+            continue;
+        }
+        flags &= ~NETFLAG_LENGTH_MASK;
+
+        if(flags & NETFLAG_CTL) {
+            continue;
+        }
+
+        sequence = BigLong(packetBuffer.sequence);
+        packetsReceived++;
+        length -= NET_HEADERSIZE;
+
+        if(flags & NETFLAG_UNRELIABLE) {
+            if(sequence < sock->unreliableReceiveSequence) {
+                Con_DPrintf("Got a stale datagram\n");
+                continue;
+            }
+            if(sequence != sock->unreliableReceiveSequence) {
+                count = sequence - sock->unreliableReceiveSequence;
+                droppedDatagrams += count;
+                Con_DPrintf("Dropped %u datagram(s)\n", count);
+            }
+            sock->unreliableReceiveSequence = sequence + 1;
+
+            SZ_Clear(&net_message);
+            SZ_Write(&net_message, packetBuffer.data, length);
+
+            ret = 2;
+            break;
+        }
+
+        if(flags & NETFLAG_ACK) {
+            if(sequence != (sock->sendSequence - 1)) {
+                Con_DPrintf("Stale ACK received\n");
+                continue;
+            }
+            if(sequence == sock->ackSequence) {
+                sock->ackSequence++;
+                if(sock->ackSequence != sock->sendSequence) {
+                    Con_DPrintf("ack sequencing error\n");
+                }
+            } else {
+                Con_DPrintf("Duplicate ACK received\n");
+                continue;
+            }
+            sock->sendMessageLength -= MAX_DATAGRAM;
+            if(sock->sendMessageLength > 0) {
+                Q_memcpy(sock->sendMessage, sock->sendMessage + MAX_DATAGRAM, sock->sendMessageLength);
+                sock->sendNext = true;
+            } else {
+                sock->sendMessageLength = 0;
+                sock->canSend = true;
+            }
+            continue;
+        }
+
+        if(flags & NETFLAG_DATA) {
+            packetBuffer.length = BigLong(NET_HEADERSIZE | NETFLAG_ACK);
+            packetBuffer.sequence = BigLong(sequence);
+            sfunc.Write(sock->socket, (byte *)&packetBuffer, NET_HEADERSIZE, &readaddr);
+
+            if(sequence != sock->receiveSequence) {
+                receivedDuplicateCount++;
+                continue;
+            }
+            sock->receiveSequence++;
+
+            if(sock->receiveMessageLength + length > NET_MAXMESSAGE) {
+                Con_Printf("Oversize message from %s\n", sock->address);
+                return -1;
+            }
+
+            if(flags & NETFLAG_EOM) {
+                SZ_Clear(&net_message);
+                SZ_Write(&net_message, sock->receiveMessage, sock->receiveMessageLength);
+                SZ_Write(&net_message, packetBuffer.data, length);
+                sock->receiveMessageLength = 0;
+
+                ret = 1;
+                break;
+            }
+
+            Q_memcpy(sock->receiveMessage + sock->receiveMessageLength, packetBuffer.data, length);
+            sock->receiveMessageLength += length;
+            continue;
+        }
+    }
+
+    if(sock->sendNext) {
+        SendMessageNext(sock);
+    }
+
+    return ret;
+}
+
+static void PrintStats(qsocket_t *s) {
+    Con_Printf("canSend = %4u   \n", s->canSend);
+    Con_Printf("sendSeq = %4u   ", s->sendSequence);
+    Con_Printf("recvSeq = %4u   \n", s->receiveSequence);
+    Con_Printf("\n");
+}
+
+static void NET_Stats_f(void) {
+    qsocket_t *s;
+
+    if(Cmd_Argc() == 1) {
+        Con_Printf("unreliable messages sent   = %i\n", unreliableMessagesSent);
+        Con_Printf("unreliable messages recv   = %i\n", unreliableMessagesReceived);
+        Con_Printf("reliable messages sent     = %i\n", messagesSent);
+        Con_Printf("reliable messages received = %i\n", messagesReceived);
+        Con_Printf("packetsSent                = %i\n", packetsSent);
+        Con_Printf("packetsReSent              = %i\n", packetsReSent);
+        Con_Printf("packetsReceived            = %i\n", packetsReceived);
+        Con_Printf("receivedDuplicateCount     = %i\n", receivedDuplicateCount);
+        Con_Printf("shortPacketCount           = %i\n", shortPacketCount);
+        Con_Printf("droppedDatagrams           = %i\n", droppedDatagrams);
+    } else if(Q_strcmp(Cmd_Argv(1), "*") == 0) {
+        for(s = net_activeSockets; s; s = s->next) {
+            PrintStats(s);
+        }
+    } else {
+        for(s = net_activeSockets; s; s = s->next) {
+            if(Q_strcasecmp(Cmd_Argv(1), s->address) == 0) {
+                break;
+            }
+        }
+        if(s == NULL) {
+            return;
+        }
+        PrintStats(s);
+    }
+}
+
+int Datagram_Init(void) {
+    int i;
+    int csock;
+    int count;
+
+    Cmd_AddCommand("net_stats", NET_Stats_f);
+
+    if(COM_CheckParm("-nolan")) {
+        return -1;
+    }
+
+    count = 0;
+    for(i = 0; i < net_numlandrivers; i++) {
+        csock = net_landrivers[i].Init();
+        if(csock == -1) {
+            continue;
+        }
+        net_landrivers[i].initialized = true;
+        net_landrivers[i].controlSock = csock;
+        count++;
+    }
+
+    return count ? 0 : -1;
+}
+
+void Datagram_Shutdown(void) {
+    int i;
+
+    for(i = 0; i < net_numlandrivers; i++) {
+        if(net_landrivers[i].initialized) {
+            net_landrivers[i].Shutdown();
+            net_landrivers[i].initialized = false;
+        }
+    }
+}
+
+void Datagram_Close(qsocket_t *sock) {
+    sfunc.CloseSocket(sock->socket);
+}
+
+void Datagram_Listen(qboolean state) {
+    int i;
+
+    for(i = 0; i < net_numlandrivers; i++) {
+        if(net_landrivers[i].initialized) {
+            net_landrivers[i].Listen(state);
+        }
+    }
+}
+
+void Datagram_Batch(qboolean state) {
+    int i;
+
+    for(i = 0; i < net_numlandrivers; i++) {
+        if(net_landrivers[i].initialized && net_landrivers[i].Batch) {
+            net_landrivers[i].Batch(state);
+        }
+    }
+}
+
+static qsocket_t *_Datagram_CheckNewConnections(void) {
+    struct qsockaddr clientaddr;
+    struct qsockaddr newaddr;
+    int newsock;
+    int acceptsock;
+    qsocket_t *sock;
+    qsocket_t *s;
+    int len;
+    int command;
+
+    acceptsock = dfunc.CheckNewConnections();
+    if(acceptsock == -1) {
+        return NULL;
+    }
+
+    SZ_Clear(&net_message);
+
+    len = dfunc.Read(acceptsock, net_message.data, net_message.maxsize, &clientaddr);
+    if(!Datagram_ReadControl(len)) {
+        return NULL;
+    }
+
+    command = MSG_ReadByte();
+    if(command == CCREQ_SERVER_INFO) {
+        if(Q_strcmp(MSG_ReadString(), "QUAKE") != 0) {
+            return NULL;
+        }
+
+        SZ_Clear(&net_message);
+        // save space for the header, filled in later
+        MSG_WriteLong(&net_message, 0);
+        MSG_WriteByte(&net_message, CCREP_SERVER_INFO);
+        dfunc.GetSocketAddr(acceptsock, &newaddr);
+        MSG_WriteString(&net_message, dfunc.AddrToString(&newaddr));
+        MSG_WriteString(&net_message, hostname.string);
+        MSG_WriteString(&net_message, sv.name);
+        MSG_WriteByte(&net_message, net_activeconnections);
+        MSG_WriteByte(&net_message, svs.maxclients);
+        MSG_WriteByte(&net_message, NET_PROTOCOL_VERSION);
+        Datagram_WriteControl(acceptsock, &clientaddr);
+        return NULL;
+    }
+
+    if(command == CCREQ_PLAYER_INFO) {
+        int playerNumber;
+        int activeNumber;
+        int clientNumber;
+        client_t *client;
+
+        playerNumber = MSG_ReadByte();
+        activeNumber = -1;
+        for(clientNumber = 0, client = svs.clients; clientNumber < svs.maxclients; clientNumber++, client++) {
+            if(client->active) {
+                activeNumber++;
+                if(activeNumber == playerNumber) {
+                    break;
+                }
+            }
+        }
+        if(clientNumber == svs.maxclients) {
+            return NULL;
+        }
+
+        SZ_Clear(&net_message);
+        // save space for the header, filled in later
+        MSG_WriteLong(&net_message, 0);
+        MSG_WriteByte(&net_message, CCREP_PLAYER_INFO);
+        MSG_WriteByte(&net_message, playerNumber);
+        MSG_WriteString(&net_message, client->name);
+        MSG_WriteLong(&net_message, client->colors);
+        MSG_WriteLong(&net_message, (int)client->edict->v.frags);
+        MSG_WriteLong(&net_message, (int)(net_time - client->netconnection->connecttime));
+        MSG_WriteString(&net_message, client->netconnection->address);
+        Datagram_WriteControl(acceptsock, &clientaddr);
+        return NULL;
+    }
+
+    if(command == CCREQ_RULE_INFO) {
+        char *prevCvarName;
+        cvar_t *var;
+
+        // find the search start location
+        prevCvarName = MSG_ReadString();
+        if(*prevCvarName) {
+            var = Cvar_FindVar(prevCvarName);
+            if(!var) {
+                return NULL;
+            }
+            var = var->next;
+        } else {
+            var = cvar_vars;
+        }
+
+        // search for the next server cvar
+        while(var) {
+            if(var->server) {
+                break;
+            }
+            var = var->next;
+        }
+
+        SZ_Clear(&net_message);
+        // save space for the header, filled in later
+        MSG_WriteLong(&net_message, 0);
+        MSG_WriteByte(&net_message, CCREP_RULE_INFO);
+        if(var) {
+            MSG_WriteString(&net_message, var->name);
+            MSG_WriteString(&net_message, var->string);
+        }
+        Datagram_WriteControl(acceptsock, &clientaddr);
+        return NULL;
+    }
+
+    if(command != CCREQ_CONNECT) {
+        return NULL;
+    }
+
+    if(Q_strcmp(MSG_ReadString(), "QUAKE") != 0) {
+        return NULL;
+    }
+
+    if(MSG_ReadByte() != NET_PROTOCOL_VERSION) {
+        SZ_Clear(&net_message);
+        // save space for the header, filled in later
+        MSG_WriteLong(&net_message, 0);
+        MSG_WriteByte(&net_message, CCREP_REJECT);
+        MSG_WriteString(&net_message, "Incompatible version.\n");
+        Datagram_WriteControl(acceptsock, &clientaddr);
+        return NULL;
+    }
+
+    // see if this guy is already connected; other ports on the same
+    // address are other clients
+    for(s = net_activeSockets; s; s = s->next) {
+        if(s->driver != net_driverlevel) {
+            continue;
+        }
+        if(dfunc.AddrCompare(&clientaddr, &s->addr) != 0) {
+            continue;
+        }
+
+        // is this a duplicate connection request?
+        if(net_time - s->connecttime < 2.0) {
+            // yes, so send a duplicate reply
+            SZ_Clear(&net_message);
+            // save space for the header, filled in later
+            MSG_WriteLong(&net_message, 0);
+            MSG_WriteByte(&net_message, CCREP_ACCEPT);
+            dfunc.GetSocketAddr(s->socket, &newaddr);
+            MSG_WriteLong(&net_message, dfunc.GetSocketPort(&newaddr));
+            Datagram_WriteControl(acceptsock, &clientaddr);
+            return NULL;
+        }
+
+        // it's somebody coming back in from a crash/disconnect
+        // so close the old qsocket and let their retry get them back in
+        NET_Close(s);
+        return NULL;
+    }
+
+    // allocate a QSocket
+    sock = NET_NewQSocket();
+    if(sock == NULL) {
+        // no room; try to let him know
+        SZ_Clear(&net_message);
+        // save space for the header, filled in later
+        MSG_WriteLong(&net_message, 0);
+        MSG_WriteByte(&net_message, CCREP_REJECT);
+        MSG_WriteString(&net_message, "Server is full.\n");
+        Datagram_WriteControl(acceptsock, &clientaddr);
+        return NULL;
+    }
+
+    // allocate a network socket
+    if(dfunc.OpenSharedSocket) {
+        newsock = dfunc.OpenSharedSocket(acceptsock);
+    } else {
+        newsock = dfunc.OpenSocket(0);
+    }
+    if(newsock == -1) {
+        NET_FreeQSocket(sock);
+        return NULL;
+    }
+
+    // connect to the client
+    if(dfunc.Connect(newsock, &clientaddr) == -1) {
+        dfunc.CloseSocket(newsock);
+        NET_FreeQSocket(sock);
+        return NULL;
+    }
+
+    // everything is allocated, just fill in the details
+    sock->socket = newsock;
+    sock->landriver = net_landriverlevel;
+    sock->addr = clientaddr;
+    Q_strcpy(sock->address, dfunc.AddrToString(&clientaddr));
+
+    // send him back the info about the server connection he has been allocated
+    SZ_Clear(&net_message);
+    // save space for the header, filled in later
+    MSG_WriteLong(&net_message, 0);
+    MSG_WriteByte(&net_message, CCREP_ACCEPT);
+    dfunc.GetSocketAddr(newsock, &newaddr);
+    MSG_WriteLong(&net_message, dfunc.GetSocketPort(&newaddr));
+    Datagram_WriteControl(acceptsock, &clientaddr);
+
+    return sock;
+}
+
+qsocket_t *Datagram_CheckNewConnections(void) {
+    qsocket_t *ret = NULL;
+
+    for(net_landriverlevel = 0; net_landriverlevel < net_numlandrivers; net_landriverlevel++) {
+        if(net_landrivers[net_landriverlevel].initialized) {
+            if((ret = _Datagram_CheckNewConnections()) != NULL) {
+                break;
+            }
+        }
+    }
+    return ret;
+}
+
+static void _Datagram_SearchForHosts(qboolean xmit) {
+    int ret;
+    int n;
+    int i;
+    struct qsockaddr readaddr;
+    struct qsockaddr myaddr;
+    hostcache_t *host;
+
+    dfunc.GetSocketAddr(dfunc.controlSock, &myaddr);
+    if(xmit) {
+        SZ_Clear(&net_message);
+        // save space for the header, filled in later
+        MSG_WriteLong(&net_message, 0);
+        MSG_WriteByte(&net_message, CCREQ_SERVER_INFO);
+        MSG_WriteString(&net_message, "QUAKE");
+        MSG_WriteByte(&net_message, NET_PROTOCOL_VERSION);
+        *((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
+        dfunc.Broadcast(dfunc.controlSock, net_message.data, net_message.cursize);
+        SZ_Clear(&net_message);
+    }
+
+    while((ret = dfunc.Read(dfunc.controlSock, net_message.data, net_message.maxsize, &readaddr)) > 0) {
+        // don't answer our own query
+        if(dfunc.AddrCompare(&readaddr, &myaddr) >= 0) {
+            continue;
+        }
+
+        // is the cache full?
+        if(hostCacheCount == HOSTCACHESIZE) {
+            continue;
+        }
+
+        if(!Datagram_ReadControl(ret)) {
+            continue;
+        }
+
+        if(MSG_ReadByte() != CCREP_SERVER_INFO) {
+            continue;
+        }
+
+        dfunc.GetAddrFromName(MSG_ReadString(), &readaddr);
+        // search the cache for this server
+        for(n = 0; n < hostCacheCount; n++) {
+            if(dfunc.AddrCompare(&readaddr, &hostcache[n].addr) == 0) {
+                break;
+            }
+        }
+
+        // is it already there?
+        if(n < hostCacheCount) {
+            continue;
+        }
+
+        // add it
+        hostCacheCount++;
+        host = &hostcache[n];
+        Q_strncpy(host->name, MSG_ReadString(), sizeof(host->name) - 1);
+        host->name[sizeof(host->name) - 1] = 0;
+        Q_strncpy(host->map, MSG_ReadString(), sizeof(host->map) - 1);
+        host->map[sizeof(host->map) - 1] = 0;
+        host->users = MSG_ReadByte();
+        host->maxusers = MSG_ReadByte();
+        if(MSG_ReadByte() != NET_PROTOCOL_VERSION) {
+            Q_strcpy(host->cname, host->name);
+            host->cname[14] = 0;
+            Q_strcpy(host->name, "*");
+            Q_strcat(host->name, host->cname);
+        }
+        Q_memcpy(&host->addr, &readaddr, sizeof(struct qsockaddr));
+        host->driver = net_driverlevel;
+        host->ldriver = net_landriverlevel;
+        Q_strncpy(host->cname, dfunc.AddrToString(&readaddr), sizeof(host->cname) - 1);
+        host->cname[sizeof(host->cname) - 1] = 0;
+
+        // check for a name conflict
+        for(i = 0; i < hostCacheCount; i++) {
+            if(i == n) {
+                continue;
+            }
+            if(Q_strcasecmp(host->name, hostcache[i].name) == 0) {
+                i = Q_strlen(host->name);
+                if(i < 15 && host->name[i - 1] > '8') {
+                    host->name[i] = '0';
+                    host->name[i + 1] = 0;
+                } else {
+                    host->name[i - 1]++;
+                }
+                i = -1;
+            }
+        }
+    }
+}
+
+void Datagram_SearchForHosts(qboolean xmit) {
+    for(net_landriverlevel = 0; net_landriverlevel < net_numlandrivers; net_landriverlevel++) {
+        if(hostCacheCount == HOSTCACHESIZE) {
+            break;
+        }
+        if(net_landrivers[net_landriverlevel].initialized) {
+            _Datagram_SearchForHosts(xmit);
+        }
+    }
+}
+
+static qsocket_t *_Datagram_Connect(char *host) {
+    struct qsockaddr sendaddr;
+    struct qsockaddr readaddr;
+    qsocket_t *sock;
+    int newsock;
+    int ret;
+    int reps;
+    double start_time;
+    char *reason;
+
+    // see if we can resolve the host name
+    if(dfunc.GetAddrFromName(host, &sendaddr) == -1) {
+        return NULL;
+    }
+
+    newsock = dfunc.OpenSocket(0);
+    if(newsock == -1) {
+        return NULL;
+    }
+
+    sock = NET_NewQSocket();
+    if(sock == NULL) {
+        dfunc.CloseSocket(newsock);
+        return NULL;
+    }
+    sock->socket = newsock;
+    sock->landriver = net_landriverlevel;
+
+    // connect to the host
+    if(dfunc.Connect(newsock, &sendaddr) == -1) {
+        reason = "Connect failed";
+        goto ErrorReturn;
+    }
+
+    // send the connection request
+    Con_Printf("trying...\n");
+    start_time = net_time;
+    ret = 0;
+
+    for(reps = 0; reps < 3; reps++) {
+        SZ_Clear(&net_message);
+        // save space for the header, filled in later
+        MSG_WriteLong(&net_message, 0);
+        MSG_WriteByte(&net_message, CCREQ_CONNECT);
+        MSG_WriteString(&net_message, "QUAKE");
+        MSG_WriteByte(&net_message, NET_PROTOCOL_VERSION);
+        Datagram_WriteControl(newsock, &sendaddr);
+
+        do {
+            ret = dfunc.Read(newsock, net_message.data, net_message.maxsize, &readaddr);
+            // if we got something, validate it
+            if(ret > 0) {
+                // is it from the right place?
+                if(dfunc.AddrCompare(&readaddr, &sendaddr) != 0 || !Datagram_ReadControl(ret)) {
+                    ret = 0;
+                    continue;
+                }
+            }
+        } while(ret == 0 && (SetNetTime() - start_time) < 2.5);
+
+        if(ret) {
+            break;
+        }
+        Con_Printf("still trying...\n");
+        start_time = SetNetTime();
+    }
+
+    if(ret == 0) {
+        reason = "No Response";
+        goto ErrorReturn;
+    }
+
+    if(ret == -1) {
+        reason = "Network Error";
+        goto ErrorReturn;
+    }
+
+    ret = MSG_ReadByte();
+    if(ret == CCREP_REJECT) {
+        reason = MSG_ReadString();
+        goto ErrorReturn;
+    }
+
+    if(ret != CCREP_ACCEPT) {
+        reason = "Bad Response";
+        goto ErrorReturn;
+    }
+
+    Q_memcpy(&sock->addr, &sendaddr, sizeof(struct qsockaddr));
+    dfunc.SetSocketPort(&sock->addr, MSG_ReadLong());
+
+    dfunc.GetNameFromAddr(&sendaddr, sock->address);
+
+    Con_Printf("Connection accepted\n");
+    sock->lastMessageTime = SetNetTime();
+
+    // switch the connection to the specified address
+    if(dfunc.Connect(newsock, &sock->addr) == -1) {
+        reason = "Connect to Game failed";
+        goto ErrorReturn;
+    }
+
+    M_ConnectDone(NULL);
+    return sock;
+
+    ErrorReturn:
+    Con_Printf("%s\n", reason);
+    NET_FreeQSocket(sock);
+    dfunc.CloseSocket(newsock);
+    M_ConnectDone(reason);
+    return NULL;
+}
+
+qsocket_t *Datagram_Connect(char *host) {
+    qsocket_t *ret = NULL;
+
+    for(net_landriverlevel = 0; net_landriverlevel < net_numlandrivers; net_landriverlevel++) {
+        if(net_landrivers[net_landriverlevel].initialized) {
+            if((ret = _Datagram_Connect(host)) != NULL) {
+                break;
+            }
+        }
+    }
+    return ret;
+}
@@ -661,6 +661,8 @@ int NET_SendToAll(sizebuf_t *data, int blocktime) {
     qboolean state1[MAX_SCOREBOARD];
     qboolean state2[MAX_SCOREBOARD];
 
+    NET_EndBatch();
+
     for(i = 0, host_client = svs.clients; i < svs.maxclients; i++, host_client++) {
         if(!host_client->netconnection) {
             continue;
@@ -803,6 +805,7 @@ void NET_Shutdown(void) {
     qsocket_t *sock;
 
     SetNetTime();
+    NET_EndBatch();
 
     for(sock = net_activeSockets; sock; sock = sock->next) {
         NET_Close(sock);
@@ -825,12 +828,16 @@ void NET_Shutdown(void) {
 }
 
 static PollProcedure *pollProcedureList = NULL;
+static qboolean net_batching;
 
 void NET_Poll(void) {
     PollProcedure *pp;
 
     SetNetTime();
 
+    // a Host_Error in the middle of a server frame skips its NET_EndBatch
+    NET_EndBatch();
+
     for(pp = pollProcedureList; pp; pp = pp->next) {
         if(pp->nextTime > net_time) {
             break;
@@ -840,6 +847,43 @@ void NET_Poll(void) {
     }
 }
 
+/*
+====================
+NET_BeginBatch
+====================
+*/
+void NET_BeginBatch(void) {
+    if(net_batching) {
+        return;
+    }
+    net_batching = true;
+
+    SetNetTime();
+    for(net_driverlevel = 0; net_driverlevel < net_numdrivers; net_driverlevel++) {
+        if(net_drivers[net_driverlevel].initialized && dfunc.Batch) {
+            dfunc.Batch(true);
+        }
+    }
+}
+
+/*
+====================
+NET_EndBatch
+====================
+*/
+void NET_EndBatch(void) {
+    if(!net_batching) {
+        return;
+    }
+    net_batching = false;
+
+    for(net_driverlevel = 0; net_driverlevel < net_numdrivers; net_driverlevel++) {
+        if(net_drivers[net_driverlevel].initialized && dfunc.Batch) {
+            dfunc.Batch(false);
+        }
+    }
+}
+
 void SchedulePollProcedure(PollProcedure *proc, double timeOffset) {
     PollProcedure *pp, *prev;
 
@@ -19,7 +19,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 #include "quakedef.h"
 
+#include "net_dgrm.h"
 #include "net_loop.h"
+#include "net_udp.h"
 
 net_driver_t net_drivers[MAX_NET_DRIVERS] = {
         {
@@ -37,9 +39,57 @@ net_driver_t net_drivers[MAX_NET_DRIVERS] = {
             Loop_CanSendUnreliableMessage,
             Loop_Close,
             Loop_Shutdown
+        },
+        {
+            "Datagram",
+            false,
+            Datagram_Init,
+            Datagram_Listen,
+            Datagram_SearchForHosts,
+            Datagram_Connect,
+            Datagram_CheckNewConnections,
+            Datagram_GetMessage,
+            Datagram_SendMessage,
+            Datagram_SendUnreliableMessage,
+            Datagram_CanSendMessage,
+            Datagram_CanSendUnreliableMessage,
+            Datagram_Close,
+            Datagram_Shutdown,
+            Datagram_Batch
         }
 };
-int net_numdrivers = 1;
+int net_numdrivers = 2;
 
+#ifdef POSIX
+net_landriver_t net_landrivers[MAX_NET_DRIVERS] = {
+        {
+            "UDP",
+            false,
+            0,
+            UDP_Init,
+            UDP_Shutdown,
+            UDP_Listen,
+            UDP_OpenSocket,
+            UDP_CloseSocket,
+            UDP_Connect,
+            UDP_CheckNewConnections,
+            UDP_Read,
+            UDP_Write,
+            UDP_Broadcast,
+            UDP_AddrToString,
+            UDP_StringToAddr,
+            UDP_GetSocketAddr,
+            UDP_GetNameFromAddr,
+            UDP_GetAddrFromName,
+            UDP_AddrCompare,
+            UDP_GetSocketPort,
+            UDP_SetSocketPort,
+            UDP_OpenSharedSocket,
+            UDP_Batch
+        }
+};
+int net_numlandrivers = 1;
+#else
 net_landriver_t net_landrivers[MAX_NET_DRIVERS];
 int net_numlandrivers = 0;
+#endif
@@ -0,0 +1,757 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// net_udp.c -- BSD sockets lan driver
+
+/*
+The sockets handed to the datagram driver are slots in udp_sockets.  A slot
+owns a UDP socket, or shares the one of the slot it was opened from: the
+server talks to all of its clients through the accept socket, so everything
+they sent in a frame comes in with one recvmmsg, and the writes of a server
+frame go out with one sendmmsg.
+
+What is read off a socket is queued on the slot connected to the sender.
+Control packets always go to the owner, so a client that lost its
+CCREP_ACCEPT can ask again.  Other packets from senders no slot is connected
+to, such as a kicked client that keeps talking, are dropped before they can
+fill the owner's queue and crowd out connection requests.
+*/
+
+#ifdef __linux__
+#define _GNU_SOURCE        // recvmmsg and sendmmsg
+#endif
+
+#ifdef POSIX
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#include "quakedef.h"
+
+#ifdef POSIX
+
+#include "net_udp.h"
+
+#define UDP_MAXSOCKETS    (MAX_SCOREBOARD + 8)
+#define UDP_PACKETS       512
+#define UDP_QUEUELIMIT    32        // packets held for a slot before dropping
+#define UDP_BATCH         64
+
+typedef struct {
+    int next;
+    int length;
+    struct qsockaddr addr;
+    byte data[NET_DATAGRAMSIZE];
+} udppacket_t;
+
+typedef struct {
+    qboolean used;
+    qboolean open;                // false once the owner is closed under its sharers
+    int fd;
+    int owner;                    // slot that owns fd, can be this one
+    int users;                    // slots using fd, only kept by the owner
+    qboolean connected;
+    struct qsockaddr addr;        // sender that is queued here
+    int head, tail, count;        // queued packets
+} udpsocket_t;
+
+static udpsocket_t udp_sockets[UDP_MAXSOCKETS];
+
+static udppacket_t udp_packets[UDP_PACKETS];
+static int udp_freepackets;
+
+static struct {
+    int fd;
+    int length;
+    struct qsockaddr addr;
+    byte data[NET_DATAGRAMSIZE];
+} udp_sends[UDP_BATCH];
+static int udp_numsends;
+static qboolean udp_batching;
+
+static int net_acceptsocket = -1;    // socket for fielding new connections
+static int net_controlsocket;
+static struct qsockaddr broadcastaddr;
+
+static unsigned long myAddr;
+
+/*
+===================
+UDP_AllocPacket
+===================
+*/
+static int UDP_AllocPacket(void) {
+    int p;
+
+    p = udp_freepackets;
+    if(p != -1) {
+        udp_freepackets = udp_packets[p].next;
+    }
+    return p;
+}
+
+static void UDP_FreePacket(int p) {
+    udp_packets[p].next = udp_freepackets;
+    udp_freepackets = p;
+}
+
+/*
+===================
+UDP_QueuePacket
+
+Hands a packet read off the socket of owner to the slot it is for
+===================
+*/
+static void UDP_QueuePacket(int owner, int p) {
+    udppacket_t *packet;
+    udpsocket_t *s;
+    int i, target;
+
+    packet = &udp_packets[p];
+    target = owner;
+    if(packet->length < 4 || !(packet->data[0] & 0x80)) {    // not NETFLAG_CTL
+        target = -1;
+        for(i = 0, s = udp_sockets; i < UDP_MAXSOCKETS; i++, s++) {
+            if(s->used && s->owner == owner && s->connected && !UDP_AddrCompare(&packet->addr, &s->addr)) {
+                target = i;
+                break;
+            }
+        }
+        if(target == -1) {
+            UDP_FreePacket(p);
+            return;
+        }
+    }
+
+    s = &udp_sockets[target];
+    if(!s->open || s->count == UDP_QUEUELIMIT) {
+        UDP_FreePacket(p);
+        return;
+    }
+
+    packet->next = -1;
+    if(s->count) {
+        udp_packets[s->tail].next = p;
+    } else {
+        s->head = p;
+    }
+    s->tail = p;
+    s->count++;
+}
+
+/*
+===================
+UDP_Receive
+
+Reads everything waiting on the socket of owner
+===================
+*/
+static void UDP_Receive(int owner) {
+    int fd;
+#ifdef __linux__
+    struct mmsghdr msgs[UDP_BATCH];
+    struct iovec iov[UDP_BATCH];
+    int ids[UDP_BATCH];
+    int i, n, got;
+#else
+    socklen_t addrlen;
+    int p;
+#endif
+
+    fd = udp_sockets[owner].fd;
+
+#ifdef __linux__
+    do {
+        for(n = 0; n < UDP_BATCH; n++) {
+            ids[n] = UDP_AllocPacket();
+            if(ids[n] == -1) {
+                break;
+            }
+            iov[n].iov_base = udp_packets[ids[n]].data;
+            iov[n].iov_len = NET_DATAGRAMSIZE;
+            memset(&msgs[n].msg_hdr, 0, sizeof(msgs[n].msg_hdr));
+            msgs[n].msg_hdr.msg_name = &udp_packets[ids[n]].addr;
+            msgs[n].msg_hdr.msg_namelen = sizeof(struct qsockaddr);
+            msgs[n].msg_hdr.msg_iov = &iov[n];
+            msgs[n].msg_hdr.msg_iovlen = 1;
+        }
+
+        got = n ? recvmmsg(fd, msgs, n, MSG_DONTWAIT, NULL) : 0;
+        if(got < 0) {
+            got = 0;
+        }
+
+        for(i = 0; i < got; i++) {
+            udp_packets[ids[i]].length = msgs[i].msg_len;
+            UDP_QueuePacket(owner, ids[i]);
+        }
+        for(i = n - 1; i >= got; i--) {
+            UDP_FreePacket(ids[i]);
+        }
+    } while(got == UDP_BATCH);
+#else
+    while((p = UDP_AllocPacket()) != -1) {
+        addrlen = sizeof(struct qsockaddr);
+        udp_packets[p].length = recvfrom(fd, udp_packets[p].data, NET_DATAGRAMSIZE, 0,
+                                         (struct sockaddr *)&udp_packets[p].addr, &addrlen);
+        if(udp_packets[p].length < 0) {
+            UDP_FreePacket(p);
+            break;
+        }
+        UDP_QueuePacket(owner, p);
+    }
+#endif
+}
+
+/*
+===================
+UDP_Flush
+
+Sends the writes held back while batching
+===================
+*/
+static void UDP_Flush(void) {
+    int i;
+#ifdef __linux__
+    struct mmsghdr msgs[UDP_BATCH];
+    struct iovec iov[UDP_BATCH];
+    int n, sent;
+#endif
+
+    if(!udp_numsends) {
+        return;
+    }
+
+#ifdef __linux__
+    for(i = 0; i < udp_numsends; i++) {
+        iov[i].iov_base = udp_sends[i].data;
+        iov[i].iov_len = udp_sends[i].length;
+        memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+        msgs[i].msg_hdr.msg_name = &udp_sends[i].addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct qsockaddr);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // one call for each run of writes to the same socket
+    for(i = 0; i < udp_numsends; i += n) {
+        for(n = 1; i + n < udp_numsends && udp_sends[i + n].fd == udp_sends[i].fd; n++) {
+        }
+        sent = sendmmsg(udp_sends[i].fd, msgs + i, n, 0);
+        if(sent < n) {
+            n = (sent > 0 ? sent : 0) + 1;    // skip the one that failed
+        }
+    }
+#else
+    for(i = 0; i < udp_numsends; i++) {
+        sendto(udp_sends[i].fd, udp_sends[i].data, udp_sends[i].length, 0,
+               (struct sockaddr *)&udp_sends[i].addr, sizeof(struct qsockaddr));
+    }
+#endif
+
+    udp_numsends = 0;
+}
+
+/*
+===================
+UDP_Batch
+===================
+*/
+void UDP_Batch(qboolean state) {
+    int i;
+
+    if(!state) {
+        UDP_Flush();
+        udp_batching = false;
+        return;
+    }
+
+    for(i = 0; i < UDP_MAXSOCKETS; i++) {
+        if(udp_sockets[i].used && udp_sockets[i].owner == i) {
+            UDP_Receive(i);
+        }
+    }
+    udp_batching = true;
+}
+
+//=============================================================================
+
+int UDP_Init(void) {
+    struct hostent *local;
+    char buff[MAXHOSTNAMELEN];
+    struct qsockaddr addr;
+    char *colon;
+    int i;
+
+    if(COM_CheckParm("-noudp")) {
+        return -1;
+    }
+
+    for(i = 0; i < UDP_PACKETS; i++) {
+        udp_packets[i].next = i + 1;
+    }
+    udp_packets[UDP_PACKETS - 1].next = -1;
+    udp_freepackets = 0;
+
+    // determine my name & address
+    myAddr = htonl(INADDR_LOOPBACK);
+    if(gethostname(buff, MAXHOSTNAMELEN) == 0) {
+        buff[MAXHOSTNAMELEN - 1] = 0;
+        local = gethostbyname(buff);
+        if(local && local->h_addrtype == AF_INET && local->h_addr_list[0]) {
+            myAddr = *(in_addr_t *)local->h_addr_list[0];
+        }
+
+        // if the quake hostname isn't set, set it to the machine name
+        if(Q_strcmp(hostname.string, "UNNAMED") == 0) {
+            buff[15] = 0;
+            Cvar_Set("hostname", buff);
+        }
+    }
+
+    if((net_controlsocket = UDP_OpenSocket(0)) == -1) {
+        Con_Printf("UDP_Init: Unable to open control socket\n");
+        return -1;
+    }
+
+    i = 1;
+    setsockopt(udp_sockets[net_controlsocket].fd, SOL_SOCKET, SO_BROADCAST, (char *)&i, sizeof(i));
+
+    memset(&broadcastaddr, 0, sizeof(broadcastaddr));
+    ((struct sockaddr_in *)&broadcastaddr)->sin_family = AF_INET;
+    ((struct sockaddr_in *)&broadcastaddr)->sin_addr.s_addr = INADDR_BROADCAST;
+    ((struct sockaddr_in *)&broadcastaddr)->sin_port = htons(net_hostport);
+
+    UDP_GetSocketAddr(net_controlsocket, &addr);
+    Q_strcpy(my_tcpip_address, UDP_AddrToString(&addr));
+    colon = Q_strrchr(my_tcpip_address, ':');
+    if(colon) {
+        *colon = 0;
+    }
+
+    Con_Printf("UDP Initialized\n");
+    tcpipAvailable = true;
+
+    return net_controlsocket;
+}
+
+void UDP_Shutdown(void) {
+    UDP_Flush();
+    UDP_Listen(false);
+    UDP_CloseSocket(net_controlsocket);
+}
+
+void UDP_Listen(qboolean state) {
+    struct qsockaddr addr;
+    int i;
+
+    // enable listening
+    if(state) {
+        if(net_acceptsocket != -1) {
+            return;
+        }
+
+        // clients still connected keep the old accept socket bound
+        for(i = 0; i < UDP_MAXSOCKETS; i++) {
+            if(udp_sockets[i].used && !udp_sockets[i].open && udp_sockets[i].owner == i) {
+                UDP_GetSocketAddr(i, &addr);
+                if(UDP_GetSocketPort(&addr) == net_hostport) {
+                    udp_sockets[i].open = true;
+                    udp_sockets[i].users++;
+                    net_acceptsocket = i;
+                    return;
+                }
+            }
+        }
+
+        if((net_acceptsocket = UDP_OpenSocket(net_hostport)) == -1) {
+            Sys_Error("UDP_Listen: Unable to open accept socket\n");
+        }
+        return;
+    }
+
+    // disable listening
+    if(net_acceptsocket == -1) {
+        return;
+    }
+    UDP_CloseSocket(net_acceptsocket);
+    net_acceptsocket = -1;
+}
+
+static int UDP_NewSlot(void) {
+    udpsocket_t *s;
+    int i;
+
+    for(i = 0, s = udp_sockets; i < UDP_MAXSOCKETS; i++, s++) {
+        if(!s->used) {
+            memset(s, 0, sizeof(*s));
+            s->used = true;
+            s->open = true;
+            return i;
+        }
+    }
+
+    Con_Printf("UDP: out of sockets\n");
+    return -1;
+}
+
+int UDP_OpenSocket(int port) {
+    int newsocket;
+    struct sockaddr_in address;
+    int slot;
+
+    if((newsocket = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP)) == -1) {
+        return -1;
+    }
+
+    if(fcntl(newsocket, F_SETFL, fcntl(newsocket, F_GETFL, 0) | O_NONBLOCK) == -1) {
+        goto ErrorReturn;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+    if(bind(newsocket, (struct sockaddr *)&address, sizeof(address)) == -1) {
+        goto ErrorReturn;
+    }
+
+    slot = UDP_NewSlot();
+    if(slot == -1) {
+        goto ErrorReturn;
+    }
+    udp_sockets[slot].fd = newsocket;
+    udp_sockets[slot].owner = slot;
+    udp_sockets[slot].users = 1;
+    return slot;
+
+    ErrorReturn:
+    close(newsocket);
+    return -1;
+}
+
+/*
+===================
+UDP_OpenSharedSocket
+
+Opens a slot that talks through the socket of another one
+===================
+*/
+int UDP_OpenSharedSocket(int socket) {
+    udpsocket_t *owner;
+    int slot;
+
+    owner = &udp_sockets[udp_sockets[socket].owner];
+    slot = UDP_NewSlot();
+    if(slot == -1) {
+        return -1;
+    }
+    udp_sockets[slot].fd = owner->fd;
+    udp_sockets[slot].owner = owner - udp_sockets;
+    owner->users++;
+    return slot;
+}
+
+int UDP_CloseSocket(int socket) {
+    udpsocket_t *s, *owner;
+    int p, ret;
+
+    s = &udp_sockets[socket];
+    while(s->count) {
+        p = s->head;
+        s->head = udp_packets[p].next;
+        s->count--;
+        UDP_FreePacket(p);
+    }
+    s->open = false;
+    s->connected = false;
+
+    owner = &udp_sockets[s->owner];
+    if(s != owner) {
+        s->used = false;
+    }
+
+    if(--owner->users) {
+        return 0;
+    }
+
+    UDP_Flush();
+    ret = close(owner->fd);
+    owner->used = false;
+    return ret;
+}
+
+int UDP_Connect(int socket, struct qsockaddr *addr) {
+    udp_sockets[socket].addr = *addr;
+    udp_sockets[socket].connected = true;
+    return 0;
+}
+
+int UDP_CheckNewConnections(void) {
+    if(net_acceptsocket == -1) {
+        return -1;
+    }
+
+    if(!udp_sockets[net_acceptsocket].count && !udp_batching) {
+        UDP_Receive(net_acceptsocket);
+    }
+    if(udp_sockets[net_acceptsocket].count) {
+        return net_acceptsocket;
+    }
+    return -1;
+}
+
+int UDP_Read(int socket, byte *buf, int len, struct qsockaddr *addr) {
+    udpsocket_t *s;
+    udppacket_t *packet;
+    int p;
+
+    s = &udp_sockets[socket];
+    if(!s->count && !udp_batching) {
+        UDP_Receive(s->owner);
+    }
+    if(!s->count) {
+        return 0;
+    }
+
+    p = s->head;
+    packet = &udp_packets[p];
+    s->head = packet->next;
+    s->count--;
+
+    if(len > packet->length) {
+        len = packet->length;
+    }
+    Q_memcpy(buf, packet->data, len);
+    *addr = packet->addr;
+    UDP_FreePacket(p);
+
+    return len;
+}
+
+int UDP_Broadcast(int socket, byte *buf, int len) {
+    return UDP_Write(socket, buf, len, &broadcastaddr);
+}
+
+int UDP_Write(int socket, byte *buf, int len, struct qsockaddr *addr) {
+    int ret;
+
+    if(len > NET_DATAGRAMSIZE) {
+        return -1;
+    }
+
+    if(udp_batching) {
+        if(udp_numsends == UDP_BATCH) {
+            UDP_Flush();
+        }
+        udp_sends[udp_numsends].fd = udp_sockets[socket].fd;
+        udp_sends[udp_numsends].length = len;
+        udp_sends[udp_numsends].addr = *addr;
+        Q_memcpy(udp_sends[udp_numsends].data, buf, len);
+        udp_numsends++;
+        return len;
+    }
+
+    ret = sendto(udp_sockets[socket].fd, buf, len, 0, (struct sockaddr *)addr, sizeof(struct qsockaddr));
+    if(ret == -1 && (errno == EWOULDBLOCK || errno == EAGAIN || errno == ECONNREFUSED)) {
+        return 0;
+    }
+    return ret;
+}
+
+char *UDP_AddrToString(struct qsockaddr *addr) {
+    static char buffer[22];
+    int haddr;
+
+    haddr = ntohl(((struct sockaddr_in *)addr)->sin_addr.s_addr);
+    snprintf(buffer, sizeof(buffer), "%d.%d.%d.%d:%d", (haddr >> 24) & 0xff, (haddr >> 16) & 0xff,
+             (haddr >> 8) & 0xff, haddr & 0xff, ntohs(((struct sockaddr_in *)addr)->sin_port));
+    return buffer;
+}
+
+int UDP_StringToAddr(char *string, struct qsockaddr *addr) {
+    int ha1, ha2, ha3, ha4, hp;
+    int ipaddr;
+
+    if(sscanf(string, "%d.%d.%d.%d:%d", &ha1, &ha2, &ha3, &ha4, &hp) != 5) {
+        return -1;
+    }
+    ipaddr = (ha1 << 24) | (ha2 << 16) | (ha3 << 8) | ha4;
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sa_family = AF_INET;
+    ((struct sockaddr_in *)addr)->sin_addr.s_addr = htonl(ipaddr);
+    ((struct sockaddr_in *)addr)->sin_port = htons(hp);
+    return 0;
+}
+
+int UDP_GetSocketAddr(int socket, struct qsockaddr *addr) {
+    socklen_t addrlen = sizeof(struct qsockaddr);
+    in_addr_t a;
+
+    memset(addr, 0, sizeof(struct qsockaddr));
+    getsockname(udp_sockets[socket].fd, (struct sockaddr *)addr, &addrlen);
+    a = ((struct sockaddr_in *)addr)->sin_addr.s_addr;
+    if(a == 0 || a == htonl(INADDR_LOOPBACK)) {
+        ((struct sockaddr_in *)addr)->sin_addr.s_addr = myAddr;
+    }
+
+    return 0;
+}
+
+int UDP_GetNameFromAddr(struct qsockaddr *addr, char *name) {
+    char host[NI_MAXHOST];
+
+    if(getnameinfo((struct sockaddr *)addr, sizeof(struct sockaddr_in), host, sizeof(host), NULL, 0,
+                   NI_NAMEREQD) == 0) {
+        Q_strncpy(name, host, NET_NAMELEN - 1);
+        name[NET_NAMELEN - 1] = 0;
+        return 0;
+    }
+
+    Q_strcpy(name, UDP_AddrToString(addr));
+    return 0;
+}
+
+/*
+===================
+PartialIPAddress
+
+Fills in the missing leading parts of a dotted address from ours, so
+"connect .42" finds a server on the same subnet
+===================
+*/
+static int PartialIPAddress(char *in, struct qsockaddr *hostaddr) {
+    char buff[256];
+    char *b;
+    int addr;
+    int num;
+    int mask;
+    int run;
+    int port;
+
+    buff[0] = '.';
+    Q_strncpy(buff + 1, in, sizeof(buff) - 2);
+    buff[sizeof(buff) - 1] = 0;
+    b = buff;
+    if(buff[1] == '.') {
+        b++;
+    }
+
+    addr = 0;
+    mask = -1;
+    while(*b == '.') {
+        b++;
+        num = 0;
+        run = 0;
+        while(!(*b < '0' || *b > '9')) {
+            num = num * 10 + *b++ - '0';
+            if(++run > 3) {
+                return -1;
+            }
+        }
+        if((*b < '0' || *b > '9') && *b != '.' && *b != ':' && *b != 0) {
+            return -1;
+        }
+        if(num < 0 || num > 255) {
+            return -1;
+        }
+        mask <<= 8;
+        addr = (addr << 8) + num;
+    }
+
+    if(*b++ == ':') {
+        port = Q_atoi(b);
+    } else {
+        port = net_hostport;
+    }
+
+    memset(hostaddr, 0, sizeof(*hostaddr));
+    hostaddr->sa_family = AF_INET;
+    ((struct sockaddr_in *)hostaddr)->sin_port = htons((unsigned short)port);
+    ((struct sockaddr_in *)hostaddr)->sin_addr.s_addr = (myAddr & htonl(mask)) | htonl(addr);
+
+    return 0;
+}
+
+int UDP_GetAddrFromName(char *name, struct qsockaddr *addr) {
+    struct hostent *hostentry;
+    char host[NET_NAMELEN];
+    char *colon;
+    int port;
+
+    if(name[0] >= '0' && name[0] <= '9') {
+        return PartialIPAddress(name, addr);
+    }
+
+    // a name can carry a port as well
+    Q_strncpy(host, name, sizeof(host) - 1);
+    host[sizeof(host) - 1] = 0;
+    port = net_hostport;
+    colon = Q_strrchr(host, ':');
+    if(colon) {
+        *colon = 0;
+        port = Q_atoi(colon + 1);
+    }
+
+    hostentry = gethostbyname(host);
+    if(!hostentry || hostentry->h_addrtype != AF_INET) {
+        return -1;
+    }
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sa_family = AF_INET;
+    ((struct sockaddr_in *)addr)->sin_port = htons((unsigned short)port);
+    ((struct sockaddr_in *)addr)->sin_addr.s_addr = *(in_addr_t *)hostentry->h_addr_list[0];
+
+    return 0;
+}
+
+int UDP_AddrCompare(struct qsockaddr *addr1, struct qsockaddr *addr2) {
+    if(addr1->sa_family != addr2->sa_family) {
+        return -1;
+    }
+
+    if(((struct sockaddr_in *)addr1)->sin_addr.s_addr != ((struct sockaddr_in *)addr2)->sin_addr.s_addr) {
+        return -1;
+    }
+
+    if(((struct sockaddr_in *)addr1)->sin_port != ((struct sockaddr_in *)addr2)->sin_port) {
+        return 1;
+    }
+
+    return 0;
+}
+
+int UDP_GetSocketPort(struct qsockaddr *addr) {
+    return ntohs(((struct sockaddr_in *)addr)->sin_port);
+}
+
+int UDP_SetSocketPort(struct qsockaddr *addr, int port) {
+    ((struct sockaddr_in *)addr)->sin_port = htons((unsigned short)port);
+    return 0;
+}
+
+#endif // POSIX
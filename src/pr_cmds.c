@@ -819,6 +819,7 @@ findradius (origin, radius)
 =================
 */
 void PF_findradius(void) {
+    static unsigned int hits[(MAX_EDICTS + 31) / 32];
     edict_t *ent, *chain;
     float rad;
     float *org;
@@ -830,8 +831,20 @@ void PF_findradius(void) {
     org = G_VECTOR(OFS_PARM0);
     rad = G_FLOAT(OFS_PARM1);
 
-    ent = NEXT_EDICT(sv.edicts);
-    for(i = 1; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent)) {
+// only test the entities the area nodes put near org, in entity order so
+// the chain comes out the same as a full scan
+    memset (hits, 0, (sv.num_edicts + 31) / 32 * sizeof(hits[0]));
+    SV_FindRadius(org, rad, hits);
+
+    for(i = 1; i < sv.num_edicts; i++) {
+        if(!hits[i >> 5]) {
+            i |= 31;
+            continue;
+        }
+        if(!(hits[i >> 5] & (1u << (i & 31)))) {
+            continue;
+        }
+        ent = EDICT_NUM(i);
         if(ent->free) {
             continue;
         }
@@ -913,13 +926,13 @@ void PF_Find(void) {
         PR_RunError("PF_Find: bad search string");
     }
 
-    for(e++; e < sv.num_edicts; e++) {
-        ed = EDICT_NUM(e);
+    for(e++, ed = EDICT_NUM(e - 1); e < sv.num_edicts; e++) {
+        ed = NEXT_EDICT(ed);
         if(ed->free) {
             continue;
         }
         t = E_STRING(ed, f);
-        if(!t) {
+        if(!t || t[0] != s[0]) {
             continue;
         }
         if(!strcmp(t, s)) {
@@ -1165,13 +1178,14 @@ void PF_nextent(void) {
     edict_t *ent;
 
     i = G_EDICTNUM(OFS_PARM0);
+    ent = G_EDICT(OFS_PARM0);
     while(1) {
         i++;
-        if(i == sv.num_edicts) {
+        if(i >= sv.num_edicts) {
             RETURN_EDICT(sv.edicts);
             return;
         }
-        ent = EDICT_NUM(i);
+        ent = NEXT_EDICT(ent);
         if(!ent->free) {
             RETURN_EDICT(ent);
             return;
@@ -24,6 +24,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "host.h"
 #include "pr_edict.h"
 #include "pr_exec.h"
+#include "pr_native.h"
+#include "pr_timing.h"
 #include "zone.h"
 
 dprograms_t *progs;
@@ -62,15 +64,23 @@ cvar_t saved2 = { "saved2", "0", true };
 cvar_t saved3 = { "saved3", "0", true };
 cvar_t saved4 = { "saved4", "0", true };
 
-#define    MAX_FIELD_LEN    64
-#define GEFV_CACHESIZE    2
+// name lookup tables, rebuilt by PR_LoadProgs
+typedef struct {
+    unsigned int hash;
+    int name;
+    int index;          // + 1, 0 is an empty slot
+} prhashslot_t;
 
 typedef struct {
-    ddef_t *pcache;
-    char field[MAX_FIELD_LEN];
-} gefv_cache;
+    prhashslot_t *slots;
+    int mask;
+} prhash_t;
+
+static prhash_t pr_fieldhash;
+static prhash_t pr_globalhash;
+static prhash_t pr_functionhash;
 
-static gefv_cache gefvCache[GEFV_CACHESIZE] = {{ NULL, "" }, { NULL, "" }};
+static int pr_loadcount;    // bumped every time progs.dat is loaded
 
 /*
 =================
@@ -186,79 +196,133 @@ ddef_t *ED_FieldAtOfs(int ofs) {
 
 /*
 ============
-ED_FindField
+ED_HashFind
+
+Returns the index of the first entry called name, or -1
 ============
 */
-ddef_t *ED_FindField(char *name) {
-    ddef_t *def;
+static int ED_HashFind(prhash_t *table, char *name) {
+    prhashslot_t *slot;
+    unsigned int hash;
     int i;
 
-    for(i = 0; i < progs->numfielddefs; i++) {
-        def = &pr_fielddefs[i];
-        if(!strcmp(PR_GetString(def->s_name), name)) {
-            return def;
+    hash = COM_HashString(name);
+    for(i = hash & table->mask; table->slots[i].index; i = (i + 1) & table->mask) {
+        slot = &table->slots[i];
+        if(slot->hash == hash && !strcmp(PR_GetString(slot->name), name)) {
+            return slot->index - 1;
         }
     }
-    return NULL;
+    return -1;
 }
 
 /*
 ============
-ED_FindGlobal
+ED_HashAdd
+
+Later entries with the same name are left out, so lookups find the same
+entry a linear search would
 ============
 */
-ddef_t *ED_FindGlobal(char *name) {
-    ddef_t *def;
+static void ED_HashAdd(prhash_t *table, int name, int index) {
+    prhashslot_t *slot;
+    unsigned int hash;
     int i;
 
-    for(i = 0; i < progs->numglobaldefs; i++) {
-        def = &pr_globaldefs[i];
-        if(!strcmp(PR_GetString(def->s_name), name)) {
-            return def;
+    hash = COM_HashString(PR_GetString(name));
+    for(i = hash & table->mask; table->slots[i].index; i = (i + 1) & table->mask) {
+        slot = &table->slots[i];
+        if(slot->hash == hash && !strcmp(PR_GetString(slot->name), PR_GetString(name))) {
+            return;
         }
     }
-    return NULL;
+
+    table->slots[i].hash = hash;
+    table->slots[i].name = name;
+    table->slots[i].index = index + 1;
 }
 
 /*
 ============
-ED_FindFunction
+ED_HashAlloc
 ============
 */
-dfunction_t *ED_FindFunction(char *name) {
-    dfunction_t *func;
-    int i;
+static void ED_HashAlloc(prhash_t *table, int count, char *name) {
+    int size;
 
-    for(i = 0; i < progs->numfunctions; i++) {
-        func = &pr_functions[i];
-        if(!strcmp(PR_GetString(func->s_name), name)) {
-            return func;
-        }
+    for(size = 16; size < count * 2; size <<= 1) {
     }
-    return NULL;
+
+    table->slots = Hunk_AllocName(size * sizeof(prhashslot_t), name);
+    table->mask = size - 1;
 }
 
-eval_t *GetEdictFieldValue(edict_t *ed, char *field) {
-    ddef_t *def = NULL;
+/*
+============
+ED_BuildHashes
+
+Called by PR_LoadProgs once the defs have been byte swapped
+============
+*/
+static void ED_BuildHashes(void) {
     int i;
-    static int rep = 0;
 
-    for(i = 0; i < GEFV_CACHESIZE; i++) {
-        if(!strcmp(field, gefvCache[i].field)) {
-            def = gefvCache[i].pcache;
-            goto Done;
-        }
+    ED_HashAlloc(&pr_fieldhash, progs->numfielddefs, "fieldhash");
+    for(i = 0; i < progs->numfielddefs; i++) {
+        ED_HashAdd(&pr_fieldhash, pr_fielddefs[i].s_name, i);
     }
 
-    def = ED_FindField(field);
+    ED_HashAlloc(&pr_globalhash, progs->numglobaldefs, "globhash");
+    for(i = 0; i < progs->numglobaldefs; i++) {
+        ED_HashAdd(&pr_globalhash, pr_globaldefs[i].s_name, i);
+    }
 
-    if(strlen(field) < MAX_FIELD_LEN) {
-        gefvCache[rep].pcache = def;
-        strcpy (gefvCache[rep].field, field);
-        rep ^= 1;
+    ED_HashAlloc(&pr_functionhash, progs->numfunctions, "funchash");
+    for(i = 0; i < progs->numfunctions; i++) {
+        ED_HashAdd(&pr_functionhash, pr_functions[i].s_name, i);
     }
+}
 
-    Done:
+/*
+============
+ED_FindField
+============
+*/
+ddef_t *ED_FindField(char *name) {
+    int i;
+
+    i = ED_HashFind(&pr_fieldhash, name);
+    return i < 0 ? NULL : &pr_fielddefs[i];
+}
+
+/*
+============
+ED_FindGlobal
+============
+*/
+ddef_t *ED_FindGlobal(char *name) {
+    int i;
+
+    i = ED_HashFind(&pr_globalhash, name);
+    return i < 0 ? NULL : &pr_globaldefs[i];
+}
+
+/*
+============
+ED_FindFunction
+============
+*/
+dfunction_t *ED_FindFunction(char *name) {
+    int i;
+
+    i = ED_HashFind(&pr_functionhash, name);
+    return i < 0 ? NULL : &pr_functions[i];
+}
+
+eval_t *GetEdictFieldValue(edict_t *ed, char *field) {
+    ddef_t *def;
+
+    def = ED_FindField(field);
     if(!def) {
         return NULL;
     }
@@ -266,6 +330,29 @@ eval_t *GetEdictFieldValue(edict_t *ed, char *field) {
     return (eval_t *)((char *)&ed->v + def->ofs * 4);
 }
 
+/*
+============
+GetEdictField
+
+Like GetEdictFieldValue, but the lookup is only done once per progs.dat
+============
+*/
+eval_t *GetEdictField(edict_t *ed, edictfield_t *field) {
+    ddef_t *def;
+
+    if(field->loadcount != pr_loadcount) {
+        def = ED_FindField(field->name);
+        field->ofs = def ? def->ofs : -1;
+        field->loadcount = pr_loadcount;
+    }
+
+    if(field->ofs < 0) {
+        return NULL;
+    }
+
+    return (eval_t *)((int *)&ed->v + field->ofs);
+}
+
 /*
 ============
 PR_ValueString
@@ -800,6 +887,8 @@ char *ED_ParseEdict(char *data, edict_t *ent) {
     if(ent != sv.edicts)    // hack
         memset (&ent->v, 0, progs->entityfields * 4);
 
+    SV_MarkLoose(ent);        // until it's linked
+
 // go through all the dictionary pairs
     while(1) {
         // parse key
@@ -967,10 +1056,8 @@ PR_LoadProgs
 void PR_LoadProgs(void) {
     int i;
 
-// flush the non-C variable lookup cache
-    for(i = 0; i < GEFV_CACHESIZE; i++) {
-        gefvCache[i].field[0] = 0;
-    }
+// invalidate the engine's field lookups
+    pr_loadcount++;
 
     CRC_Init(&pr_crc);
 
@@ -1052,6 +1139,11 @@ void PR_LoadProgs(void) {
     for(i = 0; i < progs->numglobals; i++) {
         ((int *)pr_globals)[i] = LittleLong(((int *)pr_globals)[i]);
     }
+
+    ED_BuildHashes();
+    PR_TranslateProgs();
+    PR_TimingClear();
+    PR_BindNative();
 }
 
 /*
@@ -1064,6 +1156,10 @@ void PR_Init(void) {
     Cmd_AddCommand("edicts", ED_PrintEdicts);
     Cmd_AddCommand("edictcount", ED_Count);
     Cmd_AddCommand("profile", PR_Profile_f);
+    Cvar_RegisterVariable(&pr_threaded);
+    Cvar_RegisterVariable(&pr_optimize);
+    PR_NativeInit();
+    PR_TimingInit();
     Cvar_RegisterVariable(&nomonsters);
     Cvar_RegisterVariable(&gamecfg);
     Cvar_RegisterVariable(&scratch1);
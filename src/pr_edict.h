@@ -36,7 +36,16 @@ void ED_PrintNum(int ent);
 void ED_Write(FILE *f, edict_t *ed);
 void ED_WriteGlobals(FILE *f);
 
+// a field engine code reads if progs.dat has it, looked up by name once
+// per progs.dat load: static edictfield_t ef_gravity = { "gravity" };
+typedef struct {
+    char *name;
+    int ofs;            // in ints, -1 if progs.dat has no such field
+    int loadcount;
+} edictfield_t;
+
 eval_t *GetEdictFieldValue(edict_t *ed, char *field);
+eval_t *GetEdictField(edict_t *ed, edictfield_t *field);
 
 char* PR_GetString(int offset);
 void PR_Init(void);
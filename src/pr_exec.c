@@ -18,10 +18,15 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
+#include <stddef.h>
+
 #include "quakedef.h"
 
 #include "host.h"
 #include "pr_edict.h"
+#include "pr_exec.h"
+#include "pr_native.h"
+#include "pr_timing.h"
 
 typedef struct {
     int s;
@@ -42,6 +47,28 @@ int pr_xstatement;
 
 int pr_argc;
 
+cvar_t pr_threaded = { "pr_threaded", "1" };    // use the direct threaded engine when available
+cvar_t pr_optimize = { "pr_optimize", "1" };    // fuse and fold statements when progs.dat is threaded
+
+// what PR_TranslateProgs made of the loaded progs, for PR_Profile_f
+static int pr_numfused;
+static int pr_numfolded;
+
+#define PR_RUNAWAY      100000
+
+// stores through these fields can move an entity without relinking it
+#define PR_LINKFIELD(ofs)   ((unsigned)((ofs) - offsetof(entvars_t, absmin) / 4) < 12 || \
+                             (unsigned)((ofs) - offsetof(entvars_t, mins) / 4) < 6)
+// and these change what a trace hits without moving it
+#define PR_CLIPFIELD(ofs)   ((ofs) == offsetof(entvars_t, modelindex) / 4 || \
+                             (unsigned)((ofs) - offsetof(entvars_t, size) / 4) < 3 || \
+                             (ofs) == offsetof(entvars_t, owner) / 4 || (ofs) == offsetof(entvars_t, flags) / 4)
+#define PR_NUMOPS       (OP_BITOR + 1)
+
+#if defined(__GNUC__)
+#define PR_THREADED     // needs labels as values
+#endif
+
 char *pr_opnames[] = { "DONE",
 
         "MUL_F", "MUL_V", "MUL_FV", "MUL_VF",
@@ -163,6 +190,9 @@ void PR_Profile_f(void) {
     int num;
     int i;
 
+    Con_Printf("%i statements, %i after optimizing (%i pairs fused, %i folded)\n", progs->numstatements,
+               progs->numstatements - pr_numfused, pr_numfused, pr_numfolded);
+
     num = 0;
     do {
         max = 0;
@@ -254,6 +284,11 @@ int PR_EnterFunction(dfunction_t *f) {
     }
 
     pr_xfunction = f;
+
+    if(pr_timing_running) {
+        PR_TimingEnter(f - pr_functions);
+    }
+
     return f->first_statement - 1;    // offset the s++
 }
 
@@ -269,6 +304,10 @@ int PR_LeaveFunction(void) {
         Sys_Error("prog stack underflow");
     }
 
+    if(pr_timing_running) {
+        PR_TimingLeave();
+    }
+
 // restore locals from the stack
     c = pr_xfunction->locals;
     localstack_used -= c;
@@ -288,37 +327,20 @@ int PR_LeaveFunction(void) {
 
 /*
 ====================
-PR_ExecuteProgram
+PR_RunSwitch
+
+Executes statements from s + 1 until the stack unwinds to exitdepth,
+decoding each one through a switch
 ====================
 */
-void PR_ExecuteProgram(func_t fnum) {
+static void PR_RunSwitch(int s, int exitdepth, int runaway) {
     eval_t *a, *b, *c;
-    int s;
     dstatement_t *st;
-    dfunction_t *f, *newf;
-    int runaway;
+    dfunction_t *newf;
     int i;
     edict_t *ed;
-    int exitdepth;
     eval_t *ptr;
 
-    if(!fnum || fnum >= progs->numfunctions) {
-        if(pr_global_struct->self) {
-            ED_Print(PROG_TO_EDICT(pr_global_struct->self));
-        }
-        Host_Error("PR_ExecuteProgram: NULL function");
-    }
-
-    f = &pr_functions[fnum];
-
-    runaway = 100000;
-    pr_trace = false;
-
-// make a stack frame
-    exitdepth = pr_depth;
-
-    s = PR_EnterFunction(f);
-
     while(1) {
         s++;    // next statement
 
@@ -493,6 +515,11 @@ void PR_ExecuteProgram(func_t fnum) {
                     PR_RunError("assignment to world entity");
                 }
                 c->_int = (byte *)((int *)&ed->v + b->_int) - (byte *)sv.edicts;
+                if(PR_LINKFIELD(b->_int)) {
+                    SV_MarkLoose(ed);
+                } else if(PR_CLIPFIELD(b->_int)) {
+                    SV_EdictChanged(ed);
+                }
                 break;
 
             case OP_LOAD_F:
@@ -555,7 +582,12 @@ void PR_ExecuteProgram(func_t fnum) {
                     i = -newf->first_statement;
                     if(i >= pr_numbuiltins)
                         PR_RunError("Bad builtin call number");
-                    pr_builtins[i]();
+                    PR_CallBuiltin(a->function, i);
+                    break;
+                }
+
+                if(pr_nativefuncs && pr_nativefuncs[a->function] && pr_native.value) {
+                    PR_CallFunction(a->function);
                     break;
                 }
 
@@ -588,3 +620,900 @@ void PR_ExecuteProgram(func_t fnum) {
         }
     }
 }
+
+#ifdef PR_THREADED
+/*
+============================================================================
+Direct threaded execution
+
+PR_TranslateProgs turns every statement into a prthread_t holding the
+address of its handler inside PR_RunThreaded and its operands already
+resolved to global pointers, so each statement costs one indirect jump.
+
+Instead of bumping the profile and runaway counters per statement, the
+statements run since the last transfer of control are added up whenever
+execution jumps, calls or returns, which gives the same totals.  If a
+builtin turns on pr_trace, execution carries on in PR_RunSwitch so every
+statement can be printed.
+
+With pr_optimize set, common pairs of statements are fused: the first one
+gets a handler that runs both and jumps straight into the second one's
+code, saving an indirect jump.  Statements whose operands are all
+constants get their result computed up front.  Every statement keeps its
+own entry, so branches into the middle of a pair, error reports and the
+profile counts are unaffected.
+============================================================================
+*/
+
+// handlers that don't belong to a QuakeC opcode
+enum {
+    PR_OP_BAD = PR_NUMOPS,
+    PR_OP_NOP,
+    PR_OP_CONST,
+    PR_OP_LOAD_STORE,
+    PR_OP_LOAD_STORE_V,
+    PR_OP_LOAD_BRANCH,
+    PR_OP_ADDRESS_STOREP,
+    PR_OP_ADDRESS_STOREP_V,
+    PR_OP_EQ_F_BRANCH,
+    PR_OP_NE_F_BRANCH,
+    PR_OP_LE_BRANCH,
+    PR_OP_GE_BRANCH,
+    PR_OP_LT_BRANCH,
+    PR_OP_GT_BRANCH,
+    PR_OP_EQ_E_BRANCH,
+    PR_OP_NE_E_BRANCH,
+    PR_OP_NOT_F_BRANCH,
+    PR_OP_NOT_S_BRANCH,
+    PR_OP_NOT_ENT_BRANCH,
+    PR_OP_NOT_FNC_BRANCH,
+    PR_NUMTHREADOPS
+};
+
+typedef struct prthread_s {
+    void *handler;
+    eval_t *a, *b, *c;
+    struct prthread_s *jump;    // branch target
+    int op;
+    float k;                    // PR_OP_CONST result
+} prthread_t;
+
+static prthread_t *pr_threads;
+static void **pr_oplabels;
+
+static void PR_RunThreaded(int s, int exitdepth, int runaway);
+
+/*
+====================
+PR_FindConstants
+
+Flags the globals nothing can change once progs.dat is loaded: not written
+by any statement, not a local, not an engine global and not restored from
+savegames
+====================
+*/
+static void PR_FindConstants(byte *constant) {
+    dstatement_t *st;
+    dfunction_t *f;
+    ddef_t *def;
+    int i, ofs, size;
+
+    size = sizeof(globalvars_t) / 4;
+    memset(constant, 1, progs->numglobals);
+    memset(constant, 0, size < progs->numglobals ? size : progs->numglobals);
+
+    for(i = 0, f = pr_functions; i < progs->numfunctions; i++, f++) {
+        if(f->first_statement > 0 && f->parm_start + f->locals <= progs->numglobals) {
+            memset(constant + f->parm_start, 0, f->locals);
+        }
+    }
+
+    for(i = 0, def = pr_globaldefs; i < progs->numglobaldefs; i++, def++) {
+        if(def->type & DEF_SAVEGLOBAL) {
+            size = (def->type & ~DEF_SAVEGLOBAL) == ev_vector ? 3 : 1;
+            if(def->ofs + size <= progs->numglobals) {
+                memset(constant + def->ofs, 0, size);
+            }
+        }
+    }
+
+    for(i = 0, st = pr_statements; i < progs->numstatements; i++, st++) {
+        switch(st->op) {
+            case OP_STORE_F:
+            case OP_STORE_S:
+            case OP_STORE_ENT:
+            case OP_STORE_FLD:
+            case OP_STORE_FNC:
+                ofs = (unsigned short)st->b;
+                size = 1;
+                break;
+            case OP_STORE_V:
+                ofs = (unsigned short)st->b;
+                size = 3;
+                break;
+            case OP_ADD_V:
+            case OP_SUB_V:
+            case OP_MUL_FV:
+            case OP_MUL_VF:
+            case OP_LOAD_V:
+                ofs = (unsigned short)st->c;
+                size = 3;
+                break;
+            case OP_STOREP_F:
+            case OP_STOREP_V:
+            case OP_STOREP_S:
+            case OP_STOREP_ENT:
+            case OP_STOREP_FLD:
+            case OP_STOREP_FNC:
+            case OP_IF:
+            case OP_IFNOT:
+            case OP_GOTO:
+            case OP_STATE:
+            case OP_DONE:
+            case OP_RETURN:
+            case OP_CALL0:
+            case OP_CALL1:
+            case OP_CALL2:
+            case OP_CALL3:
+            case OP_CALL4:
+            case OP_CALL5:
+            case OP_CALL6:
+            case OP_CALL7:
+            case OP_CALL8:
+                continue;    // only write entities or reserved globals
+            default:
+                ofs = (unsigned short)st->c;
+                size = 1;
+                break;
+        }
+
+        while(size-- && ofs < progs->numglobals) {
+            constant[ofs++] = 0;
+        }
+    }
+}
+
+/*
+====================
+PR_FoldStatement
+
+Computes the result of a statement with constant operands the same way
+the handler would, returns false if it can't be folded
+====================
+*/
+static qboolean PR_FoldStatement(dstatement_t *st, byte *constant, float *k) {
+    eval_t *a, *b;
+
+    if((unsigned short)st->a >= progs->numglobals || !constant[(unsigned short)st->a]) {
+        return false;
+    }
+    a = (eval_t *)&pr_globals[(unsigned short)st->a];
+
+    if(st->op == OP_NOT_F) {
+        *k = !a->_float;
+        return true;
+    }
+
+    if((unsigned short)st->b >= progs->numglobals || !constant[(unsigned short)st->b]) {
+        return false;
+    }
+    b = (eval_t *)&pr_globals[(unsigned short)st->b];
+
+    switch(st->op) {
+        case OP_ADD_F: *k = a->_float + b->_float; break;
+        case OP_SUB_F: *k = a->_float - b->_float; break;
+        case OP_MUL_F: *k = a->_float * b->_float; break;
+        case OP_DIV_F: *k = a->_float / b->_float; break;
+        case OP_BITAND: *k = (int)a->_float & (int)b->_float; break;
+        case OP_BITOR: *k = (int)a->_float | (int)b->_float; break;
+        case OP_GE: *k = a->_float >= b->_float; break;
+        case OP_LE: *k = a->_float <= b->_float; break;
+        case OP_GT: *k = a->_float > b->_float; break;
+        case OP_LT: *k = a->_float < b->_float; break;
+        case OP_AND: *k = a->_float && b->_float; break;
+        case OP_OR: *k = a->_float || b->_float; break;
+        case OP_EQ_F: *k = a->_float == b->_float; break;
+        case OP_NE_F: *k = a->_float != b->_float; break;
+        default: return false;
+    }
+
+    return true;
+}
+
+/*
+====================
+PR_FuseStatements
+
+Returns the handler that runs both statements, or 0 if there is none
+====================
+*/
+static int PR_FuseStatements(int first, int second) {
+    if(second == OP_IF || second == OP_IFNOT) {
+        switch(first) {
+            case OP_LOAD_F:
+            case OP_LOAD_S:
+            case OP_LOAD_ENT:
+            case OP_LOAD_FLD:
+            case OP_LOAD_FNC: return PR_OP_LOAD_BRANCH;
+            case OP_EQ_F: return PR_OP_EQ_F_BRANCH;
+            case OP_NE_F: return PR_OP_NE_F_BRANCH;
+            case OP_LE: return PR_OP_LE_BRANCH;
+            case OP_GE: return PR_OP_GE_BRANCH;
+            case OP_LT: return PR_OP_LT_BRANCH;
+            case OP_GT: return PR_OP_GT_BRANCH;
+            case OP_EQ_E: return PR_OP_EQ_E_BRANCH;
+            case OP_NE_E: return PR_OP_NE_E_BRANCH;
+            case OP_NOT_F: return PR_OP_NOT_F_BRANCH;
+            case OP_NOT_S: return PR_OP_NOT_S_BRANCH;
+            case OP_NOT_ENT: return PR_OP_NOT_ENT_BRANCH;
+            case OP_NOT_FNC: return PR_OP_NOT_FNC_BRANCH;
+            default: return 0;
+        }
+    }
+
+    switch(first) {
+        case OP_LOAD_F:
+        case OP_LOAD_S:
+        case OP_LOAD_ENT:
+        case OP_LOAD_FLD:
+        case OP_LOAD_FNC:
+            if(second == OP_STORE_F || second == OP_STORE_S || second == OP_STORE_ENT ||
+               second == OP_STORE_FLD || second == OP_STORE_FNC) {
+                return PR_OP_LOAD_STORE;
+            }
+            return 0;
+        case OP_LOAD_V:
+            return second == OP_STORE_V ? PR_OP_LOAD_STORE_V : 0;
+        case OP_ADDRESS:
+            if(second == OP_STOREP_F || second == OP_STOREP_S || second == OP_STOREP_ENT ||
+               second == OP_STOREP_FLD || second == OP_STOREP_FNC) {
+                return PR_OP_ADDRESS_STOREP;
+            }
+            return second == OP_STOREP_V ? PR_OP_ADDRESS_STOREP_V : 0;
+        default:
+            return 0;
+    }
+}
+
+/*
+====================
+PR_TranslateProgs
+
+Called by PR_LoadProgs once the statements have been byte swapped
+====================
+*/
+void PR_TranslateProgs(void) {
+    dstatement_t *st;
+    prthread_t *t;
+    byte *constant;
+    int i, target, fused, mark;
+
+    pr_threads = NULL;
+    pr_numfused = 0;
+    pr_numfolded = 0;
+
+    if(!pr_oplabels) {
+        PR_RunThreaded(0, -1, 0);    // just fetches the handler table
+    }
+
+    mark = Hunk_LowMark();
+    t = Hunk_AllocName(progs->numstatements * sizeof(prthread_t), "progthrd");
+
+    for(i = 0, st = pr_statements; i < progs->numstatements; i++, st++) {
+        t[i].op = st->op;
+        t[i].handler = pr_oplabels[st->op < PR_NUMOPS ? st->op : PR_OP_BAD];
+        t[i].a = (eval_t *)&pr_globals[st->a];
+        t[i].b = (eval_t *)&pr_globals[st->b];
+        t[i].c = (eval_t *)&pr_globals[st->c];
+        t[i].jump = NULL;
+        t[i].k = 0;
+
+        if(st->op == OP_IF || st->op == OP_IFNOT || st->op == OP_GOTO) {
+            target = i + (st->op == OP_GOTO ? st->a : st->b);
+            if(target < 0 || target >= progs->numstatements) {
+                Con_DPrintf("PR_TranslateProgs: branch out of range at %i, not threading\n", i);
+                Hunk_FreeToLowMark(mark);
+                return;
+            }
+            t[i].jump = &t[target];
+        }
+    }
+
+    if(pr_optimize.value) {
+        mark = Hunk_LowMark();
+        constant = Hunk_AllocName(progs->numglobals, "progtemp");
+        PR_FindConstants(constant);
+
+        for(i = 0, st = pr_statements; i < progs->numstatements; i++, st++) {
+            if(st->op == OP_IF || st->op == OP_IFNOT) {
+                if((unsigned short)st->a < progs->numglobals && constant[(unsigned short)st->a]) {
+                    if((t[i].a->_int != 0) != (st->op == OP_IFNOT)) {
+                        t[i].handler = pr_oplabels[OP_GOTO];
+                    } else {
+                        t[i].handler = pr_oplabels[PR_OP_NOP];
+                    }
+                    pr_numfolded++;
+                }
+            } else if(PR_FoldStatement(st, constant, &t[i].k)) {
+                t[i].handler = pr_oplabels[PR_OP_CONST];
+                pr_numfolded++;
+            }
+        }
+
+        Hunk_FreeToLowMark(mark);
+
+        for(i = 0, st = pr_statements; i < progs->numstatements - 1; i++, st++) {
+            if(t[i].handler != pr_oplabels[st[0].op] || t[i + 1].handler != pr_oplabels[st[1].op]) {
+                continue;    // folded
+            }
+
+            fused = PR_FuseStatements(st[0].op, st[1].op);
+            if(fused) {
+                t[i].handler = pr_oplabels[fused];
+                pr_numfused++;
+                i++;
+                st++;
+            }
+        }
+
+        Con_DPrintf("PR_TranslateProgs: %i statements fused, %i folded\n", pr_numfused * 2, pr_numfolded);
+    }
+
+    pr_threads = t;
+}
+
+#define PR_NEXT         do { pc++; goto *pc->handler; } while(0)
+#define PR_GOTO(to)     do { pc = block = (to); goto *pc->handler; } while(0)
+#define PR_JUMP(to)     do { PR_COUNT(); PR_GOTO(to); } while(0)
+
+// charge the statements run since block, including pc, to the current function
+#define PR_COUNT()      do { \
+                            n = pc - block + 1; \
+                            pr_xfunction->profile += n; \
+                            if((runaway -= n) <= 0) { \
+                                pr_xstatement = pc - pr_threads; \
+                                PR_RunError("runaway loop error"); \
+                            } \
+                        } while(0)
+
+/*
+====================
+PR_RunThreaded
+
+Same contract as PR_RunSwitch.  Called with a negative exitdepth it only
+publishes its handler table for PR_TranslateProgs.
+====================
+*/
+static void PR_RunThreaded(int s, int exitdepth, int runaway) {
+    static void *labels[PR_NUMTHREADOPS] = {
+        [OP_DONE] = &&op_return,
+        [OP_MUL_F] = &&op_mul_f,
+        [OP_MUL_V] = &&op_mul_v,
+        [OP_MUL_FV] = &&op_mul_fv,
+        [OP_MUL_VF] = &&op_mul_vf,
+        [OP_DIV_F] = &&op_div_f,
+        [OP_ADD_F] = &&op_add_f,
+        [OP_ADD_V] = &&op_add_v,
+        [OP_SUB_F] = &&op_sub_f,
+        [OP_SUB_V] = &&op_sub_v,
+        [OP_EQ_F] = &&op_eq_f,
+        [OP_EQ_V] = &&op_eq_v,
+        [OP_EQ_S] = &&op_eq_s,
+        [OP_EQ_E] = &&op_eq_e,
+        [OP_EQ_FNC] = &&op_eq_fnc,
+        [OP_NE_F] = &&op_ne_f,
+        [OP_NE_V] = &&op_ne_v,
+        [OP_NE_S] = &&op_ne_s,
+        [OP_NE_E] = &&op_ne_e,
+        [OP_NE_FNC] = &&op_ne_fnc,
+        [OP_LE] = &&op_le,
+        [OP_GE] = &&op_ge,
+        [OP_LT] = &&op_lt,
+        [OP_GT] = &&op_gt,
+        [OP_LOAD_F] = &&op_load,
+        [OP_LOAD_V] = &&op_load_v,
+        [OP_LOAD_S] = &&op_load,
+        [OP_LOAD_ENT] = &&op_load,
+        [OP_LOAD_FLD] = &&op_load,
+        [OP_LOAD_FNC] = &&op_load,
+        [OP_ADDRESS] = &&op_address,
+        [OP_STORE_F] = &&op_store,
+        [OP_STORE_V] = &&op_store_v,
+        [OP_STORE_S] = &&op_store,
+        [OP_STORE_ENT] = &&op_store,
+        [OP_STORE_FLD] = &&op_store,
+        [OP_STORE_FNC] = &&op_store,
+        [OP_STOREP_F] = &&op_storep,
+        [OP_STOREP_V] = &&op_storep_v,
+        [OP_STOREP_S] = &&op_storep,
+        [OP_STOREP_ENT] = &&op_storep,
+        [OP_STOREP_FLD] = &&op_storep,
+        [OP_STOREP_FNC] = &&op_storep,
+        [OP_RETURN] = &&op_return,
+        [OP_NOT_F] = &&op_not_f,
+        [OP_NOT_V] = &&op_not_v,
+        [OP_NOT_S] = &&op_not_s,
+        [OP_NOT_ENT] = &&op_not_ent,
+        [OP_NOT_FNC] = &&op_not_fnc,
+        [OP_IF] = &&op_if,
+        [OP_IFNOT] = &&op_ifnot,
+        [OP_CALL0] = &&op_call,
+        [OP_CALL1] = &&op_call,
+        [OP_CALL2] = &&op_call,
+        [OP_CALL3] = &&op_call,
+        [OP_CALL4] = &&op_call,
+        [OP_CALL5] = &&op_call,
+        [OP_CALL6] = &&op_call,
+        [OP_CALL7] = &&op_call,
+        [OP_CALL8] = &&op_call,
+        [OP_STATE] = &&op_state,
+        [OP_GOTO] = &&op_goto,
+        [OP_AND] = &&op_and,
+        [OP_OR] = &&op_or,
+        [OP_BITAND] = &&op_bitand,
+        [OP_BITOR] = &&op_bitor,
+        [PR_OP_BAD] = &&op_bad,
+        [PR_OP_NOP] = &&op_nop,
+        [PR_OP_CONST] = &&op_const,
+        [PR_OP_LOAD_STORE] = &&op_load_store,
+        [PR_OP_LOAD_STORE_V] = &&op_load_store_v,
+        [PR_OP_LOAD_BRANCH] = &&op_load_branch,
+        [PR_OP_ADDRESS_STOREP] = &&op_address_storep,
+        [PR_OP_ADDRESS_STOREP_V] = &&op_address_storep_v,
+        [PR_OP_EQ_F_BRANCH] = &&op_eq_f_branch,
+        [PR_OP_NE_F_BRANCH] = &&op_ne_f_branch,
+        [PR_OP_LE_BRANCH] = &&op_le_branch,
+        [PR_OP_GE_BRANCH] = &&op_ge_branch,
+        [PR_OP_LT_BRANCH] = &&op_lt_branch,
+        [PR_OP_GT_BRANCH] = &&op_gt_branch,
+        [PR_OP_EQ_E_BRANCH] = &&op_eq_e_branch,
+        [PR_OP_NE_E_BRANCH] = &&op_ne_e_branch,
+        [PR_OP_NOT_F_BRANCH] = &&op_not_f_branch,
+        [PR_OP_NOT_S_BRANCH] = &&op_not_s_branch,
+        [PR_OP_NOT_ENT_BRANCH] = &&op_not_ent_branch,
+        [PR_OP_NOT_FNC_BRANCH] = &&op_not_fnc_branch
+    };
+    prthread_t *pc, *block;
+    dfunction_t *newf;
+    edict_t *ed;
+    eval_t *ptr;
+    int i, n;
+
+    if(exitdepth < 0) {
+        pr_oplabels = labels;
+        return;
+    }
+
+    pc = block = &pr_threads[s + 1];
+    goto *pc->handler;
+
+op_add_f:
+    pc->c->_float = pc->a->_float + pc->b->_float;
+    PR_NEXT;
+op_add_v:
+    pc->c->vector[0] = pc->a->vector[0] + pc->b->vector[0];
+    pc->c->vector[1] = pc->a->vector[1] + pc->b->vector[1];
+    pc->c->vector[2] = pc->a->vector[2] + pc->b->vector[2];
+    PR_NEXT;
+
+op_sub_f:
+    pc->c->_float = pc->a->_float - pc->b->_float;
+    PR_NEXT;
+op_sub_v:
+    pc->c->vector[0] = pc->a->vector[0] - pc->b->vector[0];
+    pc->c->vector[1] = pc->a->vector[1] - pc->b->vector[1];
+    pc->c->vector[2] = pc->a->vector[2] - pc->b->vector[2];
+    PR_NEXT;
+
+op_mul_f:
+    pc->c->_float = pc->a->_float * pc->b->_float;
+    PR_NEXT;
+op_mul_v:
+    pc->c->_float = pc->a->vector[0] * pc->b->vector[0] + pc->a->vector[1] * pc->b->vector[1] +
+                    pc->a->vector[2] * pc->b->vector[2];
+    PR_NEXT;
+op_mul_fv:
+    pc->c->vector[0] = pc->a->_float * pc->b->vector[0];
+    pc->c->vector[1] = pc->a->_float * pc->b->vector[1];
+    pc->c->vector[2] = pc->a->_float * pc->b->vector[2];
+    PR_NEXT;
+op_mul_vf:
+    pc->c->vector[0] = pc->b->_float * pc->a->vector[0];
+    pc->c->vector[1] = pc->b->_float * pc->a->vector[1];
+    pc->c->vector[2] = pc->b->_float * pc->a->vector[2];
+    PR_NEXT;
+
+op_div_f:
+    pc->c->_float = pc->a->_float / pc->b->_float;
+    PR_NEXT;
+
+op_bitand:
+    pc->c->_float = (int)pc->a->_float & (int)pc->b->_float;
+    PR_NEXT;
+op_bitor:
+    pc->c->_float = (int)pc->a->_float | (int)pc->b->_float;
+    PR_NEXT;
+
+op_ge:
+    pc->c->_float = pc->a->_float >= pc->b->_float;
+    PR_NEXT;
+op_le:
+    pc->c->_float = pc->a->_float <= pc->b->_float;
+    PR_NEXT;
+op_gt:
+    pc->c->_float = pc->a->_float > pc->b->_float;
+    PR_NEXT;
+op_lt:
+    pc->c->_float = pc->a->_float < pc->b->_float;
+    PR_NEXT;
+op_and:
+    pc->c->_float = pc->a->_float && pc->b->_float;
+    PR_NEXT;
+op_or:
+    pc->c->_float = pc->a->_float || pc->b->_float;
+    PR_NEXT;
+
+op_not_f:
+    pc->c->_float = !pc->a->_float;
+    PR_NEXT;
+op_not_v:
+    pc->c->_float = !pc->a->vector[0] && !pc->a->vector[1] && !pc->a->vector[2];
+    PR_NEXT;
+op_not_s:
+    pc->c->_float = !pc->a->string || !PR_GetString(pc->a->string);
+    PR_NEXT;
+op_not_fnc:
+    pc->c->_float = !pc->a->function;
+    PR_NEXT;
+op_not_ent:
+    pc->c->_float = (PROG_TO_EDICT(pc->a->edict) == sv.edicts);
+    PR_NEXT;
+
+op_eq_f:
+    pc->c->_float = pc->a->_float == pc->b->_float;
+    PR_NEXT;
+op_eq_v:
+    pc->c->_float = (pc->a->vector[0] == pc->b->vector[0]) && (pc->a->vector[1] == pc->b->vector[1]) &&
+                    (pc->a->vector[2] == pc->b->vector[2]);
+    PR_NEXT;
+op_eq_s:
+    pc->c->_float = !strcmp(PR_GetString(pc->a->string), PR_GetString(pc->b->string));
+    PR_NEXT;
+op_eq_e:
+    pc->c->_float = pc->a->_int == pc->b->_int;
+    PR_NEXT;
+op_eq_fnc:
+    pc->c->_float = pc->a->function == pc->b->function;
+    PR_NEXT;
+
+op_ne_f:
+    pc->c->_float = pc->a->_float != pc->b->_float;
+    PR_NEXT;
+op_ne_v:
+    pc->c->_float = (pc->a->vector[0] != pc->b->vector[0]) || (pc->a->vector[1] != pc->b->vector[1]) ||
+                    (pc->a->vector[2] != pc->b->vector[2]);
+    PR_NEXT;
+op_ne_s:
+    pc->c->_float = strcmp(PR_GetString(pc->a->string), PR_GetString(pc->b->string));
+    PR_NEXT;
+op_ne_e:
+    pc->c->_float = pc->a->_int != pc->b->_int;
+    PR_NEXT;
+op_ne_fnc:
+    pc->c->_float = pc->a->function != pc->b->function;
+    PR_NEXT;
+
+//==================
+op_store:
+    pc->b->_int = pc->a->_int;
+    PR_NEXT;
+op_store_v:
+    pc->b->vector[0] = pc->a->vector[0];
+    pc->b->vector[1] = pc->a->vector[1];
+    pc->b->vector[2] = pc->a->vector[2];
+    PR_NEXT;
+
+op_storep:
+    ptr = (eval_t *)((byte *)sv.edicts + pc->b->_int);
+    ptr->_int = pc->a->_int;
+    PR_NEXT;
+op_storep_v:
+    ptr = (eval_t *)((byte *)sv.edicts + pc->b->_int);
+    ptr->vector[0] = pc->a->vector[0];
+    ptr->vector[1] = pc->a->vector[1];
+    ptr->vector[2] = pc->a->vector[2];
+    PR_NEXT;
+
+op_address:
+    ed = PROG_TO_EDICT(pc->a->edict);
+#ifdef PARANOID
+    NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+    if(ed == (edict_t *)sv.edicts && sv.state == ss_active) {
+        pr_xstatement = pc - pr_threads;
+        PR_RunError("assignment to world entity");
+    }
+    pc->c->_int = (byte *)((int *)&ed->v + pc->b->_int) - (byte *)sv.edicts;
+    if(PR_LINKFIELD(pc->b->_int)) {
+        SV_MarkLoose(ed);
+    } else if(PR_CLIPFIELD(pc->b->_int)) {
+        SV_EdictChanged(ed);
+    }
+    PR_NEXT;
+
+op_load:
+    ed = PROG_TO_EDICT(pc->a->edict);
+#ifdef PARANOID
+    NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+    pc->c->_int = ((eval_t *)((int *)&ed->v + pc->b->_int))->_int;
+    PR_NEXT;
+op_load_v:
+    ed = PROG_TO_EDICT(pc->a->edict);
+#ifdef PARANOID
+    NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+    ptr = (eval_t *)((int *)&ed->v + pc->b->_int);
+    pc->c->vector[0] = ptr->vector[0];
+    pc->c->vector[1] = ptr->vector[1];
+    pc->c->vector[2] = ptr->vector[2];
+    PR_NEXT;
+
+//==================
+
+op_ifnot:
+    if(!pc->a->_int) {
+        PR_JUMP(pc->jump);
+    }
+    PR_NEXT;
+op_if:
+    if(pc->a->_int) {
+        PR_JUMP(pc->jump);
+    }
+    PR_NEXT;
+op_goto:
+    PR_JUMP(pc->jump);
+
+op_call:
+    pr_xstatement = pc - pr_threads;
+    pr_argc = pc->op - OP_CALL0;
+    if(!pc->a->function)
+        PR_RunError("NULL function");
+
+    newf = &pr_functions[pc->a->function];
+
+    if(newf->first_statement < 0) {    // negative statements are built in functions
+        i = -newf->first_statement;
+        if(i >= pr_numbuiltins)
+            PR_RunError("Bad builtin call number");
+        PR_CallBuiltin(pc->a->function, i);
+
+        if(pr_trace) {        // traceon, finish the job statement by statement
+            PR_COUNT();
+            PR_RunSwitch(pc - pr_threads, exitdepth, runaway);
+            return;
+        }
+        PR_NEXT;
+    }
+
+    PR_COUNT();
+    if(pr_nativefuncs && pr_nativefuncs[pc->a->function] && pr_native.value) {
+        PR_CallFunction(pc->a->function);
+        block = pc + 1;
+        PR_NEXT;
+    }
+    PR_GOTO(&pr_threads[PR_EnterFunction(newf) + 1]);
+
+op_return:
+    pr_globals[OFS_RETURN] = ((float *)pc->a)[0];
+    pr_globals[OFS_RETURN + 1] = ((float *)pc->a)[1];
+    pr_globals[OFS_RETURN + 2] = ((float *)pc->a)[2];
+
+    PR_COUNT();
+    s = PR_LeaveFunction();
+    if(pr_depth == exitdepth)
+        return;        // all done
+    PR_GOTO(&pr_threads[s + 1]);
+
+op_state:
+    ed = PROG_TO_EDICT(pr_global_struct->self);
+    ed->v.nextthink = pr_global_struct->time + 0.1;
+
+    if(pc->a->_float != ed->v.frame) {
+        ed->v.frame = pc->a->_float;
+    }
+    ed->v.think = pc->b->function;
+    PR_NEXT;
+
+op_bad:
+    pr_xstatement = pc - pr_threads;
+    PR_RunError("Bad opcode %i", pc->op);
+
+//==================
+// folded by PR_TranslateProgs
+
+op_nop:
+    PR_NEXT;
+op_const:
+    pc->c->_float = pc->k;
+    PR_NEXT;
+
+//==================
+// fused pairs, the first statement is run here and the second by its own
+// handler, reached without a dispatch
+
+op_load_store:
+    ed = PROG_TO_EDICT(pc->a->edict);
+#ifdef PARANOID
+    NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+    pc->c->_int = ((eval_t *)((int *)&ed->v + pc->b->_int))->_int;
+    pc++;
+    goto op_store;
+op_load_store_v:
+    ed = PROG_TO_EDICT(pc->a->edict);
+#ifdef PARANOID
+    NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+    ptr = (eval_t *)((int *)&ed->v + pc->b->_int);
+    pc->c->vector[0] = ptr->vector[0];
+    pc->c->vector[1] = ptr->vector[1];
+    pc->c->vector[2] = ptr->vector[2];
+    pc++;
+    goto op_store_v;
+op_load_branch:
+    ed = PROG_TO_EDICT(pc->a->edict);
+#ifdef PARANOID
+    NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+    pc->c->_int = ((eval_t *)((int *)&ed->v + pc->b->_int))->_int;
+    goto op_branch;
+
+op_address_storep:
+    ed = PROG_TO_EDICT(pc->a->edict);
+#ifdef PARANOID
+    NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+    if(ed == (edict_t *)sv.edicts && sv.state == ss_active) {
+        pr_xstatement = pc - pr_threads;
+        PR_RunError("assignment to world entity");
+    }
+    pc->c->_int = (byte *)((int *)&ed->v + pc->b->_int) - (byte *)sv.edicts;
+    if(PR_LINKFIELD(pc->b->_int)) {
+        SV_MarkLoose(ed);
+    } else if(PR_CLIPFIELD(pc->b->_int)) {
+        SV_EdictChanged(ed);
+    }
+    pc++;
+    goto op_storep;
+op_address_storep_v:
+    ed = PROG_TO_EDICT(pc->a->edict);
+#ifdef PARANOID
+    NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+    if(ed == (edict_t *)sv.edicts && sv.state == ss_active) {
+        pr_xstatement = pc - pr_threads;
+        PR_RunError("assignment to world entity");
+    }
+    pc->c->_int = (byte *)((int *)&ed->v + pc->b->_int) - (byte *)sv.edicts;
+    if(PR_LINKFIELD(pc->b->_int)) {
+        SV_MarkLoose(ed);
+    } else if(PR_CLIPFIELD(pc->b->_int)) {
+        SV_EdictChanged(ed);
+    }
+    pc++;
+    goto op_storep_v;
+
+op_eq_f_branch:
+    pc->c->_float = pc->a->_float == pc->b->_float;
+    goto op_branch;
+op_ne_f_branch:
+    pc->c->_float = pc->a->_float != pc->b->_float;
+    goto op_branch;
+op_le_branch:
+    pc->c->_float = pc->a->_float <= pc->b->_float;
+    goto op_branch;
+op_ge_branch:
+    pc->c->_float = pc->a->_float >= pc->b->_float;
+    goto op_branch;
+op_lt_branch:
+    pc->c->_float = pc->a->_float < pc->b->_float;
+    goto op_branch;
+op_gt_branch:
+    pc->c->_float = pc->a->_float > pc->b->_float;
+    goto op_branch;
+op_eq_e_branch:
+    pc->c->_float = pc->a->_int == pc->b->_int;
+    goto op_branch;
+op_ne_e_branch:
+    pc->c->_float = pc->a->_int != pc->b->_int;
+    goto op_branch;
+op_not_f_branch:
+    pc->c->_float = !pc->a->_float;
+    goto op_branch;
+op_not_s_branch:
+    pc->c->_float = !pc->a->string || !PR_GetString(pc->a->string);
+    goto op_branch;
+op_not_ent_branch:
+    pc->c->_float = (PROG_TO_EDICT(pc->a->edict) == sv.edicts);
+    goto op_branch;
+op_not_fnc_branch:
+    pc->c->_float = !pc->a->function;
+    goto op_branch;
+
+op_branch:    // the OP_IF or OP_IFNOT after a fused statement
+    pc++;
+    if((pc->a->_int != 0) != (pc->op == OP_IFNOT)) {
+        PR_JUMP(pc->jump);
+    }
+    PR_NEXT;
+}
+#else
+void PR_TranslateProgs(void) {
+}
+#endif // PR_THREADED
+
+/*
+====================
+PR_CallFunction
+
+Runs a QuakeC function to completion on top of the current stack, natively
+if progs_native provides it
+====================
+*/
+void PR_CallFunction(func_t fnum) {
+    dfunction_t *f;
+    int s;
+    int exitdepth;
+
+    f = &pr_functions[fnum];
+
+    if(pr_nativefuncs && pr_nativefuncs[fnum] && pr_native.value) {
+        PR_EnterFunction(f);
+        pr_nativefuncs[fnum]();
+        PR_LeaveFunction();
+        return;
+    }
+
+// make a stack frame
+    exitdepth = pr_depth;
+
+    s = PR_EnterFunction(f);
+
+#ifdef PR_THREADED
+    if(pr_threads && pr_threaded.value) {
+        PR_RunThreaded(s, exitdepth, PR_RUNAWAY);
+    } else
+#endif
+    {
+        PR_RunSwitch(s, exitdepth, PR_RUNAWAY);
+    }
+}
+
+/*
+====================
+PR_ExecuteProgram
+====================
+*/
+void PR_ExecuteProgram(func_t fnum) {
+
+    if(!fnum || fnum >= progs->numfunctions) {
+        if(pr_global_struct->self) {
+            ED_Print(PROG_TO_EDICT(pr_global_struct->self));
+        }
+        Host_Error("PR_ExecuteProgram: NULL function");
+    }
+
+    Prof_Begin(PROF_PROGS);
+
+    pr_trace = false;
+    pr_nativerunaway = PR_RUNAWAY;
+
+    if(!pr_depth) {
+        PR_TimingStart();
+    }
+
+    PR_CallFunction(fnum);
+
+    Prof_End(PROF_PROGS);
+}
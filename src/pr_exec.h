@@ -20,7 +20,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifndef PR_EXEC_H
 #define PR_EXEC_H
 
+extern cvar_t pr_threaded;
+extern cvar_t pr_optimize;
+
 void PR_ExecuteProgram(func_t fnum);
+void PR_CallFunction(func_t fnum);
+void PR_TranslateProgs(void);
 void PR_Profile_f(void);
 void PR_RunError(char *error, ...);
 
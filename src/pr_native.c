@@ -0,0 +1,494 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+// pr_native.c -- progs compiled ahead of time to C
+
+/*
+"progs2c" writes the loaded progs.dat out as C, one function per
+dfunction_t, statement for statement.  Built as the progs_native module
+(see QUAD_PROGS_NATIVE in CMakeLists.txt) and dropped in the game
+directory, it is bound by PR_LoadProgs whenever the crc of progs.dat
+matches the one it was generated from, and PR_CallFunction runs the native
+version of any function it provides.
+
+The module is ordinary machine code with the engine's privileges, and any
+mod directory could ship one, so it is never loaded unless asked for:
+"pr_native 1" (in autoexec.cfg or +pr_native 1 on the command line) has to
+be set before the map loads.
+
+Native code keeps the QuakeC calling convention, locals stack and error
+reporting, but does not count statements for "profile" and ignores
+traceon.  Runaway loops are still caught on backward branches.
+*/
+
+#include <stddef.h>
+
+#include "quakedef.h"
+
+#include "pr_edict.h"
+#include "pr_exec.h"
+#include "pr_native.h"
+#include "pr_timing.h"
+
+#ifdef _WIN32
+#define PR_NATIVE_FILE  "progs_native.dll"
+#else
+#define PR_NATIVE_FILE  "progs_native.so"
+#endif
+
+cvar_t pr_native = { "pr_native", "0" };    // opt in to loading progs_native from the game directory
+
+prnativefunc_t *pr_nativefuncs;
+int pr_nativerunaway;
+
+static void *pr_nativelib;
+static prnativeinit_t pr_nativeinit;
+static prnativeapi_t pr_nativeapi;
+
+/*
+===============================================================================
+
+RUNTIME
+
+===============================================================================
+*/
+
+static int PR_NativeWorldLocked(void) {
+    return sv.state == ss_active;
+}
+
+static void PR_NativeCall(int fnum) {
+    dfunction_t *newf;
+    int i;
+
+    if(!fnum) {
+        PR_RunError("NULL function");
+    }
+
+    newf = &pr_functions[fnum];
+
+    if(newf->first_statement < 0) {    // negative statements are built in functions
+        i = -newf->first_statement;
+        if(i >= pr_numbuiltins) {
+            PR_RunError("Bad builtin call number");
+        }
+        PR_CallBuiltin(fnum, i);
+        return;
+    }
+
+    PR_CallFunction(fnum);
+}
+
+static void PR_NativeMarkLoose(int ent) {
+    SV_MarkLoose(PROG_TO_EDICT(ent));
+}
+
+static void PR_NativeEdictChanged(int ent) {
+    SV_EdictChanged(PROG_TO_EDICT(ent));
+}
+
+static void PR_NativeState(float frame, int think) {
+    edict_t *ed;
+
+    ed = PROG_TO_EDICT(pr_global_struct->self);
+    ed->v.nextthink = pr_global_struct->time + 0.1;
+
+    if(frame != ed->v.frame) {
+        ed->v.frame = frame;
+    }
+    ed->v.think = think;
+}
+
+/*
+===============
+PR_BindNative
+
+Called at the end of PR_LoadProgs
+===============
+*/
+void PR_BindNative(void) {
+    prnativemodule_t *module;
+    char name[MAX_OSPATH];
+    int result;
+
+    pr_nativefuncs = NULL;
+
+    if(!pr_native.value || COM_CheckParm("-nonative")) {
+        return;
+    }
+
+    if(!pr_nativelib) {
+        result = snprintf(name, MAX_OSPATH, "%s/%s", com_gamedir, PR_NATIVE_FILE);
+        if(!CHECK_SAFE_PRINT(result, MAX_OSPATH)) {
+            return;
+        }
+
+        pr_nativelib = Sys_LoadLibrary(name);
+        if(!pr_nativelib) {
+            return;
+        }
+        pr_nativeinit = (prnativeinit_t)Sys_GetProcAddress(pr_nativelib, PR_NATIVE_INIT);
+        if(!pr_nativeinit) {
+            Con_Printf("%s has no %s\n", name, PR_NATIVE_INIT);
+            Sys_UnloadLibrary(pr_nativelib);
+            pr_nativelib = NULL;
+            return;
+        }
+    }
+
+    pr_nativeapi.version = PR_NATIVE_VERSION;
+    pr_nativeapi.globals = pr_globals;
+    pr_nativeapi.edicts = (unsigned char **)&sv.edicts;
+    pr_nativeapi.edictvofs = offsetof(edict_t, v);
+    pr_nativeapi.xstatement = &pr_xstatement;
+    pr_nativeapi.argc = &pr_argc;
+    pr_nativeapi.runaway = &pr_nativerunaway;
+    pr_nativeapi.WorldLocked = PR_NativeWorldLocked;
+    pr_nativeapi.MarkLoose = PR_NativeMarkLoose;
+    pr_nativeapi.EdictChanged = PR_NativeEdictChanged;
+    pr_nativeapi.Call = PR_NativeCall;
+    pr_nativeapi.State = PR_NativeState;
+    pr_nativeapi.RunError = PR_RunError;
+    pr_nativeapi.GetString = PR_GetString;
+
+    module = pr_nativeinit(&pr_nativeapi);
+    if(!module || module->version != PR_NATIVE_VERSION) {
+        Con_Printf("%s: version mismatch\n", PR_NATIVE_FILE);
+        return;
+    }
+    if(module->crc != pr_crc || module->numfunctions != progs->numfunctions) {
+        Con_DPrintf("%s: built for another progs.dat (crc %i, loaded %i)\n", PR_NATIVE_FILE, module->crc, pr_crc);
+        return;
+    }
+
+    pr_nativefuncs = module->functions;
+    Con_DPrintf("Using native progs from %s\n", PR_NATIVE_FILE);
+}
+
+/*
+===============================================================================
+
+TRANSLATION
+
+===============================================================================
+*/
+
+/*
+===============
+PR_FunctionEnd
+
+QCC lays functions out one after another, so a function's code runs up to
+the next function's first statement
+===============
+*/
+static int PR_FunctionEnd(int start) {
+    int i, end;
+
+    end = progs->numstatements;
+    for(i = 1; i < progs->numfunctions; i++) {
+        if(pr_functions[i].first_statement > start && pr_functions[i].first_statement < end) {
+            end = pr_functions[i].first_statement;
+        }
+    }
+
+    return end;
+}
+
+static int PR_BranchTarget(int s, dstatement_t *st) {
+    if(st->op == OP_GOTO) {
+        return s + st->a;
+    }
+    if(st->op == OP_IF || st->op == OP_IFNOT) {
+        return s + st->b;
+    }
+    return -1;
+}
+
+static void PR_EmitVector(FILE *f, char *fmt, int a, int b, int c) {
+    int i;
+
+    for(i = 0; i < 3; i++) {
+        fprintf(f, fmt, c + i, a + i, b + i);
+    }
+}
+
+/*
+===============
+PR_EmitStatement
+===============
+*/
+static void PR_EmitStatement(FILE *f, int s, dstatement_t *st) {
+    int a = st->a, b = st->b, c = st->c;
+
+    switch(st->op) {
+        case OP_ADD_F: fprintf(f, "F(%i) = F(%i) + F(%i);\n", c, a, b); break;
+        case OP_SUB_F: fprintf(f, "F(%i) = F(%i) - F(%i);\n", c, a, b); break;
+        case OP_MUL_F: fprintf(f, "F(%i) = F(%i) * F(%i);\n", c, a, b); break;
+        case OP_DIV_F: fprintf(f, "F(%i) = F(%i) / F(%i);\n", c, a, b); break;
+        case OP_ADD_V: PR_EmitVector(f, "F(%i) = F(%i) + F(%i); ", a, b, c); fprintf(f, "\n"); break;
+        case OP_SUB_V: PR_EmitVector(f, "F(%i) = F(%i) - F(%i); ", a, b, c); fprintf(f, "\n"); break;
+        case OP_MUL_V:
+            fprintf(f, "F(%i) = F(%i) * F(%i) + F(%i) * F(%i) + F(%i) * F(%i);\n", c, a, b, a + 1, b + 1, a + 2, b + 2);
+            break;
+        case OP_MUL_FV:
+            fprintf(f, "F(%i) = F(%i) * F(%i); F(%i) = F(%i) * F(%i); F(%i) = F(%i) * F(%i);\n",
+                    c, a, b, c + 1, a, b + 1, c + 2, a, b + 2);
+            break;
+        case OP_MUL_VF:
+            fprintf(f, "F(%i) = F(%i) * F(%i); F(%i) = F(%i) * F(%i); F(%i) = F(%i) * F(%i);\n",
+                    c, b, a, c + 1, b, a + 1, c + 2, b, a + 2);
+            break;
+
+        case OP_BITAND: fprintf(f, "F(%i) = (int)F(%i) & (int)F(%i);\n", c, a, b); break;
+        case OP_BITOR: fprintf(f, "F(%i) = (int)F(%i) | (int)F(%i);\n", c, a, b); break;
+
+        case OP_GE: fprintf(f, "F(%i) = F(%i) >= F(%i);\n", c, a, b); break;
+        case OP_LE: fprintf(f, "F(%i) = F(%i) <= F(%i);\n", c, a, b); break;
+        case OP_GT: fprintf(f, "F(%i) = F(%i) > F(%i);\n", c, a, b); break;
+        case OP_LT: fprintf(f, "F(%i) = F(%i) < F(%i);\n", c, a, b); break;
+        case OP_AND: fprintf(f, "F(%i) = F(%i) && F(%i);\n", c, a, b); break;
+        case OP_OR: fprintf(f, "F(%i) = F(%i) || F(%i);\n", c, a, b); break;
+
+        case OP_NOT_F: fprintf(f, "F(%i) = !F(%i);\n", c, a); break;
+        case OP_NOT_V: fprintf(f, "F(%i) = !F(%i) && !F(%i) && !F(%i);\n", c, a, a + 1, a + 2); break;
+        case OP_NOT_S: fprintf(f, "F(%i) = !I(%i) || !S(%i);\n", c, a, a); break;
+        case OP_NOT_FNC: fprintf(f, "F(%i) = !I(%i);\n", c, a); break;
+        case OP_NOT_ENT: fprintf(f, "F(%i) = I(%i) == 0;\n", c, a); break;
+
+        case OP_EQ_F: fprintf(f, "F(%i) = F(%i) == F(%i);\n", c, a, b); break;
+        case OP_EQ_V:
+            fprintf(f, "F(%i) = (F(%i) == F(%i)) && (F(%i) == F(%i)) && (F(%i) == F(%i));\n",
+                    c, a, b, a + 1, b + 1, a + 2, b + 2);
+            break;
+        case OP_EQ_S: fprintf(f, "F(%i) = !strcmp(S(%i), S(%i));\n", c, a, b); break;
+        case OP_EQ_E:
+        case OP_EQ_FNC: fprintf(f, "F(%i) = I(%i) == I(%i);\n", c, a, b); break;
+
+        case OP_NE_F: fprintf(f, "F(%i) = F(%i) != F(%i);\n", c, a, b); break;
+        case OP_NE_V:
+            fprintf(f, "F(%i) = (F(%i) != F(%i)) || (F(%i) != F(%i)) || (F(%i) != F(%i));\n",
+                    c, a, b, a + 1, b + 1, a + 2, b + 2);
+            break;
+        case OP_NE_S: fprintf(f, "F(%i) = strcmp(S(%i), S(%i));\n", c, a, b); break;
+        case OP_NE_E:
+        case OP_NE_FNC: fprintf(f, "F(%i) = I(%i) != I(%i);\n", c, a, b); break;
+
+        case OP_STORE_F:
+        case OP_STORE_ENT:
+        case OP_STORE_FLD:
+        case OP_STORE_S:
+        case OP_STORE_FNC: fprintf(f, "I(%i) = I(%i);\n", b, a); break;
+        case OP_STORE_V: fprintf(f, "F(%i) = F(%i); F(%i) = F(%i); F(%i) = F(%i);\n", b, a, b + 1, a + 1, b + 2, a + 2); break;
+
+        case OP_STOREP_F:
+        case OP_STOREP_ENT:
+        case OP_STOREP_FLD:
+        case OP_STOREP_S:
+        case OP_STOREP_FNC: fprintf(f, "*PTR(%i) = I(%i);\n", b, a); break;
+        case OP_STOREP_V:
+            fprintf(f, "((float *)PTR(%i))[0] = F(%i); ((float *)PTR(%i))[1] = F(%i); ((float *)PTR(%i))[2] = F(%i);\n",
+                    b, a, b, a + 1, b, a + 2);
+            break;
+
+        case OP_ADDRESS:
+            fprintf(f, "if(!I(%i) && api->WorldLocked()) { XS(%i); api->RunError(\"assignment to world entity\"); }\n", a, s);
+            fprintf(f, "    I(%i) = I(%i) + api->edictvofs + I(%i) * 4;\n", c, a, b);
+            fprintf(f, "    if(LINKFIELD(I(%i))) api->MarkLoose(I(%i));\n", b, a);
+            fprintf(f, "    else if(CLIPFIELD(I(%i))) api->EdictChanged(I(%i));\n", b, a);
+            break;
+
+        case OP_LOAD_F:
+        case OP_LOAD_FLD:
+        case OP_LOAD_ENT:
+        case OP_LOAD_S:
+        case OP_LOAD_FNC: fprintf(f, "I(%i) = *FLD(%i, %i);\n", c, a, b); break;
+        case OP_LOAD_V:
+            fprintf(f, "F(%i) = ((float *)FLD(%i, %i))[0]; F(%i) = ((float *)FLD(%i, %i))[1]; F(%i) = ((float *)FLD(%i, %i))[2];\n",
+                    c, a, b, c + 1, a, b, c + 2, a, b);
+            break;
+
+        case OP_IFNOT:
+        case OP_IF:
+        case OP_GOTO:
+            if(st->op != OP_GOTO) {
+                fprintf(f, "if(%sI(%i)) ", st->op == OP_IFNOT ? "!" : "", a);
+            }
+            if(PR_BranchTarget(s, st) <= s) {
+                fprintf(f, "{ RUNAWAY(%i); goto s%i; }\n", s, PR_BranchTarget(s, st));
+            } else {
+                fprintf(f, "goto s%i;\n", PR_BranchTarget(s, st));
+            }
+            break;
+
+        case OP_CALL0:
+        case OP_CALL1:
+        case OP_CALL2:
+        case OP_CALL3:
+        case OP_CALL4:
+        case OP_CALL5:
+        case OP_CALL6:
+        case OP_CALL7:
+        case OP_CALL8:
+            fprintf(f, "XS(%i); *api->argc = %i; api->Call(I(%i));\n", s, st->op - OP_CALL0, a);
+            break;
+
+        case OP_DONE:
+        case OP_RETURN:
+            fprintf(f, "F(1) = F(%i); F(2) = F(%i); F(3) = F(%i); return;\n", a, a + 1, a + 2);
+            break;
+
+        case OP_STATE: fprintf(f, "api->State(F(%i), I(%i));\n", a, b); break;
+
+        default:
+            fprintf(f, "XS(%i); api->RunError(\"Bad opcode %%i\", %i);\n", s, st->op);
+            break;
+    }
+}
+
+/*
+===============
+PR_EmitFunction
+
+Returns false if the function's branches leave its own code, in which case
+it is left to the interpreter
+===============
+*/
+static qboolean PR_EmitFunction(FILE *f, int fnum, byte *targets) {
+    dfunction_t *func;
+    dstatement_t *st;
+    int s, start, end, target;
+
+    func = &pr_functions[fnum];
+    start = func->first_statement;
+    end = PR_FunctionEnd(start);
+
+    for(s = start; s < end; s++) {
+        target = PR_BranchTarget(s, &pr_statements[s]);
+        if(target >= 0) {
+            if(target < start || target >= end) {
+                return false;
+            }
+            targets[target] = 1;
+        }
+    }
+
+    fprintf(f, "\n// %s (%s)\n", PR_GetString(func->s_name), PR_GetString(func->s_file));
+    fprintf(f, "static void qc_%i(void) {\n", fnum);
+    for(s = start, st = &pr_statements[s]; s < end; s++, st++) {
+        if(targets[s]) {
+            fprintf(f, "s%i:\n", s);
+        }
+        fprintf(f, "    ");
+        PR_EmitStatement(f, s, st);
+    }
+    fprintf(f, "    XS(%i); api->RunError(\"fell off the end of a function\");\n", end - 1);
+    fprintf(f, "}\n");
+
+    return true;
+}
+
+/*
+===============
+PR_Progs2C_f
+
+progs2c [file] : write the loaded progs as C for the progs_native module
+===============
+*/
+static void PR_Progs2C_f(void) {
+    char name[MAX_OSPATH];
+    byte *targets, *emitted;
+    int i, result, count;
+    FILE *f;
+
+    if(!sv.active || !progs) {
+        Con_Printf("progs2c: start a map first so progs.dat is loaded\n");
+        return;
+    }
+
+    result = snprintf(name, MAX_OSPATH, "%s/%s", com_gamedir, Cmd_Argc() > 1 ? Cmd_Argv(1) : "progs_native.c");
+    if(!CHECK_SAFE_PRINT(result, MAX_OSPATH)) {
+        Con_Printf("ERROR: path too long.\n");
+        return;
+    }
+
+    f = fopen(name, "w");
+    if(!f) {
+        Con_Printf("ERROR: couldn't open %s.\n", name);
+        return;
+    }
+
+    targets = Z_Malloc(progs->numstatements);
+    emitted = Z_Malloc(progs->numfunctions);
+
+    fprintf(f, "// generated by progs2c from progs.dat (crc %i), do not edit\n\n", pr_crc);
+    fprintf(f, "#include <string.h>\n\n#include \"pr_native.h\"\n\n");
+    fprintf(f, "static prnativeapi_t *api;\n");
+    fprintf(f, "static float *g;\n\n");
+    fprintf(f, "#define F(o)        (g[o])\n");
+    fprintf(f, "#define I(o)        (((int *)g)[o])\n");
+    fprintf(f, "#define S(o)        (api->GetString(I(o)))\n");
+    fprintf(f, "#define PTR(o)      ((int *)(*api->edicts + I(o)))\n");
+    fprintf(f, "#define FLD(e, o)   ((int *)(*api->edicts + I(e) + api->edictvofs) + I(o))\n");
+    fprintf(f, "#define XS(s)       (*api->xstatement = (s))\n");
+    fprintf(f, "#define LINKFIELD(o) ((unsigned)((o) - %i) < 12 || (unsigned)((o) - %i) < 6)\n",
+            (int)(offsetof(entvars_t, absmin) / 4), (int)(offsetof(entvars_t, mins) / 4));
+    fprintf(f, "#define CLIPFIELD(o) ((o) == %i || (unsigned)((o) - %i) < 3 || (o) == %i || (o) == %i)\n",
+            (int)(offsetof(entvars_t, modelindex) / 4), (int)(offsetof(entvars_t, size) / 4),
+            (int)(offsetof(entvars_t, owner) / 4), (int)(offsetof(entvars_t, flags) / 4));
+    fprintf(f, "#define RUNAWAY(s)  do { if(--*api->runaway <= 0) { XS(s); api->RunError(\"runaway loop error\"); } } while(0)\n");
+
+    count = 0;
+    for(i = 1; i < progs->numfunctions; i++) {
+        if(pr_functions[i].first_statement <= 0) {
+            continue;
+        }
+        emitted[i] = PR_EmitFunction(f, i, targets);
+        count += emitted[i];
+    }
+
+    fprintf(f, "\nstatic prnativefunc_t functions[%i] = {\n", progs->numfunctions);
+    for(i = 0; i < progs->numfunctions; i++) {
+        if(emitted[i]) {
+            fprintf(f, "    [%i] = qc_%i,\n", i, i);
+        }
+    }
+    fprintf(f, "};\n\n");
+
+    fprintf(f, "static prnativemodule_t module = { PR_NATIVE_VERSION, %i, %i, functions };\n\n", pr_crc, progs->numfunctions);
+    fprintf(f, "PR_NATIVE_EXPORT prnativemodule_t *PR_NativeInit(prnativeapi_t *engine) {\n");
+    fprintf(f, "    api = engine;\n");
+    fprintf(f, "    g = engine->globals;\n");
+    fprintf(f, "    return &module;\n");
+    fprintf(f, "}\n");
+
+    fclose(f);
+    Z_Free(targets);
+    Z_Free(emitted);
+
+    Con_Printf("wrote %i of %i functions to %s\n", count, progs->numfunctions - 1, name);
+}
+
+/*
+===============
+PR_NativeInit
+===============
+*/
+void PR_NativeInit(void) {
+    Cvar_RegisterVariable(&pr_native);
+    Cmd_AddCommand("progs2c", PR_Progs2C_f);
+}
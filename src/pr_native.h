@@ -0,0 +1,75 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+// pr_native.h -- interface between the engine and progs compiled to C
+
+// this file is included by the code progs2c writes, so it must not depend
+// on anything else in the engine
+
+#ifndef PR_NATIVE_H
+#define PR_NATIVE_H
+
+#define PR_NATIVE_VERSION    4
+#define PR_NATIVE_INIT       "PR_NativeInit"
+
+#ifdef _WIN32
+#define PR_NATIVE_EXPORT __declspec(dllexport)
+#else
+#define PR_NATIVE_EXPORT
+#endif
+
+typedef void (*prnativefunc_t)(void);
+
+// handed to the module every time progs.dat is loaded, since the globals and
+// edicts move with the hunk
+typedef struct {
+    int version;
+    float *globals;
+    unsigned char **edicts;        // points at sv.edicts
+    int edictvofs;                 // offset of the entvars in an edict
+    int *xstatement;               // statement to blame in error messages
+    int *argc;
+    int *runaway;                  // decremented on backward branches
+    int (*WorldLocked)(void);      // true if stores to the world entity are an error
+    void (*MarkLoose)(int ent);    // taking the address of a field that moves the entity
+    void (*EdictChanged)(int ent);     // or of one that changes what traces hit
+    void (*Call)(int fnum);        // builtin, native or interpreted
+    void (*State)(float frame, int think);
+    void (*RunError)(char *error, ...);
+    char *(*GetString)(int ofs);
+} prnativeapi_t;
+
+typedef struct {
+    int version;
+    unsigned short crc;            // crc of the progs.dat it was generated from
+    int numfunctions;
+    prnativefunc_t *functions;     // NULL entries are left to the interpreter
+} prnativemodule_t;
+
+typedef prnativemodule_t *(*prnativeinit_t)(prnativeapi_t *api);
+
+#ifdef QUAKEDEF_H
+extern cvar_t pr_native;
+extern prnativefunc_t *pr_nativefuncs;
+extern int pr_nativerunaway;
+
+void PR_NativeInit(void);
+void PR_BindNative(void);
+#endif // QUAKEDEF_H
+
+#endif // !PR_NATIVE_H
@@ -0,0 +1,405 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+// pr_timing.c -- time spent in QuakeC functions and builtins
+
+/*
+While pr_timing is set, every QuakeC function and builtin call is timed
+with the performance counter and charged to a node of a call tree, one
+node per distinct call stack.  A node keeps its inclusive time and its
+exclusive time, which leaves out the calls made from it.
+
+"proftime" adds the nodes up per function, so a builtin such as
+findradius shows the time spent inside it no matter who called it, and
+"proftime collapsed" writes the tree as collapsed stacks for flamegraph.pl
+or speedscope.  The window runs from the last "proftime reset" or progs.dat
+load.  Once the tree is full, new stacks are charged to their caller.
+*/
+
+#include "quakedef.h"
+
+#include "pr_edict.h"
+#include "pr_timing.h"
+
+#define PR_TIMENODES    16384
+#define PR_TIMEHASH     (PR_TIMENODES * 2)    // must be a power of two
+#define PR_TIMEDEPTH    64
+
+typedef struct {
+    int parent;
+    int fnum;
+    int calls;
+    double inclusive, exclusive;
+} prtimenode_t;
+
+typedef struct {
+    int node;            // -1 if not recorded
+    double start;
+    double children;     // inclusive time of the recorded calls made from here
+} prtimeframe_t;
+
+typedef struct {
+    int fnum;
+    int calls;
+    double inclusive, exclusive;
+} prtimetotal_t;
+
+cvar_t pr_timing = { "pr_timing", "0" };
+qboolean pr_timing_running;
+
+static prtimenode_t pr_timenodes[PR_TIMENODES];    // 0 is the engine
+static int pr_numtimenodes;
+static int pr_timehash[PR_TIMEHASH];               // node + 1
+static qboolean pr_timefull;
+static double pr_timestart;
+
+static prtimeframe_t pr_timestack[PR_TIMEDEPTH];
+static int pr_timedepth;
+
+static int pr_timesort;
+
+/*
+================
+PR_TimingClear
+
+Starts a new window, called whenever progs.dat is loaded since the function
+numbers change
+================
+*/
+void PR_TimingClear(void) {
+    memset(pr_timehash, 0, sizeof(pr_timehash));
+    pr_timenodes[0].parent = -1;
+    pr_timenodes[0].fnum = 0;
+    pr_numtimenodes = 1;
+    pr_timefull = false;
+    pr_timedepth = 0;
+    pr_timestart = Sys_ProfileTime();
+}
+
+/*
+================
+PR_TimingStart
+
+Called when the engine calls into QuakeC with nothing else running
+================
+*/
+void PR_TimingStart(void) {
+    pr_timing_running = pr_timing.value != 0;
+    pr_timedepth = 0;        // drop whatever a Host_Error left behind
+
+    if(pr_timing_running && !pr_numtimenodes) {
+        PR_TimingClear();
+    }
+}
+
+/*
+================
+PR_TimingNode
+
+Finds or adds the child of parent for fnum
+================
+*/
+static int PR_TimingNode(int parent, int fnum) {
+    prtimenode_t *node;
+    int h;
+
+    if(parent < 0) {
+        return -1;
+    }
+
+    h = (parent * 31 + fnum) & (PR_TIMEHASH - 1);
+    while(pr_timehash[h]) {
+        node = &pr_timenodes[pr_timehash[h] - 1];
+        if(node->parent == parent && node->fnum == fnum) {
+            return pr_timehash[h] - 1;
+        }
+        h = (h + 1) & (PR_TIMEHASH - 1);
+    }
+
+    if(pr_numtimenodes == PR_TIMENODES) {
+        pr_timefull = true;
+        return -1;
+    }
+
+    node = &pr_timenodes[pr_numtimenodes];
+    node->parent = parent;
+    node->fnum = fnum;
+    node->calls = 0;
+    node->inclusive = 0;
+    node->exclusive = 0;
+    pr_timehash[h] = ++pr_numtimenodes;
+
+    return pr_numtimenodes - 1;
+}
+
+/*
+================
+PR_TimingEnter
+================
+*/
+void PR_TimingEnter(int fnum) {
+    prtimeframe_t *frame;
+
+    if(pr_timedepth < PR_TIMEDEPTH) {
+        frame = &pr_timestack[pr_timedepth];
+        frame->node = PR_TimingNode(pr_timedepth ? pr_timestack[pr_timedepth - 1].node : 0, fnum);
+        frame->children = 0;
+        frame->start = Sys_ProfileTime();
+    }
+    pr_timedepth++;
+}
+
+/*
+================
+PR_TimingLeave
+================
+*/
+void PR_TimingLeave(void) {
+    prtimeframe_t *frame;
+    prtimenode_t *node;
+    double time;
+
+    if(!pr_timedepth) {
+        return;
+    }
+    pr_timedepth--;
+    if(pr_timedepth >= PR_TIMEDEPTH) {
+        return;        // left in its caller's exclusive time
+    }
+
+    frame = &pr_timestack[pr_timedepth];
+    if(frame->node < 0) {
+        return;
+    }
+
+    time = Sys_ProfileTime() - frame->start;
+    if(pr_timedepth) {
+        pr_timestack[pr_timedepth - 1].children += time;
+    }
+
+    node = &pr_timenodes[frame->node];
+    node->calls++;
+    node->inclusive += time;
+    node->exclusive += time - frame->children;
+}
+
+/*
+================
+PR_TimeBuiltin
+================
+*/
+void PR_TimeBuiltin(int fnum, int num) {
+    PR_TimingEnter(fnum);
+    pr_builtins[num]();
+    PR_TimingLeave();
+}
+
+static char *PR_TimingName(int fnum) {
+    if(fnum <= 0 || fnum >= progs->numfunctions) {
+        return "?";
+    }
+    return PR_GetString(pr_functions[fnum].s_name);
+}
+
+static int PR_CompareTotals(const void *a, const void *b) {
+    const prtimetotal_t *ta = a;
+    const prtimetotal_t *tb = b;
+    double da, db;
+
+    switch(pr_timesort) {
+        case 0:
+            da = ta->exclusive;
+            db = tb->exclusive;
+            break;
+        case 1:
+            da = ta->inclusive;
+            db = tb->inclusive;
+            break;
+        default:
+            da = ta->calls;
+            db = tb->calls;
+            break;
+    }
+
+    return da < db ? 1 : -(da > db);
+}
+
+/*
+================
+PR_TimingReport
+
+Adds the call tree up per function.  Inclusive time is only counted at the
+outermost call of a recursive function.
+================
+*/
+static void PR_TimingReport(int sort, int count) {
+    prtimetotal_t *totals, *t;
+    prtimenode_t *node;
+    dfunction_t *f;
+    int i, p, used;
+
+    totals = Z_Malloc(progs->numfunctions * sizeof(prtimetotal_t));
+
+    for(i = 1; i < pr_numtimenodes; i++) {
+        node = &pr_timenodes[i];
+        if(node->fnum >= progs->numfunctions) {
+            continue;
+        }
+        t = &totals[node->fnum];
+        t->calls += node->calls;
+        t->exclusive += node->exclusive;
+
+        for(p = node->parent; p > 0 && pr_timenodes[p].fnum != node->fnum; p = pr_timenodes[p].parent) {
+        }
+        if(p <= 0) {
+            t->inclusive += node->inclusive;
+        }
+    }
+
+    used = 0;
+    for(i = 1; i < progs->numfunctions; i++) {
+        if(totals[i].calls) {
+            totals[used] = totals[i];
+            totals[used].fnum = i;
+            used++;
+        }
+    }
+
+    pr_timesort = sort;
+    qsort(totals, used, sizeof(prtimetotal_t), PR_CompareTotals);
+
+    Con_Printf("%.1f s window, %i stacks%s\n", Sys_ProfileTime() - pr_timestart, pr_numtimenodes - 1,
+               pr_timefull ? " (full)" : "");
+    Con_Printf("   calls  incl ms  excl ms  us/call function\n");
+    for(i = 0; i < used && i < count; i++) {
+        t = &totals[i];
+        f = &pr_functions[t->fnum];
+        Con_Printf("%8i %8.2f %8.2f %8.2f %s", t->calls, t->inclusive * 1000, t->exclusive * 1000,
+                   t->exclusive * 1000000 / t->calls, PR_TimingName(t->fnum));
+        if(f->first_statement < 0) {
+            Con_Printf(" #%i", -f->first_statement);
+        }
+        Con_Printf("\n");
+    }
+
+    Z_Free(totals);
+}
+
+/*
+================
+PR_TimingCollapsed
+
+Writes one line per call stack with its exclusive time in microseconds
+================
+*/
+static void PR_TimingCollapsed(char *filename) {
+    char name[MAX_OSPATH];
+    int path[PR_TIMEDEPTH];
+    FILE *f;
+    int i, j, n, result, lines;
+    double us;
+
+    result = snprintf(name, MAX_OSPATH, "%s/%s", com_gamedir, filename);
+    if(!CHECK_SAFE_PRINT(result, MAX_OSPATH - 4)) {
+        Con_Printf("ERROR: path too long.\n");
+        return;
+    }
+    COM_DefaultExtension(name, ".txt");
+
+    f = fopen(name, "w");
+    if(!f) {
+        Con_Printf("ERROR: couldn't open %s.\n", name);
+        return;
+    }
+
+    lines = 0;
+    for(i = 1; i < pr_numtimenodes; i++) {
+        us = pr_timenodes[i].exclusive * 1000000;
+        if(us < 0.5) {
+            continue;
+        }
+
+        n = 0;
+        for(j = i; j > 0 && n < PR_TIMEDEPTH; j = pr_timenodes[j].parent) {
+            path[n++] = pr_timenodes[j].fnum;
+        }
+        while(n--) {
+            fprintf(f, "%s%c", PR_TimingName(path[n]), n ? ';' : ' ');
+        }
+        fprintf(f, "%.0f\n", us);
+        lines++;
+    }
+    fclose(f);
+
+    Con_Printf("wrote %i stacks to %s\n", lines, name);
+}
+
+/*
+================
+PR_Timing_f
+
+proftime [excl|incl|calls] [count]  report functions and builtins
+proftime collapsed <file>           write collapsed stacks for a flame graph
+proftime reset                      start a new window
+================
+*/
+static void PR_Timing_f(void) {
+    int sort;
+
+    if(!progs) {
+        Con_Printf("no progs loaded\n");
+        return;
+    }
+    if(pr_numtimenodes <= 1) {    // node 0 is the root
+        Con_Printf("nothing recorded, set pr_timing 1\n");
+        return;
+    }
+
+    if(!Q_strcmp(Cmd_Argv(1), "reset")) {
+        PR_TimingClear();
+        return;
+    }
+    if(!Q_strcmp(Cmd_Argv(1), "collapsed")) {
+        if(Cmd_Argc() != 3) {
+            Con_Printf("proftime collapsed <filename> : write collapsed stacks\n");
+            return;
+        }
+        PR_TimingCollapsed(Cmd_Argv(2));
+        return;
+    }
+
+    if(!Q_strcmp(Cmd_Argv(1), "incl")) {
+        sort = 1;
+    } else if(!Q_strcmp(Cmd_Argv(1), "calls")) {
+        sort = 2;
+    } else {
+        sort = 0;
+    }
+
+    PR_TimingReport(sort, Cmd_Argc() > 2 ? Q_atoi(Cmd_Argv(2)) : 20);
+}
+
+/*
+================
+PR_TimingInit
+================
+*/
+void PR_TimingInit(void) {
+    Cvar_RegisterVariable(&pr_timing);
+    Cmd_AddCommand("proftime", PR_Timing_f);
+}
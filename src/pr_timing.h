@@ -0,0 +1,42 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+// pr_timing.h -- time spent in QuakeC functions and builtins
+
+#ifndef PR_TIMING_H
+#define PR_TIMING_H
+
+#include "cvar.h"
+
+extern cvar_t pr_timing;
+extern qboolean pr_timing_running;    // timing the current PR_ExecuteProgram
+
+void PR_TimingInit(void);
+void PR_TimingClear(void);
+void PR_TimingStart(void);
+
+void PR_TimingEnter(int fnum);
+void PR_TimingLeave(void);
+void PR_TimeBuiltin(int fnum, int num);
+
+#define PR_CallBuiltin(fnum, num) do { \
+                                      if(pr_timing_running) PR_TimeBuiltin(fnum, num); \
+                                      else pr_builtins[num](); \
+                                  } while(0)
+
+#endif // !PR_TIMING_H
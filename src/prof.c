@@ -0,0 +1,289 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+// prof.c -- frame profiler
+
+/*
+While prof_enable is set, every host frame records the inclusive time of
+each scope.  The per-frame totals of the last PROF_FRAMES frames are kept
+for percentile reports, and every closed scope is also logged to an event
+ring that "prof trace" writes out in Chrome's trace event format (load it
+in chrome://tracing or Perfetto).
+
+A scope that recurses into itself is only timed at its outermost level, so
+frame totals never count the same time twice.  If a Host_Error longjmps out
+of open scopes, they are dropped at the start of the next frame.
+*/
+
+#include "quakedef.h"
+
+#define PROF_FRAMES     256      // frames kept for percentiles
+#define PROF_EVENTS     65536    // must be a power of two
+#define PROF_MAXDEPTH   32
+
+typedef struct {
+    short scope;
+    short depth;
+    int frame;
+    double start, end;
+} profevent_t;
+
+typedef struct {
+    int scope;
+    double start;
+} profopen_t;
+
+cvar_t prof_enable = { "prof_enable", "0" };
+qboolean prof_running;
+
+static char *prof_names[PROF_NUMSCOPES] = {
+    "frame",
+    "Host_ServerFrame",
+    "SV_Physics",
+    "PR_ExecuteProgram",
+    "CL_ReadFromServer",
+    "R_RenderView",
+    "S_Update",
+    "VID_Update"
+};
+
+// current frame
+static profopen_t prof_stack[PROF_MAXDEPTH];
+static int prof_depth;
+static int prof_open[PROF_NUMSCOPES];          // recursion count per scope
+static double prof_time[PROF_NUMSCOPES];
+static int prof_calls[PROF_NUMSCOPES];
+
+// history
+static float prof_frametime[PROF_FRAMES][PROF_NUMSCOPES];    // ms
+static int prof_framecalls[PROF_FRAMES][PROF_NUMSCOPES];
+static int prof_numframes;
+
+static profevent_t prof_events[PROF_EVENTS];
+static int prof_numevents;
+
+/*
+================
+Prof_Begin_
+================
+*/
+void Prof_Begin_(profscope_t scope) {
+    if(prof_depth == PROF_MAXDEPTH) {
+        return;
+    }
+
+    prof_stack[prof_depth].scope = scope;
+    prof_stack[prof_depth].start = Sys_ProfileTime();
+    prof_depth++;
+    prof_open[scope]++;
+}
+
+/*
+================
+Prof_End_
+================
+*/
+void Prof_End_(profscope_t scope) {
+    profopen_t *o;
+    profevent_t *ev;
+    double now;
+
+    if(!prof_depth || prof_stack[prof_depth - 1].scope != scope) {
+        return;        // unbalanced, or the begin didn't fit on the stack
+    }
+
+    now = Sys_ProfileTime();
+    prof_depth--;
+    o = &prof_stack[prof_depth];
+
+    if(!--prof_open[scope]) {
+        prof_time[scope] += now - o->start;
+    }
+    prof_calls[scope]++;
+
+    ev = &prof_events[prof_numevents & (PROF_EVENTS - 1)];
+    ev->scope = scope;
+    ev->depth = prof_depth;
+    ev->frame = host_framecount;
+    ev->start = o->start;
+    ev->end = now;
+    prof_numevents++;
+}
+
+/*
+================
+Prof_FrameBegin
+================
+*/
+void Prof_FrameBegin(void) {
+    prof_running = prof_enable.value != 0;
+    if(!prof_running) {
+        return;
+    }
+
+    prof_depth = 0;
+    memset (prof_open, 0, sizeof(prof_open));
+    memset (prof_time, 0, sizeof(prof_time));
+    memset (prof_calls, 0, sizeof(prof_calls));
+
+    Prof_Begin_(PROF_FRAME);
+}
+
+/*
+================
+Prof_FrameEnd
+================
+*/
+void Prof_FrameEnd(void) {
+    int i, slot;
+
+    if(!prof_running) {
+        return;
+    }
+
+    while(prof_depth > 1) {        // close anything left open
+        Prof_End_(prof_stack[prof_depth - 1].scope);
+    }
+    Prof_End_(PROF_FRAME);
+
+    slot = prof_numframes % PROF_FRAMES;
+    for(i = 0; i < PROF_NUMSCOPES; i++) {
+        prof_frametime[slot][i] = prof_time[i] * 1000;
+        prof_framecalls[slot][i] = prof_calls[i];
+    }
+    prof_numframes++;
+
+    prof_running = false;
+}
+
+static int Prof_CompareFloat(const void *a, const void *b) {
+    float fa = *(const float *)a;
+    float fb = *(const float *)b;
+
+    return fa < fb ? -1 : fa > fb;
+}
+
+/*
+================
+Prof_Report
+
+Percentiles of the per-frame inclusive time of each scope
+================
+*/
+static void Prof_Report(void) {
+    float times[PROF_FRAMES];
+    int i, j, n, calls;
+    double sum;
+
+    n = prof_numframes < PROF_FRAMES ? prof_numframes : PROF_FRAMES;
+    if(!n) {
+        Con_Printf("no frames recorded, set prof_enable 1\n");
+        return;
+    }
+
+    Con_Printf("%i frames (ms)        mean    p50    p99    max  calls\n", n);
+    for(i = 0; i < PROF_NUMSCOPES; i++) {
+        sum = 0;
+        calls = 0;
+        for(j = 0; j < n; j++) {
+            times[j] = prof_frametime[j][i];
+            sum += times[j];
+            calls += prof_framecalls[j][i];
+        }
+        qsort(times, n, sizeof(float), Prof_CompareFloat);
+
+        Con_Printf("%-18s %6.2f %6.2f %6.2f %6.2f %6.1f\n", prof_names[i], sum / n, times[(n - 1) / 2],
+                   times[(n - 1) * 99 / 100], times[n - 1], (float)calls / n);
+    }
+}
+
+/*
+================
+Prof_Trace
+
+Writes the event ring as a Chrome trace, timestamps in microseconds
+================
+*/
+static void Prof_Trace(char *filename) {
+    char name[MAX_OSPATH];
+    profevent_t *ev;
+    FILE *f;
+    int i, first, result;
+
+    result = snprintf(name, MAX_OSPATH, "%s/%s", com_gamedir, filename);
+    if(!CHECK_SAFE_PRINT(result, MAX_OSPATH - 5)) {
+        Con_Printf("ERROR: path too long.\n");
+        return;
+    }
+    COM_DefaultExtension(name, ".json");
+
+    f = fopen(name, "w");
+    if(!f) {
+        Con_Printf("ERROR: couldn't open %s.\n", name);
+        return;
+    }
+
+    first = prof_numevents > PROF_EVENTS ? prof_numevents - PROF_EVENTS : 0;
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    for(i = first; i < prof_numevents; i++) {
+        ev = &prof_events[i & (PROF_EVENTS - 1)];
+        fprintf(f, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+                   "\"args\":{\"frame\":%i,\"depth\":%i}}%s\n",
+                prof_names[ev->scope], ev->start * 1000000, (ev->end - ev->start) * 1000000,
+                ev->frame, ev->depth, i + 1 < prof_numevents ? "," : "");
+    }
+    fprintf(f, "],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(f);
+
+    Con_Printf("wrote %i events to %s\n", prof_numevents - first, name);
+}
+
+/*
+================
+Prof_f
+
+prof                report the recorded frames
+prof trace <file>   write the event ring as Chrome trace json
+prof reset          forget everything recorded so far
+================
+*/
+static void Prof_f(void) {
+    if(!Q_strcmp(Cmd_Argv(1), "trace")) {
+        if(Cmd_Argc() != 3) {
+            Con_Printf("prof trace <filename> : write a chrome trace\n");
+            return;
+        }
+        Prof_Trace(Cmd_Argv(2));
+    } else if(!Q_strcmp(Cmd_Argv(1), "reset")) {
+        prof_numframes = 0;
+        prof_numevents = 0;
+    } else {
+        Prof_Report();
+    }
+}
+
+/*
+================
+Prof_Init
+================
+*/
+void Prof_Init(void) {
+    Cvar_RegisterVariable(&prof_enable);
+    Cmd_AddCommand("prof", Prof_f);
+}
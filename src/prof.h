@@ -0,0 +1,53 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+// prof.h -- frame profiler scopes
+
+#ifndef PROF_H
+#define PROF_H
+
+#include "cvar.h"
+
+typedef enum {
+    PROF_FRAME,
+    PROF_SERVERFRAME,
+    PROF_PHYSICS,
+    PROF_PROGS,
+    PROF_CLIENTREAD,
+    PROF_RENDERVIEW,
+    PROF_SOUND,
+    PROF_VIDUPDATE,
+    PROF_NUMSCOPES
+} profscope_t;
+
+extern cvar_t prof_enable;
+extern qboolean prof_running;    // recording the current frame
+
+void Prof_Init(void);
+
+void Prof_FrameBegin(void);
+void Prof_FrameEnd(void);
+
+// scopes nest and must be closed in order; only the main thread may use them
+void Prof_Begin_(profscope_t scope);
+void Prof_End_(profscope_t scope);
+
+#define Prof_Begin(scope) do { if(prof_running) Prof_Begin_(scope); } while(0)
+#define Prof_End(scope) do { if(prof_running) Prof_End_(scope); } while(0)
+
+#endif // !PROF_H
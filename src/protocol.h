@@ -132,6 +132,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define svc_cutscene         34
 
+// only sent to clients that asked for delta snapshots with "delta", the
+// entity updates that follow leave out what didn't change since the base
+#define svc_snapshot         35        // [byte] sequence [byte] base, the same if against the baselines
+
 //
 // client to server
 //
@@ -140,6 +144,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define clc_disconnect        2
 #define clc_move              3            // [usercmd_t]
 #define clc_stringcmd         4        // [string] message
+#define clc_snapshotack       5        // [byte] last snapshot decoded in full
+
+// delta snapshots a client can fall behind by before the server goes back
+// to the baselines, a power of two that divides 256
+#define SNAPSHOT_FRAMES      32
+#define MAX_SNAPSHOT_ENTITIES    512    // an update is at least two bytes
 
 
 //
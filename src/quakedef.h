@@ -45,6 +45,15 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define UNUSED(x)    (x = x)    // for pesky compiler / lint warnings
 
+// per-thread storage for globals touched by the worker threads
+#ifdef MSVC
+#define THREAD_LOCAL    __declspec(thread)
+#else
+#define THREAD_LOCAL    __thread
+#endif // MSVC
+
+#define MAX_THREADS    16
+
 #define MINIMUM_MEMORY            0x550000
 #define MINIMUM_MEMORY_LEVELPAK    (MINIMUM_MEMORY + 0x100000)
 
@@ -182,6 +191,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "sys.h"
 #include "zone.h"
 #include "mathlib.h"
+#include "prof.h"
 
 typedef struct {
     vec3_t origin;
@@ -179,6 +179,18 @@ typedef struct mleaf_s {
     byte ambient_sound_level[NUM_AMBIENTS];
 } mleaf_t;
 
+// a clipnode with its plane folded in, so a trace only touches one cache line
+// per node.  two of them fit in a line.
+#define HULLNODE_ALIGN  64
+
+typedef struct {
+    vec3_t normal;
+    float dist;
+    int type;            // < 3 for axial planes, where only normal[type] is set
+    int children[2];     // negative numbers are contents
+    int pad;
+} hullnode_t;
+
 // !!! if this is changed, it must be changed in asm_i386.h too !!!
 typedef struct {
     dclipnode_t *clipnodes;
@@ -187,6 +199,7 @@ typedef struct {
     int lastclipnode;
     vec3_t clip_mins;
     vec3_t clip_maxs;
+    hullnode_t *nodes;    // same numbering as clipnodes, NULL if not built
 } hull_t;
 
 /*
@@ -1052,6 +1052,8 @@ void R_RenderView(void) {
         Sys_Error("R_RenderView: NULL worldmodel");
     }
 
+    Prof_Begin(PROF_RENDERVIEW);
+
     if(r_speeds.value) {
         glFinish();
         time1 = Sys_FloatTime();
@@ -1095,4 +1097,6 @@ void R_RenderView(void) {
         time2 = Sys_FloatTime();
         Con_Printf("%3i ms  %4i wpoly %4i epoly\n", (int)((time2 - time1) * 1000), c_brush_polys, c_alias_polys);
     }
+
+    Prof_End(PROF_RENDERVIEW);
 }
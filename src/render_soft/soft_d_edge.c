@@ -27,8 +27,39 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "soft_r_bsp.h"
 #include "soft_r_misc.h"
 
+#define MAXSURFJOBS    1024
+#define BANDSPANS      64
+
+typedef enum {
+    SJ_SOLID,
+    SJ_SKY,
+    SJ_TURB,
+    SJ_TEXTURED
+} surfjobtype_t;
+
+// a surface whose spans have been generated and gradients calculated, waiting
+// to be rasterized by the worker pool
+typedef struct {
+    surfjobtype_t type;
+    espan_t *spans;
+    int color;
+    surfcache_t *cache;        // pinned until the job has been drawn
+
+    float sdivzstepu, tdivzstepu, zistepu;
+    float sdivzstepv, tdivzstepv, zistepv;
+    float sdivzorigin, tdivzorigin, ziorigin;
+    fixed16_t sadjust, tadjust, bbextents, bbextentt;
+    pixel_t *cacheblock;
+    int cachewidth;
+} surfjob_t;
+
 static int miplevel;
 
+static surfjob_t surfjobs[MAXSURFJOBS];
+static int numsurfjobs;
+static int numbands;        // 0 when drawing directly on the calling thread
+static int bandheight;
+
 float scale_for_mip;
 int screenwidth;
 int ubasestep, errorterm, erroradjustup, erroradjustdown;
@@ -79,13 +110,13 @@ D_DrawSolidSurface
 
 // FIXME: clean this up
 
-void D_DrawSolidSurface(surf_t *surf, int color) {
+void D_DrawSolidSurface(espan_t *spans, int color) {
     espan_t *span;
     byte *pdest;
     int u, u2, pix;
 
     pix = (color << 24) | (color << 16) | (color << 8) | color;
-    for(span = surf->spans; span; span = span->pnext) {
+    for(span = spans; span; span = span->pnext) {
         pdest = (byte *)d_viewbuffer + screenwidth * span->v;
         u = span->u;
         u2 = span->u + span->count - 1;
@@ -156,6 +187,198 @@ void D_CalcGradients(msurface_t *pface) {
     bbextentt = ((pface->extents[1] << 16) >> miplevel) - 1;
 }
 
+/*
+==============
+D_SaveSpanState / D_LoadSpanState
+
+Copies the per-thread span drawing state to and from a job
+==============
+*/
+static void D_SaveSpanState(surfjob_t *job) {
+    job->sdivzstepu = d_sdivzstepu;
+    job->tdivzstepu = d_tdivzstepu;
+    job->zistepu = d_zistepu;
+    job->sdivzstepv = d_sdivzstepv;
+    job->tdivzstepv = d_tdivzstepv;
+    job->zistepv = d_zistepv;
+    job->sdivzorigin = d_sdivzorigin;
+    job->tdivzorigin = d_tdivzorigin;
+    job->ziorigin = d_ziorigin;
+    job->sadjust = sadjust;
+    job->tadjust = tadjust;
+    job->bbextents = bbextents;
+    job->bbextentt = bbextentt;
+    job->cacheblock = cacheblock;
+    job->cachewidth = cachewidth;
+}
+
+static void D_LoadSpanState(const surfjob_t *job) {
+    d_sdivzstepu = job->sdivzstepu;
+    d_tdivzstepu = job->tdivzstepu;
+    d_zistepu = job->zistepu;
+    d_sdivzstepv = job->sdivzstepv;
+    d_tdivzstepv = job->tdivzstepv;
+    d_zistepv = job->zistepv;
+    d_sdivzorigin = job->sdivzorigin;
+    d_tdivzorigin = job->tdivzorigin;
+    d_ziorigin = job->ziorigin;
+    sadjust = job->sadjust;
+    tadjust = job->tadjust;
+    bbextents = job->bbextents;
+    bbextentt = job->bbextentt;
+    cacheblock = job->cacheblock;
+    cachewidth = job->cachewidth;
+}
+
+/*
+==============
+D_DrawSurfaceSpans
+==============
+*/
+static void D_DrawSurfaceSpans(surfjobtype_t type, espan_t *spans, int color) {
+    switch(type) {
+        case SJ_SOLID:
+            D_DrawSolidSurface(spans, color);
+            break;
+
+        case SJ_SKY:
+            D_DrawSkyScans8(spans);
+            break;
+
+        case SJ_TURB:
+            Turbulent8(spans);
+            break;
+
+        case SJ_TEXTURED:
+            D_DrawSpans8(spans);
+            break;
+    }
+
+    D_DrawZSpans(spans);
+}
+
+/*
+==============
+D_DrawSurfaceBand
+
+Worker entry point. Draws the part of every queued surface that falls inside
+one horizontal band of the screen. Spans never overlap, so the bands can be
+filled in any order and still produce exactly the serial result.
+==============
+*/
+static void D_DrawSurfaceBand(void *data, int band) {
+    espan_t bandspans[BANDSPANS];
+    espan_t *span;
+    surfjob_t *job;
+    int top, bottom, count;
+
+    top = r_refdef.vrect.y + band * bandheight;
+    bottom = top + bandheight;
+
+    for(job = surfjobs; job < &surfjobs[numsurfjobs]; job++) {
+        D_LoadSpanState(job);
+
+        count = 0;
+        for(span = job->spans; span; span = span->pnext) {
+            if(span->v < top || span->v >= bottom) {
+                continue;
+            }
+
+            bandspans[count] = *span;
+            bandspans[count].pnext = NULL;
+            if(count > 0) {
+                bandspans[count - 1].pnext = &bandspans[count];
+            }
+
+            if(++count == BANDSPANS) {
+                D_DrawSurfaceSpans(job->type, bandspans, job->color);
+                count = 0;
+            }
+        }
+
+        if(count > 0) {
+            D_DrawSurfaceSpans(job->type, bandspans, job->color);
+        }
+    }
+}
+
+/*
+==============
+D_FlushSurfaceJobs
+
+Rasterizes everything queued so far. Also called by the surface cache before
+it evicts a block that a queued job still points at.
+==============
+*/
+void D_FlushSurfaceJobs(void) {
+    surfjob_t saved;
+    vec3_t saved_vpn, saved_vup, saved_vright;
+    int i;
+
+    if(!numsurfjobs) {
+        return;
+    }
+
+    // the calling thread pitches in too, so keep its drawing state intact
+    D_SaveSpanState(&saved);
+
+    // we may be in the middle of a rotated bmodel, but the sky was queued
+    // against the world view
+    VectorCopy(vpn, saved_vpn);
+    VectorCopy(vup, saved_vup);
+    VectorCopy(vright, saved_vright);
+    VectorCopy(base_vpn, vpn);
+    VectorCopy(base_vup, vup);
+    VectorCopy(base_vright, vright);
+
+    Sys_RunJobs(D_DrawSurfaceBand, NULL, numbands);
+
+    VectorCopy(saved_vpn, vpn);
+    VectorCopy(saved_vup, vup);
+    VectorCopy(saved_vright, vright);
+    D_LoadSpanState(&saved);
+
+    for(i = 0; i < numsurfjobs; i++) {
+        if(surfjobs[i].cache) {
+            surfjobs[i].cache->pinned = false;
+        }
+    }
+
+    numsurfjobs = 0;
+}
+
+/*
+==============
+D_SubmitSurface
+
+Draws the spans with the current drawing state, or queues them for the
+worker pool when threaded drawing is active
+==============
+*/
+static void D_SubmitSurface(surfjobtype_t type, espan_t *spans, int color, surfcache_t *cache) {
+    surfjob_t *job;
+
+    if(!numbands) {
+        D_DrawSurfaceSpans(type, spans, color);
+        return;
+    }
+
+    if(numsurfjobs == MAXSURFJOBS) {
+        D_FlushSurfaceJobs();
+    }
+
+    job = &surfjobs[numsurfjobs++];
+    job->type = type;
+    job->spans = spans;
+    job->color = color;
+    job->cache = cache;
+    D_SaveSpanState(job);
+
+    if(cache) {
+        cache->pinned = true;
+    }
+}
+
 /*
 ==============
 D_DrawSurfaces
@@ -168,6 +391,13 @@ void D_DrawSurfaces(void) {
     vec3_t world_transformed_modelorg;
     vec3_t local_modelorg;
 
+    numbands = 0;
+    if(d_threads.value && Sys_ThreadCount() > 1) {
+        // a couple of bands per thread evens out rows of differing complexity
+        numbands = Sys_ThreadCount() * 2;
+        bandheight = (r_refdef.vrect.height + numbands - 1) / numbands;
+    }
+
     currententity = &cl_entities[0];
     TransformVector(modelorg, transformed_modelorg);
     VectorCopy (transformed_modelorg, world_transformed_modelorg);
@@ -183,8 +413,7 @@ void D_DrawSurfaces(void) {
             d_zistepv = s->d_zistepv;
             d_ziorigin = s->d_ziorigin;
 
-            D_DrawSolidSurface(s, (size_t)s->data & 0xFF);
-            D_DrawZSpans(s->spans);
+            D_SubmitSurface(SJ_SOLID, s->spans, (size_t)s->data & 0xFF, NULL);
         }
     } else {
         for(s = &surfaces[1]; s < surface_p; s++) {
@@ -203,8 +432,7 @@ void D_DrawSurfaces(void) {
                     R_MakeSky();
                 }
 
-                D_DrawSkyScans8(s->spans);
-                D_DrawZSpans(s->spans);
+                D_SubmitSurface(SJ_SKY, s->spans, 0, NULL);
             } else if(s->flags & SURF_DRAWBACKGROUND) {
                 // set up a gradient for the background surface that places it
                 // effectively at infinity distance from the viewpoint
@@ -212,8 +440,7 @@ void D_DrawSurfaces(void) {
                 d_zistepv = 0;
                 d_ziorigin = -0.9;
 
-                D_DrawSolidSurface(s, (int)r_clearcolor.value & 0xFF);
-                D_DrawZSpans(s->spans);
+                D_SubmitSurface(SJ_SOLID, s->spans, (int)r_clearcolor.value & 0xFF, NULL);
             } else if(s->flags & SURF_DRAWTURB) {
                 pface = s->data;
                 miplevel = 0;
@@ -233,8 +460,7 @@ void D_DrawSurfaces(void) {
                 }
 
                 D_CalcGradients(pface);
-                Turbulent8(s->spans);
-                D_DrawZSpans(s->spans);
+                D_SubmitSurface(SJ_TURB, s->spans, 0, NULL);
 
                 if(s->insubmodel) {
                     //
@@ -273,8 +499,7 @@ void D_DrawSurfaces(void) {
                 cachewidth = pcurrentcache->width;
 
                 D_CalcGradients(pface);
-                D_DrawSpans8(s->spans);
-                D_DrawZSpans(s->spans);
+                D_SubmitSurface(SJ_TEXTURED, s->spans, 0, pcurrentcache);
 
                 if(s->insubmodel) {
                     //
@@ -293,5 +518,8 @@ void D_DrawSurfaces(void) {
             }
         }
     }
+
+    D_FlushSurfaceJobs();
+    numbands = 0;
 }
 
@@ -21,5 +21,6 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define RENDER_SOFT_D_EDGE_H
 
 extern int D_MipLevelForScale(float scale);
+void D_FlushSurfaceJobs(void);
 
 #endif // !RENDER_SOFT_D_EDGE_H
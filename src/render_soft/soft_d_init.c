@@ -27,6 +27,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 cvar_t d_subdiv16 = { "d_subdiv16", "1" };
 cvar_t d_mipcap = { "d_mipcap", "0" };
 cvar_t d_mipscale = { "d_mipscale", "1" };
+cvar_t d_threads = { "d_threads", "1" };
 
 surfcache_t *d_initial_rover;
 qboolean d_roverwrapped;
@@ -49,6 +50,7 @@ void D_Init(void) {
     Cvar_RegisterVariable(&d_subdiv16);
     Cvar_RegisterVariable(&d_mipcap);
     Cvar_RegisterVariable(&d_mipscale);
+    Cvar_RegisterVariable(&d_threads);
 
     r_drawpolys = false;
     r_worldpolysbacktofront = false;
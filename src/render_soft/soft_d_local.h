@@ -41,6 +41,7 @@ typedef struct surfcache_s {
     unsigned height;        // DEBUG only needed for debug
     float mipscale;
     struct texture_s *texture;    // checked for animating textures
+    qboolean pinned;        // still referenced by a queued span job
     byte data[4];    // width*height elements
 } surfcache_t;
 
@@ -50,6 +51,7 @@ typedef struct sspan_s {
 } sspan_t;
 
 extern cvar_t d_subdiv16;
+extern cvar_t d_threads;
 
 extern float scale_for_mip;
 
@@ -57,12 +59,12 @@ extern qboolean d_roverwrapped;
 extern surfcache_t *sc_rover;
 extern surfcache_t *d_initial_rover;
 
-extern float d_sdivzstepu, d_tdivzstepu, d_zistepu;
-extern float d_sdivzstepv, d_tdivzstepv, d_zistepv;
-extern float d_sdivzorigin, d_tdivzorigin, d_ziorigin;
+extern THREAD_LOCAL float d_sdivzstepu, d_tdivzstepu, d_zistepu;
+extern THREAD_LOCAL float d_sdivzstepv, d_tdivzstepv, d_zistepv;
+extern THREAD_LOCAL float d_sdivzorigin, d_tdivzorigin, d_ziorigin;
 
-extern fixed16_t sadjust, tadjust;
-extern fixed16_t bbextents, bbextentt;
+extern THREAD_LOCAL fixed16_t sadjust, tadjust;
+extern THREAD_LOCAL fixed16_t bbextents, bbextentt;
 
 extern short *d_pzbuffer;
 extern unsigned int d_zrowbytes, d_zwidth;
@@ -25,10 +25,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "soft_r_local.h"
 #include "soft_d_local.h"
 
-unsigned char *r_turb_pbase, *r_turb_pdest;
-fixed16_t r_turb_s, r_turb_t, r_turb_sstep, r_turb_tstep;
-int *r_turb_turb;
-int r_turb_spancount;
+static THREAD_LOCAL unsigned char *r_turb_pbase, *r_turb_pdest;
+static THREAD_LOCAL fixed16_t r_turb_s, r_turb_t, r_turb_sstep, r_turb_tstep;
+static THREAD_LOCAL int *r_turb_turb;
+static THREAD_LOCAL int r_turb_spancount;
 
 void D_DrawTurbulent8Span(void);
 
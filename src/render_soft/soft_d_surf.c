@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // d_surf.c: rasterization driver surface heap manager
 
 #include "../quakedef.h"
+#include "soft_d_edge.h"
 #include "soft_d_local.h"
 #include "soft_r_surf.h"
 
@@ -89,6 +90,7 @@ void D_InitCaches(void *buffer, int size) {
 
     sc_base->next = NULL;
     sc_base->owner = NULL;
+    sc_base->pinned = false;
     sc_base->size = sc_size;
 
     D_ClearCacheGuard();
@@ -115,6 +117,7 @@ void D_FlushCaches(void) {
     sc_rover = sc_base;
     sc_base->next = NULL;
     sc_base->owner = NULL;
+    sc_base->pinned = false;
     sc_base->size = sc_size;
 }
 
@@ -152,7 +155,11 @@ surfcache_t *D_SCAlloc(int width, size_t size) {
     }
 
 // colect and free surfcache_t blocks until the rover block is large enough
+// (anything still waiting to be drawn from a block has to be drawn first)
     new = sc_rover;
+    if(sc_rover->pinned) {
+        D_FlushSurfaceJobs();
+    }
     if(sc_rover->owner) {
         *sc_rover->owner = NULL;
     }
@@ -163,6 +170,9 @@ surfcache_t *D_SCAlloc(int width, size_t size) {
         if(!sc_rover) {
             Sys_Error("D_SCAlloc: hit the end of memory");
         }
+        if(sc_rover->pinned) {
+            D_FlushSurfaceJobs();
+        }
         if(sc_rover->owner) {
             *sc_rover->owner = NULL;
         }
@@ -178,6 +188,7 @@ surfcache_t *D_SCAlloc(int width, size_t size) {
         sc_rover->next = new->next;
         sc_rover->width = 0;
         sc_rover->owner = NULL;
+        sc_rover->pinned = false;
         new->next = sc_rover;
         new->size = size;
     } else {
@@ -191,6 +202,7 @@ surfcache_t *D_SCAlloc(int width, size_t size) {
     }
 
     new->owner = NULL;              // should be set properly after return
+    new->pinned = false;
 
     if(d_roverwrapped) {
         if(wrapped_this_time || (sc_rover >= d_initial_rover)) {
@@ -290,6 +302,13 @@ surfcache_t *D_CacheSurface(msurface_t *surface, int miplevel) {
     r_drawsurf.rowbytes = r_drawsurf.surfwidth;
     r_drawsurf.surfheight = surface->extents[1] >> miplevel;
 
+//
+// a queued job may still be reading the stale contents
+//
+    if(cache && cache->pinned) {
+        D_FlushSurfaceJobs();
+    }
+
 //
 // allocate memory if needed
 //
@@ -31,14 +31,16 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // FIXME: make into one big structure, like cl or sv
 // FIXME: do separately for refresh engine and driver
 
-float d_sdivzstepu, d_tdivzstepu, d_zistepu;
-float d_sdivzstepv, d_tdivzstepv, d_zistepv;
-float d_sdivzorigin, d_tdivzorigin, d_ziorigin;
+// the span drawing state is per-thread so D_DrawSurfaces can hand bands of the
+// screen to the worker pool
+THREAD_LOCAL float d_sdivzstepu, d_tdivzstepu, d_zistepu;
+THREAD_LOCAL float d_sdivzstepv, d_tdivzstepv, d_zistepv;
+THREAD_LOCAL float d_sdivzorigin, d_tdivzorigin, d_ziorigin;
 
-fixed16_t sadjust, tadjust, bbextents, bbextentt;
+THREAD_LOCAL fixed16_t sadjust, tadjust, bbextents, bbextentt;
 
-pixel_t *cacheblock;
-int cachewidth;
+THREAD_LOCAL pixel_t *cacheblock;
+THREAD_LOCAL int cachewidth;
 pixel_t *d_viewbuffer;
 short *d_pzbuffer;
 unsigned int d_zrowbytes;
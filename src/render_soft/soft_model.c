@@ -113,7 +113,7 @@ Mod_DecompressVis
 ===================
 */
 byte *Mod_DecompressVis(byte *in, model_t *model) {
-    static byte decompressed[MAX_MAP_LEAFS / 8];
+    static THREAD_LOCAL byte decompressed[MAX_MAP_LEAFS / 8];    // SV_FatPVS runs on the workers
     int c;
     byte *out;
     int row;
@@ -267,7 +267,7 @@ model_t *Mod_LoadModel(model_t *mod, qboolean crash) {
 //
 // load the file
 //
-    buf = (unsigned *)COM_LoadStackFile(mod->name, stackbuf, sizeof(stackbuf));
+    buf = (unsigned *)COM_LoadMappedStackFile(mod->name, stackbuf, sizeof(stackbuf));
     if(!buf) {
         if(crash) {
             Sys_Error("Mod_NumForName: %s not found", mod->name);
@@ -331,6 +331,68 @@ model_t *Mod_ForName(char *name, qboolean crash) {
 
 byte *mod_base;
 
+static dheader_t *mod_header;
+static byte *mod_lumpcopy[HEADER_LUMPS];    // lumps that weren't aligned in the file
+
+/*
+=================
+Mod_FreeLumps
+=================
+*/
+static void Mod_FreeLumps(void) {
+    int i;
+
+    for(i = 0; i < HEADER_LUMPS; i++) {
+        free(mod_lumpcopy[i]);
+        mod_lumpcopy[i] = NULL;
+    }
+}
+
+/*
+=================
+Mod_AlignLumps
+
+The lump loaders read through int and float pointers, but nothing makes a bsp
+keep its lumps aligned, and a file used in place from a mapped pak may not be
+aligned at all, so any lump that isn't gets copied out first.  The byte lumps
+are copied by their loaders anyway.
+=================
+*/
+static void Mod_AlignLumps(dheader_t *header) {
+    lump_t *l;
+    int i;
+
+    Mod_FreeLumps();    // left over if the last load was aborted
+    mod_header = header;
+
+    for(i = 0, l = header->lumps; i < HEADER_LUMPS; i++, l++) {
+        if(i == LUMP_LIGHTING || i == LUMP_VISIBILITY || i == LUMP_ENTITIES) {
+            continue;
+        }
+        if(!l->filelen || !((uintptr_t)(mod_base + l->fileofs) & 3)) {
+            continue;
+        }
+
+        mod_lumpcopy[i] = malloc(l->filelen);
+        if(!mod_lumpcopy[i]) {
+            Sys_Error("Mod_AlignLumps: couldn't copy lump %i of %s", i, loadmodel->name);
+        }
+        memcpy (mod_lumpcopy[i], mod_base + l->fileofs, l->filelen);
+    }
+}
+
+/*
+=================
+Mod_LumpBase
+=================
+*/
+static byte *Mod_LumpBase(lump_t *l) {
+    int i;
+
+    i = l - mod_header->lumps;
+    return mod_lumpcopy[i] ? mod_lumpcopy[i] : mod_base + l->fileofs;
+}
+
 /*
 =================
 Mod_LoadTextures
@@ -348,7 +410,7 @@ void Mod_LoadTextures(lump_t *l) {
         loadmodel->textures = NULL;
         return;
     }
-    m = (dmiptexlump_t *)(mod_base + l->fileofs);
+    m = (dmiptexlump_t *)Mod_LumpBase(l);
 
     m->nummiptex = LittleLong(m->nummiptex);
 
@@ -483,7 +545,7 @@ void Mod_LoadLighting(lump_t *l) {
         return;
     }
     loadmodel->lightdata = Hunk_AllocName(l->filelen, loadname);
-    memcpy (loadmodel->lightdata, mod_base + l->fileofs, l->filelen);
+    memcpy (loadmodel->lightdata, Mod_LumpBase(l), l->filelen);
 }
 
 /*
@@ -497,7 +559,7 @@ void Mod_LoadVisibility(lump_t *l) {
         return;
     }
     loadmodel->visdata = Hunk_AllocName(l->filelen, loadname);
-    memcpy (loadmodel->visdata, mod_base + l->fileofs, l->filelen);
+    memcpy (loadmodel->visdata, Mod_LumpBase(l), l->filelen);
 }
 
 /*
@@ -511,7 +573,7 @@ void Mod_LoadEntities(lump_t *l) {
         return;
     }
     loadmodel->entities = Hunk_AllocName(l->filelen, loadname);
-    memcpy (loadmodel->entities, mod_base + l->fileofs, l->filelen);
+    memcpy (loadmodel->entities, Mod_LumpBase(l), l->filelen);
 }
 
 /*
@@ -524,7 +586,7 @@ void Mod_LoadVertexes(lump_t *l) {
     mvertex_t *out;
     int i, count;
 
-    in = (void *)(mod_base + l->fileofs);
+    in = (void *)Mod_LumpBase(l);
     if(l->filelen % sizeof(*in)) {
         Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
     }
@@ -551,7 +613,7 @@ void Mod_LoadSubmodels(lump_t *l) {
     dmodel_t *out;
     int i, j, count;
 
-    in = (void *)(mod_base + l->fileofs);
+    in = (void *)Mod_LumpBase(l);
     if(l->filelen % sizeof(*in)) {
         Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
     }
@@ -586,7 +648,7 @@ void Mod_LoadEdges(lump_t *l) {
     medge_t *out;
     int i, count;
 
-    in = (void *)(mod_base + l->fileofs);
+    in = (void *)Mod_LumpBase(l);
     if(l->filelen % sizeof(*in)) {
         Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
     }
@@ -614,7 +676,7 @@ void Mod_LoadTexinfo(lump_t *l) {
     int miptex;
     float len1, len2;
 
-    in = (void *)(mod_base + l->fileofs);
+    in = (void *)Mod_LumpBase(l);
     if(l->filelen % sizeof(*in)) {
         Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
     }
@@ -722,7 +784,7 @@ void Mod_LoadFaces(lump_t *l) {
     int i, count, surfnum;
     int planenum, side;
 
-    in = (void *)(mod_base + l->fileofs);
+    in = (void *)Mod_LumpBase(l);
     if(l->filelen % sizeof(*in)) {
         Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
     }
@@ -805,7 +867,7 @@ void Mod_LoadNodes(lump_t *l) {
     dnode_t *in;
     mnode_t *out;
 
-    in = (void *)(mod_base + l->fileofs);
+    in = (void *)Mod_LumpBase(l);
     if(l->filelen % sizeof(*in)) {
         Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
     }
@@ -850,7 +912,7 @@ void Mod_LoadLeafs(lump_t *l) {
     mleaf_t *out;
     int i, j, count, p;
 
-    in = (void *)(mod_base + l->fileofs);
+    in = (void *)Mod_LumpBase(l);
     if(l->filelen % sizeof(*in)) {
         Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
     }
@@ -896,7 +958,7 @@ void Mod_LoadClipnodes(lump_t *l) {
     int i, count;
     hull_t *hull;
 
-    in = (void *)(mod_base + l->fileofs);
+    in = (void *)Mod_LumpBase(l);
     if(l->filelen % sizeof(*in)) {
         Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
     }
@@ -937,6 +999,36 @@ void Mod_LoadClipnodes(lump_t *l) {
     }
 }
 
+/*
+=================
+Mod_MakeHullNodes
+
+Lays a hull's clipnodes out as hullnode_t for SV_HullCheck
+=================
+*/
+hullnode_t *Mod_MakeHullNodes(hull_t *hull, int count) {
+    hullnode_t *out, *nodes;
+    dclipnode_t *in;
+    mplane_t *plane;
+    int i;
+
+    out = Hunk_AllocName(count * sizeof(*out) + HULLNODE_ALIGN - 1, loadname);
+    out = (hullnode_t *)(((uintptr_t)out + HULLNODE_ALIGN - 1) & ~(uintptr_t)(HULLNODE_ALIGN - 1));
+    nodes = out;
+
+    in = hull->clipnodes;
+    for(i = 0; i < count; i++, out++, in++) {
+        plane = hull->planes + in->planenum;
+        VectorCopy (plane->normal, out->normal);
+        out->dist = plane->dist;
+        out->type = plane->type;
+        out->children[0] = in->children[0];
+        out->children[1] = in->children[1];
+    }
+
+    return nodes;
+}
+
 /*
 =================
 Mod_MakeHull0
@@ -984,7 +1076,7 @@ void Mod_LoadMarksurfaces(lump_t *l) {
     short *in;
     msurface_t **out;
 
-    in = (void *)(mod_base + l->fileofs);
+    in = (void *)Mod_LumpBase(l);
     if(l->filelen % sizeof(*in)) {
         Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
     }
@@ -1012,7 +1104,7 @@ void Mod_LoadSurfedges(lump_t *l) {
     int i, count;
     int *in, *out;
 
-    in = (void *)(mod_base + l->fileofs);
+    in = (void *)Mod_LumpBase(l);
     if(l->filelen % sizeof(*in)) {
         Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
     }
@@ -1039,7 +1131,7 @@ void Mod_LoadPlanes(lump_t *l) {
     int count;
     int bits;
 
-    in = (void *)(mod_base + l->fileofs);
+    in = (void *)Mod_LumpBase(l);
     if(l->filelen % sizeof(*in)) {
         Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
     }
@@ -1106,6 +1198,9 @@ void Mod_LoadBrushModel(model_t *mod, void *buffer) {
         ((int *)header)[i] = LittleLong(((int *)header)[i]);
     }
 
+// copy out any lump that can't be read in place
+    Mod_AlignLumps(header);
+
 // load into heap
 
     Mod_LoadVertexes(&header->lumps[LUMP_VERTEXES]);
@@ -1124,8 +1219,14 @@ void Mod_LoadBrushModel(model_t *mod, void *buffer) {
     Mod_LoadEntities(&header->lumps[LUMP_ENTITIES]);
     Mod_LoadSubmodels(&header->lumps[LUMP_MODELS]);
 
+    Mod_FreeLumps();
+
     Mod_MakeHull0();
 
+    mod->hulls[0].nodes = Mod_MakeHullNodes(&mod->hulls[0], mod->numnodes);
+    mod->hulls[1].nodes = Mod_MakeHullNodes(&mod->hulls[1], mod->numclipnodes);
+    mod->hulls[2].nodes = mod->hulls[1].nodes;
+
     mod->numframes = 2;        // regular and alternate animation
     mod->flags = 0;
 
@@ -1545,6 +1646,15 @@ void Mod_LoadAliasModel(model_t *mod, void *buffer) {
     end = Hunk_LowMark();
     total = end - start;
 
+// if the hunk spilled into a new arena part way through, the model is in two
+// pieces and its offsets are meaningless, so load it again into one block
+    if(!Hunk_LowContiguous(start)) {
+        Hunk_FreeToLowMark(start);
+        Hunk_LowReserve(total);
+        Mod_LoadAliasModel(mod, buffer);
+        return;
+    }
+
     Cache_Alloc(&mod->cache, total, loadname);
     if(!mod->cache.data) {
         return;
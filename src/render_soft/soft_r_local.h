@@ -126,8 +126,8 @@ extern int *pfrustum_indexes[4];
 
 extern int ubasestep, errorterm, erroradjustup, erroradjustdown;
 
-extern fixed16_t sadjust, tadjust;
-extern fixed16_t bbextents, bbextentt;
+extern THREAD_LOCAL fixed16_t sadjust, tadjust;
+extern THREAD_LOCAL fixed16_t bbextents, bbextentt;
 
 extern float entity_rotation[3][3];
 
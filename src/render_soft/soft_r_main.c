@@ -938,7 +938,9 @@ void R_RenderView(void) {
         Sys_Error("Globals are missaligned");
     }
 
+    Prof_Begin(PROF_RENDERVIEW);
     R_RenderView_();
+    Prof_End(PROF_RENDERVIEW);
 }
 
 /*
@@ -102,6 +102,20 @@ typedef struct client_s {
 
 // client known data for deltas	
     int old_frags;
+
+// delta snapshots, see SV_StartSnapshot
+    qboolean delta;                // asked for them with "delta"
+    int snapshotseq;            // of the next one sent
+    int snapshotfirst;            // first one sent this level
+    int snapshotack;            // last one the client decoded, -1 if none
+
+// what the datagrams cost, see SV_Bandwidth_f
+    double bandwidthstart;
+    int datagrams;
+    int datagrambytes;
+    int entitybytes;
+    int deltadatagrams;            // against an acknowledged snapshot
+    int overflows;
 } client_t;
 
 
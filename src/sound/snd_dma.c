@@ -651,6 +651,8 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up) {
         return;
     }
 
+    Prof_Begin(PROF_SOUND);
+
     VectorCopy(origin, listener_origin);
     VectorCopy(forward, listener_forward);
     VectorCopy(right, listener_right);
@@ -722,6 +724,8 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up) {
 
 // mix some sound
     S_Update_();
+
+    Prof_End(PROF_SOUND);
 }
 
 void GetSoundtime(void) {
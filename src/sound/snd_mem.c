@@ -116,7 +116,7 @@ sfxcache_t *S_LoadSound(sfx_t *s) {
 
 //	Con_Printf ("loading %s\n",namebuffer);
 
-    data = COM_LoadStackFile(namebuffer, stackbuf, sizeof(stackbuf));
+    data = COM_LoadMappedStackFile(namebuffer, stackbuf, sizeof(stackbuf));
 
     if(!data) {
         Con_Printf("Couldn't load %s\n", namebuffer);
@@ -19,6 +19,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 // sv_main.c -- server main program
 
+// SSE2 is part of every x86-64 target, and of 32-bit ones built for it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SV_SSE2
+#include <emmintrin.h>
+#endif // SSE2
+
 #include "quakedef.h"
 
 #include "host.h"
@@ -33,6 +39,43 @@ server_static_t svs;
 
 char localmodels[MAX_MODELS][5];            // inline model names for precache
 
+cvar_t sv_parallelsend = { "sv_parallelsend", "1" };
+cvar_t sv_deltasnapshots = { "sv_deltasnapshots", "0" };
+cvar_t sv_pvscache = { "sv_pvscache", "1" };
+
+// an entity the way a client got it in a delta snapshot, quantized like
+// MSG_WriteCoord and MSG_WriteAngle do
+typedef struct {
+    unsigned short num;
+    short origin[3];
+    byte angles[3];
+    byte modelindex, frame, colormap, skin, effects;
+} snapentity_t;
+
+typedef struct {
+    int sequence;
+    int numentities;
+    snapentity_t entities[MAX_SNAPSHOT_ENTITIES];    // by entity number
+} snapframe_t;
+
+typedef struct {
+    int build;                    // sv_snapshotbuild it was written for
+    qboolean complete;            // every visible entity fit
+    snapframe_t *frame;            // NULL unless the client asked for deltas
+    snapframe_t *base;            // NULL to delta against the baselines
+    int entitystart;            // where the entity updates begin in msg
+    vec3_t org;                    // the client's eye
+    struct fatpvs_s *pvs;        // cached row for its leafs, or NULL
+    struct fatpvs_s *fill;        // row to leave it in for the others
+    sizebuf_t msg;
+    byte buf[MAX_DATAGRAM];
+} snapshot_t;
+
+static snapshot_t sv_snapshots[MAX_SCOREBOARD];    // by client number
+static snapframe_t sv_snapframes[MAX_SCOREBOARD][SNAPSHOT_FRAMES];
+static client_t *sv_snapshotclients[MAX_SCOREBOARD];
+static int sv_snapshotbuild;
+
 //============================================================================
 
 /*
@@ -52,9 +95,11 @@ void SV_Init(void) {
     extern cvar_t sv_accelerate;
     extern cvar_t sv_idealpitchscale;
     extern cvar_t sv_aim;
+    extern cvar_t sv_parallelphysics;
 
     Cvar_RegisterVariable(&sv_maxvelocity);
     Cvar_RegisterVariable(&sv_gravity);
+    Cvar_RegisterVariable(&sv_parallelphysics);
     Cvar_RegisterVariable(&sv_friction);
     Cvar_RegisterVariable(&sv_edgefriction);
     Cvar_RegisterVariable(&sv_stopspeed);
@@ -63,6 +108,16 @@ void SV_Init(void) {
     Cvar_RegisterVariable(&sv_idealpitchscale);
     Cvar_RegisterVariable(&sv_aim);
     Cvar_RegisterVariable(&sv_nostep);
+    Cvar_RegisterVariable(&sv_areasplit);
+    Cvar_RegisterVariable(&sv_tracecache);
+    Cvar_RegisterVariable(&sv_parallelsend);
+    Cvar_RegisterVariable(&sv_deltasnapshots);
+    Cvar_RegisterVariable(&sv_pvscache);
+
+    Cmd_AddCommand("areastats", SV_AreaStats_f);
+    Cmd_AddCommand("bandwidth", SV_Bandwidth_f);
+    Cmd_AddCommand("pvscache", SV_PVSCache_f);
+    Cmd_AddCommand("hullbench", SV_HullBench_f);
 
     for(i = 0; i < MAX_MODELS; i++)
         sprintf (localmodels[i], "*%i", i);
@@ -203,6 +258,8 @@ void SV_SendServerinfo(client_t *client) {
     char **s;
     char message[2048];
 
+    client->delta = false;        // until it asks again
+
     MSG_WriteByte(&client->message, svc_print);
     sprintf (message, "%c\nVERSION %4.2f SERVER (%i CRC)", 2, VERSION, pr_crc);
     MSG_WriteString(&client->message, message);
@@ -370,12 +427,65 @@ crosses a waterline.
 =============================================================================
 */
 
-int fatbytes;
-byte fatpvs[MAX_MAP_LEAFS / 8];
+#define FATPVS_CACHE        64    // more than MAX_SCOREBOARD, so the rows in use are never evicted
+#define FATPVS_MAXLEAFS     32    // larger leaf sets aren't cached
+
+// the leafs within 8 units of a point, in tree order, so the same set always
+// comes out the same way
+typedef struct {
+    int numleafs;        // more than FATPVS_MAXLEAFS if they didn't fit
+    short leafs[FATPVS_MAXLEAFS];
+} fatleafs_t;
+
+typedef struct fatpvs_s {
+    unsigned int hash;
+    fatleafs_t key;
+    qboolean ready;        // row is filled in
+    int build;            // last sv_snapshotbuild that used it
+    int used;            // for finding the least recently used
+    unsigned int row[MAX_MAP_LEAFS / 32];
+} fatpvs_t;
+
+static fatpvs_t sv_fatcache[FATPVS_CACHE];
+static int sv_fatcacheused;
+
+static struct {
+    int hits;
+    int misses;
+    int shared;        // missed by two clients in one frame
+    int uncached;
+} sv_fatstats;
+
+// one each, since the snapshots are built on the worker pool
+static THREAD_LOCAL int fatwords;
+static THREAD_LOCAL unsigned int fatpvs[MAX_MAP_LEAFS / 32];
 
-void SV_AddToFatPVS(vec3_t org, mnode_t *node) {
+/*
+=============
+SV_OrPVS
+
+Mod_LeafPVS rows are only byte aligned, so every load is an unaligned one
+=============
+*/
+static void SV_OrPVS(unsigned int *row, byte *pvs, int words) {
+    unsigned int w;
     int i;
-    byte *pvs;
+
+    i = 0;
+#ifdef SV_SSE2
+    for(; i + 4 <= words; i += 4) {
+        _mm_storeu_si128((__m128i *)(row + i), _mm_or_si128(_mm_loadu_si128((__m128i *)(row + i)),
+                                                            _mm_loadu_si128((__m128i *)(pvs + i * 4))));
+    }
+#endif // SV_SSE2
+
+    for(; i < words; i++) {
+        memcpy(&w, pvs + i * 4, 4);
+        row[i] |= w;
+    }
+}
+
+void SV_AddToFatPVS(vec3_t org, mnode_t *node) {
     mplane_t *plane;
     float d;
 
@@ -383,10 +493,7 @@ void SV_AddToFatPVS(vec3_t org, mnode_t *node) {
         // if this is a leaf, accumulate the pvs bits
         if(node->contents < 0) {
             if(node->contents != CONTENTS_SOLID) {
-                pvs = Mod_LeafPVS((mleaf_t *)node, sv.worldmodel);
-                for(i = 0; i < fatbytes; i++) {
-                    fatpvs[i] |= pvs[i];
-                }
+                SV_OrPVS(fatpvs, Mod_LeafPVS((mleaf_t *)node, sv.worldmodel), fatwords);
             }
             return;
         }
@@ -413,101 +520,355 @@ given point.
 =============
 */
 byte *SV_FatPVS(vec3_t org) {
-    fatbytes = (sv.worldmodel->numleafs + 31) >> 3;
-    Q_memset(fatpvs, 0, fatbytes);
+    fatwords = (sv.worldmodel->numleafs + 31) >> 5;
+    Q_memset(fatpvs, 0, fatwords * 4);
     SV_AddToFatPVS(org, sv.worldmodel->nodes);
-    return fatpvs;
+    return (byte *)fatpvs;
+}
+
+/*
+=============
+SV_FatPVSLeafs
+
+The leafs SV_AddToFatPVS would take the rows of
+=============
+*/
+static void SV_FatPVSLeafs(vec3_t org, mnode_t *node, fatleafs_t *leafs) {
+    mplane_t *plane;
+    float d;
+
+    while(1) {
+        if(node->contents < 0) {
+            if(node->contents != CONTENTS_SOLID) {
+                if(leafs->numleafs < FATPVS_MAXLEAFS) {
+                    leafs->leafs[leafs->numleafs] = (mleaf_t *)node - sv.worldmodel->leafs;
+                }
+                leafs->numleafs++;
+            }
+            return;
+        }
+
+        plane = node->plane;
+        d = DotProduct (org, plane->normal) - plane->dist;
+        if(d > 8) {
+            node = node->children[0];
+        } else if(d < -8) {
+            node = node->children[1];
+        } else {
+            SV_FatPVSLeafs(org, node->children[0], leafs);
+            node = node->children[1];
+        }
+    }
+}
+
+/*
+=============
+SV_ClearFatPVS
+
+The rows belong to the map
+=============
+*/
+void SV_ClearFatPVS(void) {
+    int i;
+
+    for(i = 0; i < FATPVS_CACHE; i++) {
+        sv_fatcache[i].key.numleafs = 0;
+        sv_fatcache[i].ready = false;
+        sv_fatcache[i].build = 0;
+        sv_fatcache[i].used = 0;
+    }
+}
+
+/*
+=============
+SV_CachedFatPVS
+
+Only called while the snapshots are started, so the cache needs no lock.
+Returns the row for the leaf set if it is there.  Otherwise *fill is the row
+claimed for the caller to work out, or NULL if it has to work it out alone
+because another client is filling it this frame.
+=============
+*/
+static fatpvs_t *SV_CachedFatPVS(fatleafs_t *leafs, fatpvs_t **fill) {
+    fatpvs_t *entry, *oldest;
+    unsigned int hash;
+    int i;
+
+    *fill = NULL;
+    if(!sv_pvscache.value || leafs->numleafs > FATPVS_MAXLEAFS) {
+        sv_fatstats.uncached++;
+        return NULL;
+    }
+
+    hash = 2166136261u;
+    for(i = 0; i < leafs->numleafs; i++) {
+        hash ^= leafs->leafs[i];
+        hash *= 16777619u;
+    }
+
+    oldest = NULL;
+    for(i = 0, entry = sv_fatcache; i < FATPVS_CACHE; i++, entry++) {
+        if(entry->hash == hash && entry->key.numleafs == leafs->numleafs &&
+           !memcmp(entry->key.leafs, leafs->leafs, leafs->numleafs * sizeof(leafs->leafs[0]))) {
+            break;
+        }
+        if(entry->build != sv_snapshotbuild && (!oldest || entry->used < oldest->used)) {
+            oldest = entry;
+        }
+    }
+
+    if(i < FATPVS_CACHE) {
+        entry->used = ++sv_fatcacheused;
+        if(entry->ready) {
+            entry->build = sv_snapshotbuild;
+            sv_fatstats.hits++;
+            return entry;
+        }
+        if(entry->build == sv_snapshotbuild) {
+            sv_fatstats.shared++;
+            return NULL;
+        }
+    } else {
+        entry = oldest;
+        entry->hash = hash;
+        entry->key = *leafs;
+        entry->used = ++sv_fatcacheused;
+    }
+
+    entry->ready = false;
+    entry->build = sv_snapshotbuild;
+    sv_fatstats.misses++;
+    *fill = entry;
+    return NULL;
+}
+
+/*
+=============
+SV_BuildFatPVS
+
+Ors the rows of the leafs together, on the workers
+=============
+*/
+static void SV_BuildFatPVS(fatleafs_t *leafs, unsigned int *row) {
+    int i, words;
+
+    words = (sv.worldmodel->numleafs + 31) >> 5;
+    Q_memset(row, 0, words * 4);
+    for(i = 0; i < leafs->numleafs; i++) {
+        SV_OrPVS(row, Mod_LeafPVS(sv.worldmodel->leafs + leafs->leafs[i], sv.worldmodel), words);
+    }
+}
+
+/*
+=============
+SV_PVSCache_f
+
+pvscache [reset] : how often a snapshot found its fat PVS cached
+=============
+*/
+void SV_PVSCache_f(void) {
+    int total;
+
+    if(!Q_strcmp(Cmd_Argv(1), "reset")) {
+        memset (&sv_fatstats, 0, sizeof(sv_fatstats));
+        return;
+    }
+
+    total = sv_fatstats.hits + sv_fatstats.misses + sv_fatstats.shared + sv_fatstats.uncached;
+    if(!total) {
+        Con_Printf("no snapshots built\n");
+        return;
+    }
+
+    Con_Printf("%i lookups, %.1f%% hit rate\n", total, 100.0f * sv_fatstats.hits / total);
+    Con_Printf("%i filled, %i missed in the same frame, %i not cacheable\n", sv_fatstats.misses,
+               sv_fatstats.shared, sv_fatstats.uncached);
 }
 
 //=============================================================================
 
 
+/*
+=============
+SV_PackEntity
+=============
+*/
+static void SV_PackEntity(snapentity_t *to, int num, entity_state_t *state) {
+    int i;
+
+    to->num = num;
+    for(i = 0; i < 3; i++) {
+        to->origin[i] = (int)(state->origin[i] * 8);
+        to->angles[i] = ((int)state->angles[i] * 256 / 360) & 255;
+    }
+    to->modelindex = state->modelindex;
+    to->frame = state->frame;
+    to->colormap = state->colormap;
+    to->skin = state->skin;
+    to->effects = state->effects;
+}
+
+/*
+=============
+SV_DeltaBits
+
+The update bits for what the client has to be told to get from one to the
+other.  Both are quantized, so nothing is left out that the client would
+see differently.
+=============
+*/
+static int SV_DeltaBits(snapentity_t *from, snapentity_t *to) {
+    int i, bits;
+
+    bits = 0;
+    for(i = 0; i < 3; i++) {
+        if(to->origin[i] != from->origin[i]) {
+            bits |= U_ORIGIN1 << i;
+        }
+    }
+
+    if(to->angles[0] != from->angles[0]) {
+        bits |= U_ANGLE1;
+    }
+    if(to->angles[1] != from->angles[1]) {
+        bits |= U_ANGLE2;
+    }
+    if(to->angles[2] != from->angles[2]) {
+        bits |= U_ANGLE3;
+    }
+
+    if(to->colormap != from->colormap)
+        bits |= U_COLORMAP;
+    if(to->skin != from->skin)
+        bits |= U_SKIN;
+    if(to->frame != from->frame)
+        bits |= U_FRAME;
+    if(to->effects != from->effects)
+        bits |= U_EFFECTS;
+    if(to->modelindex != from->modelindex)
+        bits |= U_MODEL;
+
+    return bits;
+}
+
 /*
 =============
 SV_WriteEntitiesToClient
 
+Only reads the world, so it can run on the workers.  Returns false if the
+message filled up before every visible entity was written.
+
+With a frame the updates are deltas, against what the client has for each
+entity in base or else its baseline, and the frame records what was sent.
 =============
 */
-void SV_WriteEntitiesToClient(edict_t *clent, sizebuf_t *msg) {
-    int e, i;
+static qboolean SV_WriteEntitiesToClient(edict_t *clent, byte *pvs, sizebuf_t *msg, snapframe_t *frame,
+                                         snapframe_t *base) {
+    unsigned int hits[(MAX_EDICTS + 31) / 32];
+    int e, i, b;
     int bits;
-    byte *pvs;
-    vec3_t org;
     float miss;
     edict_t *ent;
+    entity_state_t state;
+    snapentity_t *from, *to, sent, baseline;
 
-// find the client's PVS
-    VectorAdd (clent->v.origin, clent->v.view_ofs, org);
-    pvs = SV_FatPVS(org);
+// only the entities linked into a leaf of the pvs can touch it
+    memset (hits, 0, (sv.num_edicts + 31) / 32 * sizeof(hits[0]));
+    SV_PVSEdicts(pvs, hits);
+    e = NUM_FOR_EDICT(clent);
+    hits[e >> 5] |= 1u << (e & 31);    // clent is ALLWAYS sent
 
 // send over all entities (excpet the client) that touch the pvs
-    ent = NEXT_EDICT(sv.edicts);
-    for(e = 1; e < sv.num_edicts; e++, ent = NEXT_EDICT(ent)) {
+    b = 0;
+    for(e = 1; e < sv.num_edicts; e++) {
+        if(!hits[e >> 5]) {
+            e |= 31;
+            continue;
+        }
+        if(!(hits[e >> 5] & (1u << (e & 31)))) {
+            continue;
+        }
+        ent = EDICT_NUM(e);
 
-// ignore if not touching a PV leaf
-        if(ent != clent)    // clent is ALLWAYS sent
-        {
+        if(ent != clent) {
 // ignore ents without visible models
             if(!ent->v.modelindex || PR_GetString(ent->v.model)[0] == 0) {
                 continue;
             }
-
-            for(i = 0; i < ent->num_leafs; i++) {
-                if(pvs[ent->leafnums[i] >> 3] & (1 << (ent->leafnums[i] & 7))) {
-                    break;
-                }
-            }
-
-            if(i == ent->num_leafs) {
-                continue;
-            }        // not visible
         }
 
-        if(msg->maxsize - msg->cursize < 16) {
-            Con_Printf("packet overflow\n");
-            return;
+        if(msg->maxsize - msg->cursize < 18) {    // the largest update
+            return false;
         }
+        if(frame && frame->numentities == MAX_SNAPSHOT_ENTITIES) {
+            return false;
+        }
+
+// what goes out, rounded the way the message will have it
+        VectorCopy (ent->v.origin, state.origin);
+        VectorCopy (ent->v.angles, state.angles);
+        state.modelindex = ent->v.modelindex;
+        state.frame = ent->v.frame;
+        state.colormap = ent->v.colormap;
+        state.skin = ent->v.skin;
+        state.effects = ent->v.effects;
+
+        to = frame ? &frame->entities[frame->numentities++] : &sent;
+        SV_PackEntity(to, e, &state);
 
 // send an update
-        bits = 0;
+        if(frame) {
+            while(base && b < base->numentities && base->entities[b].num < e) {
+                b++;
+            }
+            if(base && b < base->numentities && base->entities[b].num == e) {
+                from = &base->entities[b];
+            } else {
+                SV_PackEntity(&baseline, e, &ent->baseline);
+                from = &baseline;
+            }
+            bits = SV_DeltaBits(from, to);
+        } else {
+            bits = 0;
 
-        for(i = 0; i < 3; i++) {
-            miss = ent->v.origin[i] - ent->baseline.origin[i];
-            if(miss < -0.1 || miss > 0.1) {
-                bits |= U_ORIGIN1 << i;
+            for(i = 0; i < 3; i++) {
+                miss = ent->v.origin[i] - ent->baseline.origin[i];
+                if(miss < -0.1 || miss > 0.1) {
+                    bits |= U_ORIGIN1 << i;
+                }
             }
-        }
 
-        if(ent->v.angles[0] != ent->baseline.angles[0]) {
-            bits |= U_ANGLE1;
-        }
+            if(ent->v.angles[0] != ent->baseline.angles[0]) {
+                bits |= U_ANGLE1;
+            }
 
-        if(ent->v.angles[1] != ent->baseline.angles[1]) {
-            bits |= U_ANGLE2;
-        }
+            if(ent->v.angles[1] != ent->baseline.angles[1]) {
+                bits |= U_ANGLE2;
+            }
 
-        if(ent->v.angles[2] != ent->baseline.angles[2]) {
-            bits |= U_ANGLE3;
-        }
+            if(ent->v.angles[2] != ent->baseline.angles[2]) {
+                bits |= U_ANGLE3;
+            }
 
-        if(ent->v.movetype == MOVETYPE_STEP) {
-            bits |= U_NOLERP;
-        }    // don't mess up the step animation
+            if(ent->baseline.colormap != ent->v.colormap)
+                bits |= U_COLORMAP;
 
-        if(ent->baseline.colormap != ent->v.colormap)
-            bits |= U_COLORMAP;
+            if(ent->baseline.skin != ent->v.skin)
+                bits |= U_SKIN;
 
-        if(ent->baseline.skin != ent->v.skin)
-            bits |= U_SKIN;
+            if(ent->baseline.frame != ent->v.frame)
+                bits |= U_FRAME;
 
-        if(ent->baseline.frame != ent->v.frame)
-            bits |= U_FRAME;
+            if(ent->baseline.effects != ent->v.effects)
+                bits |= U_EFFECTS;
 
-        if(ent->baseline.effects != ent->v.effects)
-            bits |= U_EFFECTS;
+            if(ent->baseline.modelindex != ent->v.modelindex)
+                bits |= U_MODEL;
+        }
 
-        if(ent->baseline.modelindex != ent->v.modelindex)
-            bits |= U_MODEL;
+        if(ent->v.movetype == MOVETYPE_STEP) {
+            bits |= U_NOLERP;
+        }    // don't mess up the step animation
 
         if(e >= 256)
             bits |= U_LONGENTITY;
@@ -528,28 +889,30 @@ void SV_WriteEntitiesToClient(edict_t *clent, sizebuf_t *msg) {
             MSG_WriteByte(msg, e);
 
         if(bits & U_MODEL)
-            MSG_WriteByte(msg, ent->v.modelindex);
+            MSG_WriteByte(msg, to->modelindex);
         if(bits & U_FRAME)
-            MSG_WriteByte(msg, ent->v.frame);
+            MSG_WriteByte(msg, to->frame);
         if(bits & U_COLORMAP)
-            MSG_WriteByte(msg, ent->v.colormap);
+            MSG_WriteByte(msg, to->colormap);
         if(bits & U_SKIN)
-            MSG_WriteByte(msg, ent->v.skin);
+            MSG_WriteByte(msg, to->skin);
         if(bits & U_EFFECTS)
-            MSG_WriteByte(msg, ent->v.effects);
+            MSG_WriteByte(msg, to->effects);
         if(bits & U_ORIGIN1)
-            MSG_WriteCoord(msg, ent->v.origin[0]);
+            MSG_WriteShort(msg, to->origin[0]);
         if(bits & U_ANGLE1)
-            MSG_WriteAngle(msg, ent->v.angles[0]);
+            MSG_WriteByte(msg, to->angles[0]);
         if(bits & U_ORIGIN2)
-            MSG_WriteCoord(msg, ent->v.origin[1]);
+            MSG_WriteShort(msg, to->origin[1]);
         if(bits & U_ANGLE2)
-            MSG_WriteAngle(msg, ent->v.angles[1]);
+            MSG_WriteByte(msg, to->angles[1]);
         if(bits & U_ORIGIN3)
-            MSG_WriteCoord(msg, ent->v.origin[2]);
+            MSG_WriteShort(msg, to->origin[2]);
         if(bits & U_ANGLE3)
-            MSG_WriteAngle(msg, ent->v.angles[2]);
+            MSG_WriteByte(msg, to->angles[2]);
     }
+
+    return true;
 }
 
 /*
@@ -575,6 +938,7 @@ SV_WriteClientdataToMessage
 ==================
 */
 void SV_WriteClientdataToMessage(edict_t *ent, sizebuf_t *msg) {
+    static edictfield_t ef_items2 = { "items2" };
     int bits;
     int i;
     edict_t *other;
@@ -623,7 +987,7 @@ void SV_WriteClientdataToMessage(edict_t *ent, sizebuf_t *msg) {
 
 // stuff the sigil bits into the high bits of items for sbar, or else
 // mix in items2
-    val = GetEdictFieldValue(ent, "items2");
+    val = GetEdictField(ent, &ef_items2);
 
     if(val) {
         items = (int)ent->v.items | ((int)val->_float << 23);
@@ -717,32 +1081,154 @@ void SV_WriteClientdataToMessage(edict_t *ent, sizebuf_t *msg) {
 
 /*
 =======================
-SV_SendClientDatagram
+SV_SnapshotJob
 =======================
 */
-qboolean SV_SendClientDatagram(client_t *client) {
-    byte buf[MAX_DATAGRAM];
-    sizebuf_t msg;
+static void SV_SnapshotJob(void *data, int index) {
+    client_t *client = ((client_t **)data)[index];
+    snapshot_t *snap = &sv_snapshots[client - svs.clients];
+    byte *pvs;
 
-    msg.data = buf;
-    msg.maxsize = sizeof(buf);
-    msg.cursize = 0;
+// find the client's PVS
+    if(snap->pvs) {
+        pvs = (byte *)snap->pvs->row;
+    } else if(snap->fill) {
+        SV_BuildFatPVS(&snap->fill->key, snap->fill->row);
+        snap->fill->ready = true;
+        pvs = (byte *)snap->fill->row;
+    } else {
+        pvs = SV_FatPVS(snap->org);
+    }
 
-    MSG_WriteByte(&msg, svc_time);
-    MSG_WriteFloat(&msg, sv.time);
+    snap->complete = SV_WriteEntitiesToClient(client->edict, pvs, &snap->msg, snap->frame, snap->base);
+}
+
+/*
+=======================
+SV_StartSnapshot
+=======================
+*/
+static void SV_StartSnapshot(client_t *client) {
+    snapshot_t *snap = &sv_snapshots[client - svs.clients];
+    snapframe_t *frames;
+    int sequence, base;
+    fatleafs_t leafs;
+
+    snap->build = sv_snapshotbuild;
+    snap->msg.data = snap->buf;
+    snap->msg.maxsize = sizeof(snap->buf);
+    snap->msg.cursize = 0;
+    snap->msg.allowoverflow = false;
+    snap->msg.overflowed = false;
+
+    MSG_WriteByte(&snap->msg, svc_time);
+    MSG_WriteFloat(&snap->msg, sv.time);
 
 // add the client specific data to the datagram
-    SV_WriteClientdataToMessage(client->edict, &msg);
+    host_client = client;
+    SV_WriteClientdataToMessage(client->edict, &snap->msg);
+
+// delta snapshots go against the last one the client acknowledged
+    snap->frame = NULL;
+    snap->base = NULL;
+    if(client->delta) {
+        frames = sv_snapframes[client - svs.clients];
+        sequence = client->snapshotseq++;
+        snap->frame = &frames[sequence & (SNAPSHOT_FRAMES - 1)];
+        snap->frame->sequence = sequence;
+        snap->frame->numentities = 0;
+
+        base = sequence;
+        if(client->snapshotack >= 0 && sequence - client->snapshotack < SNAPSHOT_FRAMES) {
+            base = client->snapshotack;
+            snap->base = &frames[base & (SNAPSHOT_FRAMES - 1)];
+        }
+
+        MSG_WriteByte(&snap->msg, svc_snapshot);
+        MSG_WriteByte(&snap->msg, sequence & 255);
+        MSG_WriteByte(&snap->msg, base & 255);
+    }
+    snap->entitystart = snap->msg.cursize;
+
+// look for the PVS while nothing else is touching the cache
+    VectorAdd (client->edict->v.origin, client->edict->v.view_ofs, snap->org);
+    leafs.numleafs = 0;
+    SV_FatPVSLeafs(snap->org, sv.worldmodel->nodes, &leafs);
+    snap->pvs = SV_CachedFatPVS(&leafs, &snap->fill);
+}
+
+/*
+=======================
+SV_BuildSnapshots
+
+Writes the datagram of every spawned client up to the server datagram.  The
+client data changes the client edict, so it is written here in client order,
+and the entities, which are most of the work, are written across the worker
+pool into each client's own buffer.
+=======================
+*/
+static void SV_BuildSnapshots(void) {
+    client_t *client;
+    int i, count;
+
+    sv_snapshotbuild++;
+    count = 0;
+    for(i = 0, client = svs.clients; i < svs.maxclients; i++, client++) {
+        if(client->active && client->spawned) {
+            SV_StartSnapshot(client);
+            sv_snapshotclients[count++] = client;
+        }
+    }
+
+    if(count > 1 && sv_parallelsend.value && Sys_ThreadCount() > 1) {
+        Sys_RunJobs(SV_SnapshotJob, sv_snapshotclients, count);
+    } else {
+        for(i = 0; i < count; i++) {
+            SV_SnapshotJob(sv_snapshotclients, i);
+        }
+    }
+}
+
+/*
+=======================
+SV_SendClientDatagram
+
+Sends the snapshot SV_BuildSnapshots wrote for the client this frame
+=======================
+*/
+qboolean SV_SendClientDatagram(client_t *client) {
+    snapshot_t *snap;
+    sizebuf_t *msg;
+
+    snap = &sv_snapshots[client - svs.clients];
+    if(snap->build != sv_snapshotbuild) {    // spawned since
+        SV_StartSnapshot(client);
+        SV_SnapshotJob(&client, 0);
+    }
+    msg = &snap->msg;
+
+    if(!client->datagrams) {
+        client->bandwidthstart = realtime;
+    }
+    client->datagrams++;
+    client->entitybytes += msg->cursize - snap->entitystart;
+    if(snap->base) {
+        client->deltadatagrams++;
+    }
 
-    SV_WriteEntitiesToClient(client->edict, &msg);
+    if(!snap->complete) {
+        Con_Printf("packet overflow\n");
+        client->overflows++;
+    }
 
 // copy the server datagram if there is space
-    if(msg.cursize + sv.datagram.cursize < msg.maxsize) {
-        SZ_Write(&msg, sv.datagram.data, sv.datagram.cursize);
+    if(msg->cursize + sv.datagram.cursize < msg->maxsize) {
+        SZ_Write(msg, sv.datagram.data, sv.datagram.cursize);
     }
 
 // send the datagram
-    if(NET_SendUnreliableMessage(client->netconnection, &msg) == -1) {
+    client->datagrambytes += msg->cursize;
+    if(NET_SendUnreliableMessage(client->netconnection, msg) == -1) {
         SV_DropClient(true);// if the message couldn't send, kick off
         return false;
     }
@@ -750,6 +1236,70 @@ qboolean SV_SendClientDatagram(client_t *client) {
     return true;
 }
 
+/*
+=======================
+SV_AckSnapshot
+
+The client decoded the snapshot with the low byte sequence in full, so the
+next ones can go against it
+=======================
+*/
+void SV_AckSnapshot(client_t *client, int sequence) {
+    sequence = client->snapshotseq - ((client->snapshotseq - sequence) & 255);
+    if(sequence < client->snapshotfirst || sequence >= client->snapshotseq) {
+        return;        // from the last level, or not sent yet
+    }
+
+    if(sequence > client->snapshotack) {
+        client->snapshotack = sequence;
+    }
+}
+
+/*
+=======================
+SV_Bandwidth_f
+
+bandwidth [reset] : what the datagrams to each client cost
+=======================
+*/
+void SV_Bandwidth_f(void) {
+    client_t *client;
+    double time;
+    int i;
+
+    if(!sv.active) {
+        Con_Printf("no server running\n");
+        return;
+    }
+
+    if(!Q_strcmp(Cmd_Argv(1), "reset")) {
+        for(i = 0, client = svs.clients; i < svs.maxclients; i++, client++) {
+            client->datagrams = 0;
+            client->datagrambytes = 0;
+            client->entitybytes = 0;
+            client->deltadatagrams = 0;
+            client->overflows = 0;
+        }
+        return;
+    }
+
+    Con_Printf("  # name             mode  pkts  bytes/pkt ents/pkt  bytes/s delta ovfl\n");
+    for(i = 0, client = svs.clients; i < svs.maxclients; i++, client++) {
+        if(!client->active || !client->datagrams) {
+            continue;
+        }
+        time = realtime - client->bandwidthstart;
+        if(time < 1) {
+            time = 1;
+        }
+        Con_Printf("%3i %-16.16s %-5s %5i %9.1f %8.1f %8.0f %4.0f%% %4i\n", i + 1, client->name,
+                   client->delta ? "delta" : "full", client->datagrams,
+                   (float)client->datagrambytes / client->datagrams, (float)client->entitybytes / client->datagrams,
+                   client->datagrambytes / time, 100.0f * client->deltadatagrams / client->datagrams,
+                   client->overflows);
+    }
+}
+
 /*
 =======================
 SV_UpdateToReliableMessages
@@ -820,6 +1370,9 @@ void SV_SendClientMessages(void) {
 // update frags, names, etc
     SV_UpdateToReliableMessages();
 
+// build the updates of all the clients at once
+    SV_BuildSnapshots();
+
 // build individual updates
     for(i = 0, host_client = svs.clients; i < svs.maxclients; i++, host_client++) {
         if(!host_client->active) {
@@ -1114,6 +1667,7 @@ void SV_SpawnServer(char *server) {
 // clear world interaction links
 //
     SV_ClearWorld();
+    SV_ClearFatPVS();
 
     sv.sound_precache[0] = pr_strings;
 
@@ -21,9 +21,16 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define SV_MAIN_H
 
 #include "common.h"
+#include "cvar.h"
 #include "mathlib.h"
 #include "progs.h"
 
+extern cvar_t sv_deltasnapshots;
+
+void SV_AckSnapshot(client_t *client, int sequence);
+void SV_Bandwidth_f(void);
+void SV_ClearFatPVS(void);
+void SV_PVSCache_f(void);
 void SV_CheckForNewClients(void);
 void SV_ClearDatagram(void);
 void SV_Init(void);
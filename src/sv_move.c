@@ -36,8 +36,9 @@ int c_yes, c_no;
 
 qboolean SV_CheckBottom(edict_t *ent) {
     vec3_t mins, maxs, start, stop;
-    trace_t trace;
-    int x, y;
+    vec3_t starts[5], stops[5];
+    trace_t traces[5];
+    int x, y, i;
     float mid, bottom;
 
     VectorAdd (ent->v.origin, ent->v.mins, mins);
@@ -65,33 +66,39 @@ qboolean SV_CheckBottom(edict_t *ent) {
 //
 // check it for real...
 //
+// the midpoint and the four corners are traced together
     start[2] = mins[2];
+    stop[2] = start[2] - 2 * STEPSIZE;
 
-// the midpoint must be within 16 of the bottom
     start[0] = stop[0] = (mins[0] + maxs[0]) * 0.5;
     start[1] = stop[1] = (mins[1] + maxs[1]) * 0.5;
-    stop[2] = start[2] - 2 * STEPSIZE;
-    trace = SV_Move(start, vec3_origin, vec3_origin, stop, true, ent);
+    VectorCopy (start, starts[0]);
+    VectorCopy (stop, stops[0]);
 
-    if(trace.fraction == 1.0) {
-        return false;
-    }
-    mid = bottom = trace.endpos[2];
-
-// the corners must be within 16 of the midpoint	
-    for(x = 0; x <= 1; x++) {
-        for(y = 0; y <= 1; y++) {
+    for(x = 0, i = 1; x <= 1; x++) {
+        for(y = 0; y <= 1; y++, i++) {
             start[0] = stop[0] = x ? maxs[0] : mins[0];
             start[1] = stop[1] = y ? maxs[1] : mins[1];
+            VectorCopy (start, starts[i]);
+            VectorCopy (stop, stops[i]);
+        }
+    }
 
-            trace = SV_Move(start, vec3_origin, vec3_origin, stop, true, ent);
+    SV_MoveBatch(5, starts, vec3_origin, vec3_origin, stops, true, ent, traces);
 
-            if(trace.fraction != 1.0 && trace.endpos[2] > bottom) {
-                bottom = trace.endpos[2];
-            }
-            if(trace.fraction == 1.0 || mid - trace.endpos[2] > STEPSIZE) {
-                return false;
-            }
+// the midpoint must be within 16 of the bottom
+    if(traces[0].fraction == 1.0) {
+        return false;
+    }
+    mid = bottom = traces[0].endpos[2];
+
+// the corners must be within 16 of the midpoint	
+    for(i = 1; i < 5; i++) {
+        if(traces[i].fraction != 1.0 && traces[i].endpos[2] > bottom) {
+            bottom = traces[i].endpos[2];
+        }
+        if(traces[i].fraction == 1.0 || mid - traces[i].endpos[2] > STEPSIZE) {
+            return false;
         }
     }
 
@@ -48,6 +48,7 @@ cvar_t sv_stopspeed = { "sv_stopspeed", "100" };
 cvar_t sv_gravity = { "sv_gravity", "800", false, true };
 cvar_t sv_maxvelocity = { "sv_maxvelocity", "2000" };
 cvar_t sv_nostep = { "sv_nostep", "0" };
+cvar_t sv_parallelphysics = { "sv_parallelphysics", "1" };    // trace falling and flying edicts on the worker pool
 
 #define    MOVE_EPSILON    0.01
 
@@ -151,6 +152,10 @@ void SV_Impact(edict_t *e1, edict_t *e2) {
     old_self = pr_global_struct->self;
     old_other = pr_global_struct->other;
 
+// the mover may not have been relinked at its new origin yet
+    SV_MarkLoose(e1);
+    SV_MarkLoose(e2);
+
     pr_global_struct->time = sv.time;
     if(e1->v.touch && e1->v.solid != SOLID_NOT) {
         pr_global_struct->self = EDICT_TO_PROG(e1);
@@ -347,17 +352,22 @@ SV_AddGravity
 
 ============
 */
-void SV_AddGravity(edict_t *ent) {
-    float ent_gravity;
+static edictfield_t ef_gravity = { "gravity" };
 
+static float SV_EdictGravity(edict_t *ent) {
     eval_t *val;
 
-    val = GetEdictFieldValue(ent, "gravity");
+    val = GetEdictField(ent, &ef_gravity);
     if(val && val->_float) {
-        ent_gravity = val->_float;
-    } else {
-        ent_gravity = 1.0;
+        return val->_float;
     }
+    return 1.0;
+}
+
+void SV_AddGravity(edict_t *ent) {
+    float ent_gravity;
+
+    ent_gravity = SV_EdictGravity(ent);
 
     ent->v.velocity[2] -= ent_gravity * sv_gravity.value * host_frametime;
 }
@@ -474,9 +484,11 @@ void SV_PushMove(edict_t *pusher, float movetime) {
         num_moved++;
 
         // try moving the contacted entity
+        SV_EdictChanged(pusher);
         pusher->v.solid = SOLID_NOT;
         SV_PushEntity(check, move);
         pusher->v.solid = SOLID_BSP;
+        SV_EdictChanged(pusher);
 
         // if it is still inside the pusher, block
         block = SV_TestEntityPosition(check);
@@ -487,6 +499,7 @@ void SV_PushMove(edict_t *pusher, float movetime) {
             if(check->v.solid == SOLID_NOT || check->v.solid == SOLID_TRIGGER) {    // corpse
                 check->v.mins[0] = check->v.mins[1] = 0;
                 VectorCopy (check->v.mins, check->v.maxs);
+                SV_MarkLoose(check);
                 continue;
             }
 
@@ -1114,6 +1127,150 @@ void SV_Physics_Step(edict_t *ent) {
 }
 
 
+/*
+===============================================================================
+
+SPECULATIVE MOVES
+
+===============================================================================
+*/
+
+#define MIN_SPECULATE   8    // fewer than this aren't worth waking the workers for
+
+/*
+=============
+SV_PredictVelocity
+
+The velocity SV_CheckVelocity would leave, or false if it would have to
+complain about a NaN
+=============
+*/
+static qboolean SV_PredictVelocity(edict_t *ent, vec3_t vel) {
+    int i;
+
+    for(i = 0; i < 3; i++) {
+        if(IS_NAN(vel[i]) || IS_NAN(ent->v.origin[i])) {
+            return false;
+        }
+        if(vel[i] > sv_maxvelocity.value) {
+            vel[i] = sv_maxvelocity.value;
+        } else if(vel[i] < -sv_maxvelocity.value) {
+            vel[i] = -sv_maxvelocity.value;
+        }
+    }
+    return true;
+}
+
+/*
+=============
+SV_SpeculateEdict
+
+Traces the first move SV_Physics_Toss or SV_Physics_Step will make for the
+edict, if nothing gets in the way before then.  Runs on the worker pool, so
+it must not change anything.
+=============
+*/
+static void SV_SpeculateEdict(void *data, int index) {
+    edict_t *ent;
+    vec3_t vel, move, end;
+    float ent_gravity, time;
+    int i, type;
+
+    ent = ((edict_t **)data)[index];
+    VectorCopy (ent->v.velocity, vel);
+    ent_gravity = SV_EdictGravity(ent);
+
+    if(ent->v.movetype == MOVETYPE_STEP) {
+        vel[2] -= ent_gravity * sv_gravity.value * host_frametime;
+        if(!SV_PredictVelocity(ent, vel)) {
+            return;
+        }
+        if(!vel[0] && !vel[1] && !vel[2]) {
+            return;
+        }
+
+        // the first pass of SV_FlyMove
+        time = host_frametime;
+        for(i = 0; i < 3; i++) {
+            end[i] = ent->v.origin[i] + time * vel[i];
+        }
+        SV_SpeculateMove(ent->v.origin, ent->v.mins, ent->v.maxs, end, false, ent);
+        return;
+    }
+
+    if(!SV_PredictVelocity(ent, vel)) {
+        return;
+    }
+    if(ent->v.movetype != MOVETYPE_FLY && ent->v.movetype != MOVETYPE_FLYMISSILE) {
+        vel[2] -= ent_gravity * sv_gravity.value * host_frametime;
+    }
+
+    // SV_PushEntity
+    VectorScale(vel, host_frametime, move);
+    VectorAdd (ent->v.origin, move, end);
+
+    if(ent->v.movetype == MOVETYPE_FLYMISSILE) {
+        type = MOVE_MISSILE;
+    } else if(ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT) {
+        type = MOVE_NOMONSTERS;
+    } else {
+        type = MOVE_NORMAL;
+    }
+    SV_SpeculateMove(ent->v.origin, ent->v.mins, ent->v.maxs, end, type, ent);
+}
+
+/*
+=============
+SV_SpeculateMoves
+
+Traces the moves of every falling or flying edict across the worker pool
+before the serial pass.  Everything with side effects, thinking, linking
+and touching, still happens in edict order in SV_Physics, and SV_Move only
+hands a speculated trace back if nothing solid has changed inside its
+area, so the frame comes out the same.
+=============
+*/
+static void SV_SpeculateMoves(void) {
+    edict_t *ents[MAX_EDICTS];
+    edict_t *ent;
+    int i, count;
+
+    if(!sv_parallelphysics.value || Sys_ThreadCount() < 2) {
+        return;
+    }
+
+    count = 0;
+    ent = NEXT_EDICT(sv.edicts);
+    for(i = 1; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent)) {
+        if(ent->free || i <= svs.maxclients) {
+            continue;
+        }
+
+        if(ent->v.movetype == MOVETYPE_STEP) {
+            if((int)ent->v.flags & (FL_ONGROUND | FL_FLY | FL_SWIM)) {
+                continue;
+            }
+        } else if(ent->v.movetype == MOVETYPE_TOSS || ent->v.movetype == MOVETYPE_BOUNCE
+                  || ent->v.movetype == MOVETYPE_FLY || ent->v.movetype == MOVETYPE_FLYMISSILE) {
+            if((int)ent->v.flags & FL_ONGROUND) {
+                continue;
+            }
+        } else {
+            continue;
+        }
+
+        ents[count++] = ent;
+    }
+
+    if(count < MIN_SPECULATE) {
+        return;
+    }
+
+    SV_EdictGravity(sv.edicts);        // look the field up before the workers do
+    SV_StartSpeculation(count);
+    Sys_RunJobs(SV_SpeculateEdict, ents, count);
+}
+
 /*
 ================
 SV_Physics
@@ -1124,12 +1281,19 @@ void SV_Physics(void) {
     int i;
     edict_t *ent;
 
+    Prof_Begin(PROF_PHYSICS);
+
+    SV_SplitAreaNodes();
+    SV_InvalidateTraces();
+
 // let the progs know that a new frame has started
     pr_global_struct->self = EDICT_TO_PROG(sv.edicts);
     pr_global_struct->other = EDICT_TO_PROG(sv.edicts);
     pr_global_struct->time = sv.time;
     PR_ExecuteProgram(pr_global_struct->StartFrame);
 
+    SV_SpeculateMoves();
+
 //SV_CheckAllEnts ();
 
 //
@@ -1163,9 +1327,13 @@ void SV_Physics(void) {
         }
     }
 
+    SV_EndSpeculation();
+
     if(pr_global_struct->force_retouch) {
         pr_global_struct->force_retouch--;
     }
 
     sv.time += host_frametime;
+
+    Prof_End(PROF_PHYSICS);
 }
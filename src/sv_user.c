@@ -534,6 +534,8 @@ qboolean SV_ReadClientMessage(void) {
                         ret = 1;
                     else if(Q_strncasecmp(s, "prespawn", 8) == 0)
                         ret = 1;
+                    else if(Q_strncasecmp(s, "delta", 5) == 0)
+                        ret = 1;
                     else if(Q_strncasecmp(s, "kick", 4) == 0)
                         ret = 1;
                     else if(Q_strncasecmp(s, "ping", 4) == 0)
@@ -557,6 +559,10 @@ qboolean SV_ReadClientMessage(void) {
                 case clc_move:
                     SV_ReadClientMove(&host_client->cmd);
                     break;
+
+                case clc_snapshotack:
+                    SV_AckSnapshot(host_client, MSG_ReadByte());
+                    break;
             }
         }
     } while(ret == 1);
@@ -39,6 +39,20 @@ int Sys_FileWrite(int handle, void *data, int count);
 int Sys_FileTime(char *path);
 void Sys_mkdir(char *path);
 
+void *Sys_FileMap(int handle, int size);
+// maps the whole file copy-on-write: writes through the pointer are private
+// to this process and never reach the disk. returns NULL if mapping is not
+// available, in which case the caller should fall back to Sys_FileRead
+
+//
+// shared libraries
+//
+void *Sys_LoadLibrary(char *path);
+// returns NULL if the library can't be loaded
+
+void *Sys_GetProcAddress(void *lib, char *name);
+void Sys_UnloadLibrary(void *lib);
+
 //
 // system IO
 //
@@ -52,9 +66,27 @@ void Sys_Quit(void);
 
 double Sys_FloatTime(void);
 
+double Sys_ProfileTime(void);
+// high resolution seconds for profiling; only differences are meaningful
+
 char *Sys_ConsoleInput(void);
 
 void Sys_SendKeyEvents(void);
 // Perform Key_Event () callbacks until the input que is empty
 
+//
+// threading
+//
+typedef void (*sys_jobfunc_t)(void *data, int index);
+
+void Sys_InitThreads(void);
+// starts the worker pool; -threads <n> overrides the detected CPU count
+
+int Sys_ThreadCount(void);
+// number of threads that take part in Sys_RunJobs, including the caller
+
+void Sys_RunJobs(sys_jobfunc_t func, void *data, int count);
+// calls func(data, i) for every i in [0, count) across the worker pool and
+// returns once all of them have finished. not reentrant.
+
 #endif // !SYS_H
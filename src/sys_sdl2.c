@@ -38,6 +38,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <unistd.h>
 #endif // POSIX || MSYS
 
+#ifdef POSIX
+#include <sys/mman.h>
+#endif // POSIX
+
 #ifdef MSVC
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
@@ -182,6 +186,25 @@ int	Sys_FileTime(char *path) {
     return buf.st_mtime;
 }
 
+void *Sys_FileMap(int handle, int size) {
+#ifdef POSIX
+    void *base;
+
+    if(size <= 0) {
+        return NULL;
+    }
+
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, handle, 0);
+    if(base == MAP_FAILED) {
+        return NULL;
+    }
+
+    return base;
+#else
+    return NULL;
+#endif // POSIX
+}
+
 void Sys_mkdir(char *path) {
     int result;
 #ifdef WIN32
@@ -272,6 +295,139 @@ double Sys_FloatTime(void) {
 #endif // POSIX || MSYS
 }
 
+void *Sys_LoadLibrary(char *path) {
+    return SDL_LoadObject(path);
+}
+
+void *Sys_GetProcAddress(void *lib, char *name) {
+    return SDL_LoadFunction(lib, name);
+}
+
+void Sys_UnloadLibrary(void *lib) {
+    SDL_UnloadObject(lib);
+}
+
+double Sys_ProfileTime(void) {
+    static Uint64 base;
+    static double scale;
+
+    if(!base) {
+        base = SDL_GetPerformanceCounter();
+        scale = 1.0 / (double)SDL_GetPerformanceFrequency();
+    }
+
+    return (double)(SDL_GetPerformanceCounter() - base) * scale;
+}
+
+/*
+ * Threading
+ */
+typedef struct {
+    SDL_Thread *thread;
+    SDL_sem *start;
+} sys_worker_t;
+
+static sys_worker_t sys_workers[MAX_THREADS];
+static int sys_numthreads = 1;
+static SDL_sem *sys_jobsdone;
+
+static sys_jobfunc_t sys_jobfunc;
+static void *sys_jobdata;
+static int sys_jobcount;
+static SDL_atomic_t sys_jobnext;
+
+static void Sys_WorkJobs(void) {
+    int index;
+
+    while((index = SDL_AtomicAdd(&sys_jobnext, 1)) < sys_jobcount) {
+        sys_jobfunc(sys_jobdata, index);
+    }
+}
+
+static int Sys_WorkerThread(void *data) {
+    sys_worker_t *worker = data;
+
+    while(1) {
+        SDL_SemWait(worker->start);
+        Sys_WorkJobs();
+        SDL_SemPost(sys_jobsdone);
+    }
+
+    return 0;
+}
+
+void Sys_InitThreads(void) {
+    int i, param_no;
+
+    sys_numthreads = SDL_GetCPUCount();
+
+    param_no = COM_CheckParm("-threads");
+    if(param_no && param_no < com_argc - 1) {
+        sys_numthreads = Q_atoi(com_argv[param_no + 1]);
+    }
+
+    if(sys_numthreads < 1) {
+        sys_numthreads = 1;
+    } else if(sys_numthreads > MAX_THREADS) {
+        sys_numthreads = MAX_THREADS;
+    }
+
+    sys_jobsdone = SDL_CreateSemaphore(0);
+
+    // The calling thread always takes part, so only spin up the extra ones.
+    for(i = 1; i < sys_numthreads; i++) {
+        sys_workers[i].start = SDL_CreateSemaphore(0);
+        sys_workers[i].thread = SDL_CreateThread(Sys_WorkerThread, "QuadWorker", &sys_workers[i]);
+
+        if(sys_workers[i].thread == NULL) {
+            Sys_Printf("Sys_InitThreads: unable to create worker (%s).\n", SDL_GetError());
+            SDL_DestroySemaphore(sys_workers[i].start);
+            sys_numthreads = i;
+            break;
+        }
+    }
+}
+
+int Sys_ThreadCount(void) {
+    return sys_numthreads;
+}
+
+void Sys_RunJobs(sys_jobfunc_t func, void *data, int count) {
+    int i, workers;
+
+    if(count <= 0) {
+        return;
+    }
+
+    // Not worth waking anybody up for a single job.
+    if(sys_numthreads == 1 || count == 1) {
+        for(i = 0; i < count; i++) {
+            func(data, i);
+        }
+        return;
+    }
+
+    sys_jobfunc = func;
+    sys_jobdata = data;
+    sys_jobcount = count;
+    SDL_AtomicSet(&sys_jobnext, 0);
+
+    workers = sys_numthreads - 1;
+    if(workers > count - 1) {
+        workers = count - 1;
+    }
+
+    for(i = 1; i <= workers; i++) {
+        SDL_SemPost(sys_workers[i].start);
+    }
+
+    Sys_WorkJobs();
+
+    for(i = 0; i < workers; i++) {
+        SDL_SemWait(sys_jobsdone);
+    }
+}
+
 char *Sys_ConsoleInput(void) {  // TODO: Might have to rework this for Win32 (does it have unistd.h?)
 #ifdef POSIX
     static char text[256];
@@ -330,6 +486,8 @@ int main(int argc, char** argv) {
 
     parms.membase = malloc(parms.memsize);
 
+    Sys_InitThreads();
+
     // Initialize game.
     Host_Init(&parms);
 
@@ -21,6 +21,11 @@
 
 #include <SDL.h>
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define VID_X86
+#include <immintrin.h>
+#endif // x86
+
 #ifdef RENDER_GL
 #include <glad/glad.h>
 #endif // RENDER_GL
@@ -36,6 +41,11 @@ qboolean mouse_captured = false;
 cvar_t in_mouse = { "in_mouse", "0", true };
 cvar_t in_mlook_lock = { "in_mlook_lock", "1", true };
 
+// Video mode
+cvar_t vid_width = { "vid_width", "1280", true };
+cvar_t vid_height = { "vid_height", "720", true };
+cvar_t vid_scale = { "vid_scale", "1", true };  // software only: render at 1/scale and let SDL upscale
+
 // A jumble of globals, locals, defines, and cvars, copied from gl_vidnt.c.
 // TODO: A lot has changed in the past few decades. Let's see how many of these we can axe.
 #define WARP_WIDTH		320
@@ -65,13 +75,31 @@ static byte *vid_surfcache;
 static int vid_surfcachesize;
 static int VID_highhunkmark;
 
+// Set whenever d_8to24table changes, forcing the next VID_Update to convert the whole frame.
+static qboolean vid_palettechanged = true;
+
+// Expands a run of palette indices into 32-bit pixels. Selected in VID_Init based on the host CPU.
+static void (*VID_ConvertSpan)(const byte *src, unsigned int *dst, int count);
+
+static void VID_ConvertSpan_C(const byte *src, unsigned int *dst, int count);
+#ifdef VID_X86
+static void VID_ConvertSpan_SSE2(const byte *src, unsigned int *dst, int count);
+static void VID_ConvertSpan_AVX2(const byte *src, unsigned int *dst, int count);
+#endif // VID_X86
+
 qboolean VID_AllocBuffers(int width, int height);
 #endif // RENDER_GL
 
 
-// TODO: Temporary stuff that should eventually be deleted.
-const int VID_WIDTH = 1280;
-const int VID_HEIGHT = 720;
+// The current window size, and the size of the frame the engine renders into. These only differ when
+// vid_scale is in use.
+static int vid_windowwidth;
+static int vid_windowheight;
+static int vid_renderwidth;
+static int vid_renderheight;
+static int vid_renderscale;
+
+void VID_SetMode(int width, int height, int scale);
 
 // Newer stuff that probably shouldn't be deleted. :)
 SDL_Window* sdl_window = NULL;
@@ -109,6 +137,10 @@ void VID_SetPalette(unsigned char *palette) {
     }
     d_8to24table[255] &= 0xffffff;    // 255 is transparent
 
+#ifdef RENDER_SOFT
+    vid_palettechanged = true;
+#endif // RENDER_SOFT
+
     // JACK: 3D distance calcs - k is last closest, l is the distance.
     // FIXME: Precalculate this and cache to disk.
     for (i = 0; i < (1 << 15); i++) {
@@ -141,8 +173,28 @@ void VID_ShiftPalette(unsigned char *palette) {
 }
 
 void VID_Init(unsigned char *palette) {
+    int param_no;
+
     Cvar_RegisterVariable(&in_mouse);
     Cvar_RegisterVariable(&in_mlook_lock);
+    Cvar_RegisterVariable(&vid_width);
+    Cvar_RegisterVariable(&vid_height);
+    Cvar_RegisterVariable(&vid_scale);
+
+    param_no = COM_CheckParm("-width");
+    if(param_no && param_no < com_argc - 1) {
+        Cvar_SetValue("vid_width", Q_atoi(com_argv[param_no + 1]));
+    }
+
+    param_no = COM_CheckParm("-height");
+    if(param_no && param_no < com_argc - 1) {
+        Cvar_SetValue("vid_height", Q_atoi(com_argv[param_no + 1]));
+    }
+
+    param_no = COM_CheckParm("-scale");
+    if(param_no && param_no < com_argc - 1) {
+        Cvar_SetValue("vid_scale", Q_atoi(com_argv[param_no + 1]));
+    }
 
     if(SDL_Init(SDL_INIT_VIDEO) < 0) {
         Sys_Error("Unable to initialize SDL2.\n");
@@ -155,7 +207,7 @@ void VID_Init(unsigned char *palette) {
     sdl_window = SDL_CreateWindow(
             "QuadGL",
             SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-            VID_WIDTH, VID_HEIGHT,
+            (int)vid_width.value, (int)vid_height.value,
             SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN
     );
     if(sdl_window == NULL) {
@@ -210,7 +262,7 @@ void VID_Init(unsigned char *palette) {
     sdl_window = SDL_CreateWindow(
             "Quad",
             SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-            VID_WIDTH, VID_HEIGHT,
+            (int)vid_width.value, (int)vid_height.value,
             SDL_WINDOW_SHOWN
     );
     if(sdl_window == NULL) {
@@ -227,43 +279,153 @@ void VID_Init(unsigned char *palette) {
         }
     }
 
-    sdl_texture = SDL_CreateTexture(
-        sdl_renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING,
-        VID_WIDTH, VID_HEIGHT
-    );
-    if(sdl_texture == NULL) {
-        Sys_Error("Unable to create SDL2 texture.\n");
+    VID_ConvertSpan = VID_ConvertSpan_C;
+#ifdef VID_X86
+    if(SDL_HasAVX2()) {
+        VID_ConvertSpan = VID_ConvertSpan_AVX2;
+        Con_Printf("VID: using AVX2 palette conversion\n");
+    } else if(SDL_HasSSE2()) {
+        VID_ConvertSpan = VID_ConvertSpan_SSE2;
+        Con_Printf("VID: using SSE2 palette conversion\n");
     }
+#endif // VID_X86
 #endif // RENDER_GL
 
     IN_MouseCapture(in_mouse.value > 0.0f);
 
     // Populate the vid object.
-    vid.width = VID_WIDTH;
-    vid.height = VID_HEIGHT;
     vid.numpages = 2;
-    vid.conwidth = VID_WIDTH;
-    vid.conheight = VID_HEIGHT;
-    vid.conwidth &= 0xfff8; // make it a multiple of eight
-
-    // pick a conheight that matches with correct aspect
-    vid.conheight = vid.conwidth * VID_HEIGHT / VID_WIDTH;
-
     vid.maxwarpwidth = WARP_WIDTH;
     vid.maxwarpheight = WARP_HEIGHT;
     vid.colormap = host_colormap;
     vid.fullbright = 256 - LittleLong (*((int *)vid.colormap + 2048));
 
+    VID_SetMode((int)vid_width.value, (int)vid_height.value, (int)vid_scale.value);
+
+    if(vid_renderwidth == 0) {
+        Sys_Error("Unable to set the initial video mode.\n");
+    }
+}
+
+/*
+ * Resizes the window and, for the software renderer, reallocates everything that depends on the
+ * render resolution. Safe to call between frames.
+ */
+void VID_SetMode(int width, int height, int scale) {
+    int render_width, render_height;
+#ifdef RENDER_SOFT
+    byte *new_buffer;
+    SDL_Texture *new_texture;
+#endif // RENDER_SOFT
+
+    // bound the request, and write it back so VID_CheckModeChange doesn't keep retrying it
+    if(width < 320) {
+        width = 320;
+        Cvar_SetValue("vid_width", width);
+    }
+    if(height < 200) {
+        height = 200;
+        Cvar_SetValue("vid_height", height);
+    }
+    if(scale < 1) {
+        scale = 1;
+        Cvar_SetValue("vid_scale", scale);
+    }
+
 #ifdef RENDER_SOFT
-    // TODO: Make this a bit less hardcoded. :)
-    vid_buffer = malloc(VID_WIDTH * VID_HEIGHT);
+    // The rasterizer's tables are sized for MAXWIDTH x MAXHEIGHT; anything bigger gets upscaled by SDL.
+    render_width = width / scale;
+    render_height = height / scale;
+
+    if(render_width > MAXWIDTH) {
+        render_width = MAXWIDTH;
+    }
+    if(render_height > MAXHEIGHT) {
+        render_height = MAXHEIGHT;
+    }
+    if(render_width < 320) {
+        render_width = 320;
+    }
+    if(render_height < 200) {
+        render_height = 200;
+    }
+    render_width &= ~3;     // the span drawers like aligned rows
+#else
+    render_width = width;
+    render_height = height;
+#endif // RENDER_SOFT
+
+    if(width != vid_windowwidth || height != vid_windowheight) {
+        SDL_SetWindowSize(sdl_window, width, height);
+        vid_windowwidth = width;
+        vid_windowheight = height;
+    }
+    vid_renderscale = scale;
+
+    if(render_width == vid_renderwidth && render_height == vid_renderheight) {
+        return;
+    }
+
+#ifdef RENDER_SOFT
+    if(!VID_AllocBuffers(render_width, render_height)) {
+        return;
+    }
+
+    new_buffer = realloc(vid_buffer, render_width * render_height);
+    new_texture = SDL_CreateTexture(
+        sdl_renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING,
+        render_width, render_height
+    );
+    if(new_buffer == NULL || new_texture == NULL) {
+        Sys_Error("VID_SetMode: unable to allocate a %ix%i frame.\n", render_width, render_height);
+    }
+
+    if(sdl_texture) {
+        SDL_DestroyTexture(sdl_texture);
+    }
+    sdl_texture = new_texture;
+    vid_buffer = new_buffer;
+
+    D_InitCaches(vid_surfcache, vid_surfcachesize);
+
     vid.buffer = vid.conbuffer = vid.direct = vid_buffer;
-    vid.rowbytes = vid.conrowbytes = VID_WIDTH;
+    vid.rowbytes = vid.conrowbytes = render_width;
+    vid_palettechanged = true;
+#endif // RENDER_SOFT
+
+    vid_renderwidth = render_width;
+    vid_renderheight = render_height;
+
+    vid.width = render_width;
+    vid.height = render_height;
+    vid.conwidth = render_width & 0xfff8; // make it a multiple of eight
+
+    // pick a conheight that matches with correct aspect
+    vid.conheight = vid.conwidth * render_height / render_width;
     vid.aspect = ((float)vid.height / (float)vid.width) * ((float)vid.width / (float)vid.height);
+    vid.recalc_refdef = 1;
 
-    VID_AllocBuffers(VID_WIDTH, VID_HEIGHT);
-    D_InitCaches(vid_surfcache, vid_surfcachesize);
+    Con_SafePrintf("Video mode %ix%i (rendering at %ix%i)\n", width, height, render_width, render_height);
+}
+
+/*
+ * Applies any changes to the video mode cvars. Called once the current frame is on screen.
+ */
+static void VID_CheckModeChange(void) {
+    int width, height, scale;
+
+    width = (int)vid_width.value;
+    height = (int)vid_height.value;
+    scale = 1;
+#ifdef RENDER_SOFT
+    scale = (int)vid_scale.value;
 #endif // RENDER_SOFT
+
+    if(width == vid_windowwidth && height == vid_windowheight && scale == vid_renderscale) {
+        return;
+    }
+
+    VID_SetMode(width, height, scale);
 }
 
 void VID_Shutdown(void) {
@@ -498,26 +660,139 @@ qboolean VID_AllocBuffers(int width, int height) {
     return true;
 }
 
-void VID_Update(vrect_t *rects) {
-    if(sdl_texture == NULL) {
+/*
+ * Palette conversion kernels. Each one expands count palette indices from src into
+ * d_8to24table entries at dst. The vector versions handle the bulk of the span and
+ * leave the remainder to the portable version.
+ */
+static void VID_ConvertSpan_C(const byte *src, unsigned int *dst, int count) {
+    const unsigned int *table = d_8to24table;
+
+    while(count >= 4) {
+        dst[0] = table[src[0]];
+        dst[1] = table[src[1]];
+        dst[2] = table[src[2]];
+        dst[3] = table[src[3]];
+        src += 4;
+        dst += 4;
+        count -= 4;
+    }
+
+    while(count--) {
+        *dst++ = table[*src++];
+    }
+}
+
+#ifdef VID_X86
+#if defined(__GNUC__) || defined(__clang__)
+#define VID_TARGET(isa) __attribute__((target(isa)))
+#else
+#define VID_TARGET(isa)
+#endif // __GNUC__ || __clang__
+
+static VID_TARGET("sse2") void VID_ConvertSpan_SSE2(const byte *src, unsigned int *dst, int count) {
+    // SSE2 has no gather, so the lookups stay scalar, but the stores are batched 128 bits at a time.
+    const unsigned int *table = d_8to24table;
+
+    while(count >= 8) {
+        __m128i lo = _mm_set_epi32((int)table[src[3]], (int)table[src[2]], (int)table[src[1]], (int)table[src[0]]);
+        __m128i hi = _mm_set_epi32((int)table[src[7]], (int)table[src[6]], (int)table[src[5]], (int)table[src[4]]);
+        _mm_storeu_si128((__m128i *)dst, lo);
+        _mm_storeu_si128((__m128i *)(dst + 4), hi);
+        src += 8;
+        dst += 8;
+        count -= 8;
+    }
+
+    VID_ConvertSpan_C(src, dst, count);
+}
+
+static VID_TARGET("avx2") void VID_ConvertSpan_AVX2(const byte *src, unsigned int *dst, int count) {
+    const int *table = (const int *)d_8to24table;
+
+    while(count >= 16) {
+        __m128i idx = _mm_loadu_si128((const __m128i *)src);
+        __m256i lo = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(idx), 4);
+        __m256i hi = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_srli_si128(idx, 8)), 4);
+        _mm256_storeu_si256((__m256i *)dst, lo);
+        _mm256_storeu_si256((__m256i *)(dst + 8), hi);
+        src += 16;
+        dst += 16;
+        count -= 16;
+    }
+
+    VID_ConvertSpan_C(src, dst, count);
+}
+#endif // VID_X86
+
+static void VID_ConvertRect(int x, int y, int width, int height) {
+    SDL_Rect rect;
+    byte *pixels;
+    byte *src;
+    int pitch;
+
+    // Clip to the framebuffer; the callers occasionally hand us rects that hang off the edge.
+    if(x < 0) {
+        width += x;
+        x = 0;
+    }
+    if(y < 0) {
+        height += y;
+        y = 0;
+    }
+    if(x + width > vid_renderwidth) {
+        width = vid_renderwidth - x;
+    }
+    if(y + height > vid_renderheight) {
+        height = vid_renderheight - y;
+    }
+    if(width <= 0 || height <= 0) {
         return;
     }
 
-    unsigned int *pixels = NULL;
-    int *pitch = NULL;
+    rect.x = x;
+    rect.y = y;
+    rect.w = width;
+    rect.h = height;
 
-    SDL_LockTexture(sdl_texture, NULL, (void**)&pixels, (int*)&pitch);
+    if(SDL_LockTexture(sdl_texture, &rect, (void**)&pixels, &pitch) < 0) {
+        return;
+    }
 
-    for(int i = 0; i < VID_WIDTH * VID_HEIGHT; i++) {
-        byte b = vid_buffer[i];
-        pixels[i] = d_8to24table[b];
+    src = vid_buffer + y * vid.rowbytes + x;
+    while(height--) {
+        VID_ConvertSpan(src, (unsigned int *)pixels, width);
+        src += vid.rowbytes;
+        pixels += pitch;
     }
+
     SDL_UnlockTexture(sdl_texture);
+}
+
+void VID_Update(vrect_t *rects) {
+    if(sdl_texture == NULL) {
+        return;
+    }
+
+    Prof_Begin(PROF_VIDUPDATE);
+
+    // A palette change invalidates every pixel, not just the ones that were redrawn.
+    if(vid_palettechanged || rects == NULL) {
+        vid_palettechanged = false;
+        VID_ConvertRect(0, 0, vid_renderwidth, vid_renderheight);
+    } else {
+        for(; rects; rects = rects->pnext) {
+            VID_ConvertRect(rects->x, rects->y, rects->width, rects->height);
+        }
+    }
 
     SDL_RenderCopy(sdl_renderer, sdl_texture, NULL, NULL);
     SDL_RenderPresent(sdl_renderer);
 
     WND_ProcessEvents();
+    VID_CheckModeChange();
+
+    Prof_End(PROF_VIDUPDATE);
 }
 #endif // RENDER_SOFT
 
@@ -528,12 +803,17 @@ void VID_Update(vrect_t *rects) {
 #ifdef RENDER_GL
 void GL_BeginRendering(int *x, int *y, int *width, int *height) {
     *x = *y = 0;
-    *width = VID_WIDTH;
-    *height = VID_HEIGHT;
+    *width = vid_windowwidth;
+    *height = vid_windowheight;
 }
 
 void GL_EndRendering(void) {
+    Prof_Begin(PROF_VIDUPDATE);
+
     SDL_GL_SwapWindow(sdl_window);
     WND_ProcessEvents();
+    VID_CheckModeChange();
+
+    Prof_End(PROF_VIDUPDATE);
 }
 #endif // RENDER_GL
@@ -70,7 +70,7 @@ void W_LoadWadFile(char *filename) {
     unsigned i;
     int infotableofs;
 
-    wad_base = COM_LoadHunkFile(filename);
+    wad_base = COM_LoadMappedHunkFile(filename);
     if(!wad_base) {
         Sys_Error("W_LoadWadFile: couldn't load %s", filename);
     }
@@ -40,10 +40,24 @@ typedef struct {
     trace_t trace;
     int type;
     edict_t *passedict;
+    int nodes, links;       // for areastats
 } moveclip_t;
 
 int SV_HullPointContents(hull_t *hull, int num, vec3_t p);
 
+// hull traces kept by "hullbench record"
+#define HULL_RECORDS    8192
+
+typedef struct {
+    hull_t *hull;
+    int num;
+    vec3_t p1, p2;
+} hullrecord_t;
+
+static hullrecord_t sv_hullrecords[HULL_RECORDS];
+static int sv_numhullrecords;
+static qboolean sv_hullrecording;
+
 /*
 ===============================================================================
 
@@ -53,9 +67,11 @@ HULL BOXES
 */
 
 
-static hull_t box_hull;
-static dclipnode_t box_clipnodes[6];
-static mplane_t box_planes[6];
+// one per thread, since SV_SpeculateMove traces from the worker pool
+static THREAD_LOCAL hull_t box_hull;
+static THREAD_LOCAL dclipnode_t box_clipnodes[6];
+static THREAD_LOCAL mplane_t box_planes[6];
+static THREAD_LOCAL hullnode_t box_nodes[6];
 
 /*
 ===================
@@ -88,7 +104,13 @@ void SV_InitBoxHull(void) {
 
         box_planes[i].type = i >> 1;
         box_planes[i].normal[i >> 1] = 1;
+
+        VectorCopy (box_planes[i].normal, box_nodes[i].normal);
+        box_nodes[i].type = box_planes[i].type;
+        box_nodes[i].children[0] = box_clipnodes[i].children[0];
+        box_nodes[i].children[1] = box_clipnodes[i].children[1];
     }
+    box_hull.nodes = box_nodes;
 }
 
 /*
@@ -100,6 +122,10 @@ BSP trees instead of being compared directly.
 ===================
 */
 hull_t *SV_HullForBox(vec3_t mins, vec3_t maxs) {
+    if(!box_hull.nodes) {
+        SV_InitBoxHull();        // first box on this thread
+    }
+
     box_planes[0].dist = maxs[0];
     box_planes[1].dist = mins[0];
     box_planes[2].dist = maxs[1];
@@ -107,6 +133,13 @@ hull_t *SV_HullForBox(vec3_t mins, vec3_t maxs) {
     box_planes[4].dist = maxs[2];
     box_planes[5].dist = mins[2];
 
+    box_nodes[0].dist = maxs[0];
+    box_nodes[1].dist = mins[0];
+    box_nodes[2].dist = maxs[1];
+    box_nodes[3].dist = mins[1];
+    box_nodes[4].dist = maxs[2];
+    box_nodes[5].dist = mins[2];
+
     return &box_hull;
 }
 
@@ -176,14 +209,132 @@ typedef struct areanode_s {
     struct areanode_s *children[2];
     link_t trigger_edicts;
     link_t solid_edicts;
+    vec3_t mins, maxs;
+    int depth;
 } areanode_t;
 
-#define    AREA_DEPTH    4
-#define    AREA_NODES    32
+#define    AREA_DEPTH       4       // built by SV_ClearWorld
+#define    AREA_MAXDEPTH    10      // reachable by SV_SplitAreaNodes
+#define    AREA_NODES       1024
 
 static areanode_t sv_areanodes[AREA_NODES];
 static int sv_numareanodes;
 
+cvar_t sv_areasplit = { "sv_areasplit", "16" };    // split leaves holding more entities, 0 keeps the tree fixed
+
+// what SV_Move and SV_TouchLinks had to look at, for areastats
+typedef struct {
+    int moves;
+    int movenodes;
+    int movelinks;
+    int maxmovelinks;
+    int touches;
+    int touchlinks;
+    int cachedmoves;
+    int speculated;
+    int speculatedused;
+} areastats_t;
+
+static areastats_t sv_areastats;
+
+// moves already traced since anything they could hit last changed
+#define TRACE_CACHE     512    // must be a power of two
+
+typedef struct {
+    vec3_t start, end, mins, maxs;
+    int type;
+    int passent;            // -1 for none
+} tracekey_t;
+
+typedef struct {
+    unsigned int generation;    // only current if it matches sv_tracegen
+    tracekey_t key;
+    trace_t trace;
+} cachedtrace_t;
+
+cvar_t sv_tracecache = { "sv_tracecache", "1" };
+
+static cachedtrace_t sv_traces[TRACE_CACHE];
+static unsigned int sv_tracegen = 1;
+
+// moves traced ahead of the serial physics pass, one per passedict.  one is
+// only used if nothing that could change it has happened inside its box.
+typedef struct {
+    int frame;              // only current if it matches sv_specframe
+    tracekey_t key;
+    vec3_t boxmins, boxmaxs;
+    trace_t trace;
+    int backups;            // backed up past 0, reported when it is used
+} speculated_t;
+
+#define MAX_DIRTY       1024
+
+typedef struct {
+    vec3_t mins, maxs;
+} dirtybox_t;
+
+static speculated_t sv_speculated[MAX_EDICTS];
+static int sv_specframe;
+static qboolean sv_speculating;
+static THREAD_LOCAL qboolean sv_inspeculation;    // inside SV_SpeculateMove on this thread
+static THREAD_LOCAL int sv_backups;                // traces in this speculation that backed up past 0
+
+// where solid edicts have changed since the moves were traced
+static dirtybox_t sv_dirty[MAX_DIRTY];
+static int sv_numdirty;
+
+// entities whose origin, mins, maxs, solid or abs box may have changed since
+// they were last linked, so the area nodes can't be trusted to hold them
+#define LOOSE_NO        0
+#define LOOSE_YES       1
+#define LOOSE_LINKED    2    // relinked, still in the list until the next query
+
+static int sv_loose[MAX_EDICTS];
+static int sv_numloose;
+static byte sv_loosestate[MAX_EDICTS];
+
+// the edicts on each leaf, see SV_LinkLeafs
+typedef struct {
+    int leaf;
+    int prev, next;        // -1 at the ends
+} leaflink_t;
+
+static int sv_leafedicts[MAX_MAP_LEAFS];                       // first link, -1 if none
+static leaflink_t sv_leaflinks[MAX_EDICTS * MAX_ENT_LEAFS];    // MAX_ENT_LEAFS per edict
+static byte sv_numleaflinks[MAX_EDICTS];
+
+areanode_t *SV_CreateAreaNode(int depth, vec3_t mins, vec3_t maxs);
+
+/*
+===============
+SV_DivideAreaNode
+
+Turns a leaf into a node with two empty leaves under it
+===============
+*/
+static void SV_DivideAreaNode(areanode_t *anode) {
+    vec3_t size;
+    vec3_t mins1, maxs1, mins2, maxs2;
+
+    VectorSubtract (anode->maxs, anode->mins, size);
+    if(size[0] > size[1]) {
+        anode->axis = 0;
+    } else {
+        anode->axis = 1;
+    }
+
+    anode->dist = 0.5 * (anode->maxs[anode->axis] + anode->mins[anode->axis]);
+    VectorCopy (anode->mins, mins1);
+    VectorCopy (anode->mins, mins2);
+    VectorCopy (anode->maxs, maxs1);
+    VectorCopy (anode->maxs, maxs2);
+
+    maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
+
+    anode->children[0] = SV_CreateAreaNode(anode->depth + 1, mins2, maxs2);
+    anode->children[1] = SV_CreateAreaNode(anode->depth + 1, mins1, maxs1);
+}
+
 /*
 ===============
 SV_CreateAreaNode
@@ -192,40 +343,162 @@ SV_CreateAreaNode
 */
 areanode_t *SV_CreateAreaNode(int depth, vec3_t mins, vec3_t maxs) {
     areanode_t *anode;
-    vec3_t size;
-    vec3_t mins1, maxs1, mins2, maxs2;
 
     anode = &sv_areanodes[sv_numareanodes];
     sv_numareanodes++;
 
     ClearLink(&anode->trigger_edicts);
     ClearLink(&anode->solid_edicts);
+    VectorCopy (mins, anode->mins);
+    VectorCopy (maxs, anode->maxs);
+    anode->depth = depth;
 
-    if(depth == AREA_DEPTH) {
-        anode->axis = -1;
-        anode->children[0] = anode->children[1] = NULL;
-        return anode;
+    anode->axis = -1;
+    anode->children[0] = anode->children[1] = NULL;
+
+    if(depth < AREA_DEPTH) {
+        SV_DivideAreaNode(anode);
     }
 
-    VectorSubtract (maxs, mins, size);
-    if(size[0] > size[1]) {
-        anode->axis = 0;
-    } else {
-        anode->axis = 1;
+    return anode;
+}
+
+/*
+===============
+SV_CountLinks
+===============
+*/
+static int SV_CountLinks(link_t *list) {
+    link_t *l;
+    int count;
+
+    count = 0;
+    for(l = list->next; l != list; l = l->next) {
+        count++;
+    }
+    return count;
+}
+
+/*
+===============
+SV_PushDownLinks
+
+Moves the entities that fit on one side of a freshly divided node into
+that child's list
+===============
+*/
+static void SV_PushDownLinks(areanode_t *node, qboolean triggers) {
+    link_t *list, *l, *next;
+    areanode_t *child;
+    edict_t *ent;
+
+    list = triggers ? &node->trigger_edicts : &node->solid_edicts;
+    for(l = list->next; l != list; l = next) {
+        next = l->next;
+        ent = EDICT_FROM_AREA(l);
+
+        if(ent->v.absmin[node->axis] > node->dist) {
+            child = node->children[0];
+        } else if(ent->v.absmax[node->axis] < node->dist) {
+            child = node->children[1];
+        } else {
+            continue;        // crosses the node
+        }
+
+        RemoveLink(l);
+        InsertLinkBefore(l, triggers ? &child->trigger_edicts : &child->solid_edicts);
     }
+}
+
+/*
+===============
+SV_SplitAreaNodes
 
-    anode->dist = 0.5 * (maxs[anode->axis] + mins[anode->axis]);
-    VectorCopy (mins, mins1);
-    VectorCopy (mins, mins2);
-    VectorCopy (maxs, maxs1);
-    VectorCopy (maxs, maxs2);
+Divides the leaves that have become crowded.  Called at the start of a
+server frame rather than from SV_LinkEdict, since links are walked while
+touch functions relink entities.
+===============
+*/
+void SV_SplitAreaNodes(void) {
+    areanode_t *node;
+    int i;
 
-    maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
+    if(sv_areasplit.value <= 0) {
+        return;
+    }
 
-    anode->children[0] = SV_CreateAreaNode(depth + 1, mins2, maxs2);
-    anode->children[1] = SV_CreateAreaNode(depth + 1, mins1, maxs1);
+    for(i = 0; i < sv_numareanodes && sv_numareanodes + 2 <= AREA_NODES; i++) {
+        node = &sv_areanodes[i];
+        if(node->axis != -1 || node->depth >= AREA_MAXDEPTH) {
+            continue;
+        }
+        if(SV_CountLinks(&node->trigger_edicts) + SV_CountLinks(&node->solid_edicts) <= sv_areasplit.value) {
+            continue;
+        }
 
-    return anode;
+        SV_DivideAreaNode(node);
+        SV_PushDownLinks(node, true);
+        SV_PushDownLinks(node, false);
+    }
+}
+
+/*
+===============
+SV_AreaStats_f
+
+areastats [reset] : area node shape, what SV_Move had to walk and how often
+the trace cache answered it
+===============
+*/
+void SV_AreaStats_f(void) {
+    areanode_t *node;
+    int i, count, leafs, depth, linked, longest;
+    areastats_t *st;
+
+    if(!Q_strcmp(Cmd_Argv(1), "reset")) {
+        memset (&sv_areastats, 0, sizeof(sv_areastats));
+        return;
+    }
+
+    if(!sv.active) {
+        Con_Printf("no server running\n");
+        return;
+    }
+
+    leafs = depth = linked = longest = 0;
+    for(i = 0, node = sv_areanodes; i < sv_numareanodes; i++, node++) {
+        count = SV_CountLinks(&node->trigger_edicts) + SV_CountLinks(&node->solid_edicts);
+        linked += count;
+        if(count > longest) {
+            longest = count;
+        }
+        if(node->axis == -1) {
+            leafs++;
+        }
+        if(node->depth > depth) {
+            depth = node->depth;
+        }
+    }
+
+    Con_Printf("%i nodes, %i leafs, depth %i, %i linked, longest list %i\n", sv_numareanodes, leafs, depth,
+               linked, longest);
+
+    st = &sv_areastats;
+    if(st->moves) {
+        Con_Printf("%i moves: %.1f nodes, %.1f links per move, %i at most\n", st->moves,
+                   (float)st->movenodes / st->moves, (float)st->movelinks / st->moves, st->maxmovelinks);
+    }
+    if(st->touches) {
+        Con_Printf("%i touch checks: %.1f links each\n", st->touches, (float)st->touchlinks / st->touches);
+    }
+    if(st->speculated) {
+        Con_Printf("%i moves traced ahead, %.1f%% used\n", st->speculated,
+                   100.0f * st->speculatedused / st->speculated);
+    }
+    if(st->cachedmoves) {
+        Con_Printf("%i moves from the trace cache, %.1f%% hit rate\n", st->cachedmoves,
+                   100.0f * st->cachedmoves / (st->cachedmoves + st->moves));
+    }
 }
 
 /*
@@ -240,6 +513,104 @@ void SV_ClearWorld(void) {
     memset (sv_areanodes, 0, sizeof(sv_areanodes));
     sv_numareanodes = 0;
     SV_CreateAreaNode(0, sv.worldmodel->mins, sv.worldmodel->maxs);
+
+    memset (sv_loosestate, 0, sizeof(sv_loosestate));
+    sv_numloose = 0;
+
+    memset (sv_leafedicts, -1, sizeof(sv_leafedicts));
+    memset (sv_numleaflinks, 0, sizeof(sv_numleaflinks));
+
+    SV_InvalidateTraces();
+
+    sv_numhullrecords = 0;        // the hulls are gone
+    sv_hullrecording = false;
+
+    // an error out of the physics frame can skip SV_EndSpeculation, and
+    // nothing traced against the old map may be picked up on the new one
+    memset (sv_speculated, 0, sizeof(sv_speculated));
+    sv_specframe = 0;
+    sv_speculating = false;
+    sv_numdirty = 0;
+}
+
+/*
+===============
+SV_EdictBounds
+
+Everything a move could find the edict in: the abs box it was linked with
+and where its origin has gone since
+===============
+*/
+static void SV_EdictBounds(edict_t *ent, vec3_t mins, vec3_t maxs) {
+    int i;
+
+    for(i = 0; i < 3; i++) {
+        mins[i] = ent->v.absmin[i];
+        maxs[i] = ent->v.absmax[i];
+        if(ent->v.origin[i] + ent->v.mins[i] < mins[i]) {
+            mins[i] = ent->v.origin[i] + ent->v.mins[i];
+        }
+        if(ent->v.origin[i] + ent->v.maxs[i] > maxs[i]) {
+            maxs[i] = ent->v.origin[i] + ent->v.maxs[i];
+        }
+    }
+}
+
+/*
+===============
+SV_DirtyEdict
+
+Remembers where a solid edict was changed, for SV_SpeculationClean
+===============
+*/
+static void SV_DirtyEdict(edict_t *ent) {
+    dirtybox_t *d;
+
+    if(!sv_speculating || ent->v.solid == SOLID_NOT || ent->v.solid == SOLID_TRIGGER) {
+        return;
+    }
+
+    if(sv_numdirty == MAX_DIRTY) {
+        sv_speculating = false;        // too busy to be worth checking
+        return;
+    }
+
+    d = &sv_dirty[sv_numdirty++];
+    SV_EdictBounds(ent, d->mins, d->maxs);
+}
+
+/*
+===============
+SV_MarkLoose
+
+===============
+*/
+void SV_MarkLoose(edict_t *ent) {
+    int e;
+
+    e = ((byte *)ent - (byte *)sv.edicts) / pr_edict_size;
+    if(e <= 0 || e >= MAX_EDICTS) {
+        return;
+    }
+
+    if(sv_loosestate[e] == LOOSE_NO) {
+        sv_loose[sv_numloose++] = e;
+    }
+    sv_loosestate[e] = LOOSE_YES;
+
+    SV_DirtyEdict(ent);
+    SV_InvalidateTraces();
+}
+
+/*
+===============
+SV_EdictChanged
+
+===============
+*/
+void SV_EdictChanged(edict_t *ent) {
+    SV_DirtyEdict(ent);
+    SV_InvalidateTraces();
 }
 
 /*
@@ -254,6 +625,9 @@ void SV_UnlinkEdict(edict_t *ent) {
     }        // not linked in anywhere
     RemoveLink(&ent->area);
     ent->area.prev = ent->area.next = NULL;
+
+    SV_DirtyEdict(ent);
+    SV_InvalidateTraces();
 }
 
 /*
@@ -270,6 +644,7 @@ void SV_TouchLinks(edict_t *ent, areanode_t *node) {
     for(l = node->trigger_edicts.next; l != &node->trigger_edicts; l = next) {
         next = l->next;
         touch = EDICT_FROM_AREA(l);
+        sv_areastats.touchlinks++;
         if(touch == ent) {
             continue;
         }
@@ -306,6 +681,81 @@ void SV_TouchLinks(edict_t *ent, areanode_t *node) {
     }
 }
 
+/*
+===============================================================================
+
+LEAF EDICT LISTS
+
+Every edict is on the list of each leaf in its leafnums, so a snapshot only
+looks at the edicts in the leafs the client can see.  The lists follow
+leafnums exactly, which only SV_LinkEdict changes.
+
+===============================================================================
+*/
+
+/*
+===============
+SV_LinkLeafs
+
+Moves the edict onto the lists of the leafs SV_FindTouchedLeafs just found
+===============
+*/
+static void SV_LinkLeafs(edict_t *ent, int e) {
+    leaflink_t *link;
+    int i, l;
+
+    for(i = 0, l = e * MAX_ENT_LEAFS; i < sv_numleaflinks[e]; i++, l++) {
+        link = &sv_leaflinks[l];
+        if(link->prev == -1) {
+            sv_leafedicts[link->leaf] = link->next;
+        } else {
+            sv_leaflinks[link->prev].next = link->next;
+        }
+        if(link->next != -1) {
+            sv_leaflinks[link->next].prev = link->prev;
+        }
+    }
+
+    for(i = 0, l = e * MAX_ENT_LEAFS; i < ent->num_leafs; i++, l++) {
+        link = &sv_leaflinks[l];
+        link->leaf = ent->leafnums[i];
+        link->prev = -1;
+        link->next = sv_leafedicts[link->leaf];
+        if(link->next != -1) {
+            sv_leaflinks[link->next].prev = l;
+        }
+        sv_leafedicts[link->leaf] = l;
+    }
+    sv_numleaflinks[e] = ent->num_leafs;
+}
+
+/*
+===============
+SV_PVSEdicts
+
+Sets the bit of every edict that touches a leaf in pvs
+===============
+*/
+void SV_PVSEdicts(byte *pvs, unsigned int *hits) {
+    int i, leaf, numleafs, l, e;
+
+    numleafs = sv.worldmodel->numleafs;
+    for(i = 0; i < (numleafs + 7) >> 3; i++) {
+        if(!pvs[i]) {
+            continue;
+        }
+        for(leaf = i << 3; leaf < (i << 3) + 8 && leaf < numleafs; leaf++) {
+            if(!(pvs[i] & (1 << (leaf & 7)))) {
+                continue;
+            }
+            for(l = sv_leafedicts[leaf]; l != -1; l = sv_leaflinks[l].next) {
+                e = l / MAX_ENT_LEAFS;
+                hits[e >> 5] |= 1u << (e & 31);
+            }
+        }
+    }
+}
+
 /*
 ===============
 SV_FindTouchedLeafs
@@ -360,6 +810,9 @@ SV_LinkEdict
 */
 void SV_LinkEdict(edict_t *ent, qboolean touch_triggers) {
     areanode_t *node;
+    int e;
+
+    SV_InvalidateTraces();
 
     if(ent->area.prev) {
         SV_UnlinkEdict(ent);
@@ -371,6 +824,11 @@ void SV_LinkEdict(edict_t *ent, qboolean touch_triggers) {
     if(ent->free)
         return;
 
+    e = NUM_FOR_EDICT(ent);
+    if(sv_loosestate[e] == LOOSE_YES) {
+        sv_loosestate[e] = LOOSE_LINKED;
+    }
+
 // set the abs box
     VectorAdd (ent->v.origin, ent->v.mins, ent->v.absmin);
     VectorAdd (ent->v.origin, ent->v.maxs, ent->v.absmax);
@@ -394,10 +852,13 @@ void SV_LinkEdict(edict_t *ent, qboolean touch_triggers) {
         ent->v.absmax[2] += 1;
     }
 
+    SV_DirtyEdict(ent);
+
 // link to PVS leafs
     ent->num_leafs = 0;
     if(ent->v.modelindex)
         SV_FindTouchedLeafs(ent, sv.worldmodel->nodes);
+    SV_LinkLeafs(ent, e);
 
     if(ent->v.solid == SOLID_NOT)
         return;
@@ -423,11 +884,75 @@ void SV_LinkEdict(edict_t *ent, qboolean touch_triggers) {
         InsertLinkBefore(&ent->area, &node->solid_edicts);
 
 // if touch_triggers, touch all entities at this node and decend for more
-    if(touch_triggers)
+    if(touch_triggers) {
+        sv_areastats.touches++;
         SV_TouchLinks(ent, sv_areanodes);
+    }
+}
+
+
+
+/*
+===============
+SV_RadiusLinks
+
+===============
+*/
+static void SV_RadiusLinks(areanode_t *node, vec3_t mins, vec3_t maxs, unsigned int *hits) {
+    link_t *l;
+    int e;
+
+    for(l = node->trigger_edicts.next; l != &node->trigger_edicts; l = l->next) {
+        e = ((byte *)EDICT_FROM_AREA(l) - (byte *)sv.edicts) / pr_edict_size;
+        hits[e >> 5] |= 1u << (e & 31);
+    }
+    for(l = node->solid_edicts.next; l != &node->solid_edicts; l = l->next) {
+        e = ((byte *)EDICT_FROM_AREA(l) - (byte *)sv.edicts) / pr_edict_size;
+        hits[e >> 5] |= 1u << (e & 31);
+    }
+
+    if(node->axis == -1) {
+        return;
+    }
+
+    if(maxs[node->axis] > node->dist) {
+        SV_RadiusLinks(node->children[0], mins, maxs, hits);
+    }
+    if(mins[node->axis] < node->dist) {
+        SV_RadiusLinks(node->children[1], mins, maxs, hits);
+    }
 }
 
+/*
+===============
+SV_FindRadius
+
+Sets the bit of every entity whose center could be within rad of org.  An
+entity's link box holds its center for as long as it stays linked, so only
+the area nodes the sphere reaches and the loose entities need a look.
+===============
+*/
+void SV_FindRadius(vec3_t org, float rad, unsigned int *hits) {
+    vec3_t mins, maxs;
+    int i, e, n;
+
+    for(i = 0; i < 3; i++) {
+        mins[i] = org[i] - rad - 1;
+        maxs[i] = org[i] + rad + 1;
+    }
+    SV_RadiusLinks(sv_areanodes, mins, maxs, hits);
 
+    for(i = n = 0; i < sv_numloose; i++) {
+        e = sv_loose[i];
+        if(sv_loosestate[e] == LOOSE_LINKED) {
+            sv_loosestate[e] = LOOSE_NO;
+            continue;
+        }
+        hits[e >> 5] |= 1u << (e & 31);
+        sv_loose[n++] = e;
+    }
+    sv_numloose = n;
+}
 
 /*
 ===============================================================================
@@ -439,11 +964,13 @@ POINT TESTING IN HULLS
 
 /*
 ==================
-SV_HullPointContents
+SV_ClipnodePointContents
 
+SV_HullPointContents straight from the clipnodes and planes, kept for
+SV_RecursiveHullCheck
 ==================
 */
-int SV_HullPointContents(hull_t *hull, int num, vec3_t p) {
+static int SV_ClipnodePointContents(hull_t *hull, int num, vec3_t p) {
     float d;
     dclipnode_t *node;
     mplane_t *plane;
@@ -473,16 +1000,47 @@ int SV_HullPointContents(hull_t *hull, int num, vec3_t p) {
 
 /*
 ==================
-SV_PointContents
+SV_HullPointContents
 
 ==================
 */
-int SV_PointContents(vec3_t p) {
-    int cont;
+int SV_HullPointContents(hull_t *hull, int num, vec3_t p) {
+    float d;
+    hullnode_t *node;
 
-    cont = SV_HullPointContents(&sv.worldmodel->hulls[0], 0, p);
-    if(cont <= CONTENTS_CURRENT_0 && cont >= CONTENTS_CURRENT_DOWN) {
-        cont = CONTENTS_WATER;
+    if(!hull->nodes) {
+        return SV_ClipnodePointContents(hull, num, p);
+    }
+
+    while(num >= 0) {
+        if(num < hull->firstclipnode || num > hull->lastclipnode) {
+            Sys_Error("SV_HullPointContents: bad node number");
+        }
+
+        node = hull->nodes + num;
+        if(node->type < 3) {
+            d = p[node->type] - node->dist;
+        } else {
+            d = DotProduct (node->normal, p) - node->dist;
+        }
+        num = node->children[d < 0];
+    }
+
+    return num;
+}
+
+/*
+==================
+SV_PointContents
+
+==================
+*/
+int SV_PointContents(vec3_t p) {
+    int cont;
+
+    cont = SV_HullPointContents(&sv.worldmodel->hulls[0], 0, p);
+    if(cont <= CONTENTS_CURRENT_0 && cont >= CONTENTS_CURRENT_DOWN) {
+        cont = CONTENTS_WATER;
     }
     return cont;
 }
@@ -524,6 +1082,22 @@ LINE TESTING IN HULLS
 // 1/32 epsilon to keep floating point happy
 #define    DIST_EPSILON    (0.03125)
 
+/*
+==================
+SV_BackupPastZero
+
+The console isn't safe off the main thread, so a speculated trace only counts
+it, and SV_Move prints it if the trace gets used
+==================
+*/
+static void SV_BackupPastZero(void) {
+    if(sv_inspeculation) {
+        sv_backups++;
+    } else {
+        Con_DPrintf("backup past 0\n");
+    }
+}
+
 /*
 ==================
 SV_RecursiveHullCheck
@@ -621,7 +1195,7 @@ qboolean SV_RecursiveHullCheck(hull_t *hull, int num, float p1f, float p2f, vec3
     }
 #endif
 
-    if(SV_HullPointContents(hull, node->children[side ^ 1], mid) != CONTENTS_SOLID) {
+    if(SV_ClipnodePointContents(hull, node->children[side ^ 1], mid) != CONTENTS_SOLID) {
 // go past the node
         return SV_RecursiveHullCheck(hull, node->children[side ^ 1], midf, p2f, mid, p2, trace);
     }
@@ -641,13 +1215,13 @@ qboolean SV_RecursiveHullCheck(hull_t *hull, int num, float p1f, float p2f, vec3
         trace->plane.dist = -plane->dist;
     }
 
-    while(SV_HullPointContents(hull, hull->firstclipnode, mid) ==
+    while(SV_ClipnodePointContents(hull, hull->firstclipnode, mid) ==
           CONTENTS_SOLID) { // shouldn't really happen, but does occasionally
         frac -= 0.1;
         if(frac < 0) {
             trace->fraction = midf;
             VectorCopy (mid, trace->endpos);
-            Con_DPrintf("backup past 0\n");
+            SV_BackupPastZero();
             return false;
         }
         midf = p1f + (p2f - p1f) * frac;
@@ -661,6 +1235,308 @@ qboolean SV_RecursiveHullCheck(hull_t *hull, int num, float p1f, float p2f, vec3
     return false;
 }
 
+// a split SV_HullCheck still has to come back to for the far side
+#define HULL_STACK      64
+
+typedef struct {
+    hullnode_t *node;
+    int side;
+    float frac;
+    float p1f, p2f, midf;
+    vec3_t p1, p2, mid;
+} hullsplit_t;
+
+/*
+==================
+SV_HullImpact
+
+The far side of a split is solid, so the move ends at its plane
+==================
+*/
+static qboolean SV_HullImpact(hull_t *hull, hullsplit_t *split, trace_t *trace) {
+    hullnode_t *node;
+    float frac, midf;
+    vec3_t mid;
+    int i;
+
+    if(trace->allsolid) {
+        return false;
+    }        // never got out of the solid area
+
+    node = split->node;
+    if(!split->side) {
+        VectorCopy (node->normal, trace->plane.normal);
+        trace->plane.dist = node->dist;
+    } else {
+        VectorSubtract (vec3_origin, node->normal, trace->plane.normal);
+        trace->plane.dist = -node->dist;
+    }
+
+    frac = split->frac;
+    midf = split->midf;
+    VectorCopy (split->mid, mid);
+    while(SV_HullPointContents(hull, hull->firstclipnode, mid) ==
+          CONTENTS_SOLID) { // shouldn't really happen, but does occasionally
+        frac -= 0.1;
+        if(frac < 0) {
+            trace->fraction = midf;
+            VectorCopy (mid, trace->endpos);
+            SV_BackupPastZero();
+            return false;
+        }
+        midf = split->p1f + (split->p2f - split->p1f) * frac;
+        for(i = 0; i < 3; i++)
+            mid[i] = split->p1[i] + frac * (split->p2[i] - split->p1[i]);
+    }
+
+    trace->fraction = midf;
+    VectorCopy (mid, trace->endpos);
+
+    return false;
+}
+
+/*
+==================
+SV_HullCheck
+
+SV_RecursiveHullCheck as a loop over the hull's hullnode_t layout.  The
+near side of every split is walked first and the far side is kept on a
+small stack, so the results are exactly the same.
+==================
+*/
+qboolean SV_HullCheck(hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace) {
+    hullsplit_t stack[HULL_STACK], *split;
+    hullnode_t *node;
+    vec3_t start, end;
+    float t1, t2, frac;
+    int i, depth;
+
+    if(!hull->nodes) {
+        return SV_RecursiveHullCheck(hull, num, p1f, p2f, p1, p2, trace);
+    }
+
+    VectorCopy (p1, start);
+    VectorCopy (p2, end);
+    depth = 0;
+
+    while(1) {
+        if(num < 0) {
+            if(num != CONTENTS_SOLID) {
+                trace->allsolid = false;
+                if(num == CONTENTS_EMPTY) {
+                    trace->inopen = true;
+                } else {
+                    trace->inwater = true;
+                }
+            } else {
+                trace->startsolid = true;
+            }
+        } else if(depth == HULL_STACK) {
+            // out of stack, let the recursion finish this side
+            if(!SV_RecursiveHullCheck(hull, num, p1f, p2f, start, end, trace)) {
+                return false;
+            }
+        } else {
+            if(num < hull->firstclipnode || num > hull->lastclipnode) {
+                Sys_Error("SV_HullCheck: bad node number");
+            }
+
+            node = hull->nodes + num;
+            if(node->type < 3) {
+                t1 = start[node->type] - node->dist;
+                t2 = end[node->type] - node->dist;
+            } else {
+                t1 = DotProduct (node->normal, start) - node->dist;
+                t2 = DotProduct (node->normal, end) - node->dist;
+            }
+
+            if(t1 >= 0 && t2 >= 0) {
+                num = node->children[0];
+                continue;
+            }
+            if(t1 < 0 && t2 < 0) {
+                num = node->children[1];
+                continue;
+            }
+
+            // put the crosspoint DIST_EPSILON pixels on the near side
+            if(t1 < 0) {
+                frac = (t1 + DIST_EPSILON) / (t1 - t2);
+            } else {
+                frac = (t1 - DIST_EPSILON) / (t1 - t2);
+            }
+            if(frac < 0) {
+                frac = 0;
+            }
+            if(frac > 1) {
+                frac = 1;
+            }
+
+            split = &stack[depth++];
+            split->node = node;
+            split->side = (t1 < 0);
+            split->frac = frac;
+            split->p1f = p1f;
+            split->p2f = p2f;
+            split->midf = p1f + (p2f - p1f) * frac;
+            VectorCopy (start, split->p1);
+            VectorCopy (end, split->p2);
+            for(i = 0; i < 3; i++) {
+                split->mid[i] = start[i] + frac * (end[i] - start[i]);
+            }
+
+            // move up to the node
+            num = node->children[split->side];
+            p2f = split->midf;
+            VectorCopy (split->mid, end);
+            continue;
+        }
+
+        // this side is done, go back to the innermost split
+        if(!depth) {
+            return true;
+        }
+        split = &stack[--depth];
+
+        if(SV_HullPointContents(hull, split->node->children[split->side ^ 1], split->mid) == CONTENTS_SOLID) {
+            return SV_HullImpact(hull, split, trace);
+        }
+
+        // go past the node
+        num = split->node->children[split->side ^ 1];
+        p1f = split->midf;
+        p2f = split->p2f;
+        VectorCopy (split->mid, start);
+        VectorCopy (split->p2, end);
+    }
+}
+
+/*
+===============================================================================
+
+HULL BENCHMARK
+
+===============================================================================
+*/
+
+/*
+==================
+SV_RecordHullCheck
+==================
+*/
+static void SV_RecordHullCheck(hull_t *hull, int num, vec3_t p1, vec3_t p2) {
+    hullrecord_t *r;
+
+    if(hull == &box_hull) {
+        return;        // its planes change with every box
+    }
+    if(sv_inspeculation) {
+        return;        // may be on a worker
+    }
+    if(sv_numhullrecords == HULL_RECORDS) {
+        sv_hullrecording = false;
+        Con_Printf("hullbench: recorded %i traces\n", sv_numhullrecords);
+        return;
+    }
+
+    r = &sv_hullrecords[sv_numhullrecords++];
+    r->hull = hull;
+    r->num = num;
+    VectorCopy (p1, r->p1);
+    VectorCopy (p2, r->p2);
+}
+
+/*
+==================
+SV_ReplayHullChecks
+
+Runs every recorded trace passes times through one of the hull checks and
+returns the time it took
+==================
+*/
+static double SV_ReplayHullChecks(qboolean iterative, int passes, trace_t *traces, qboolean *results) {
+    hullrecord_t *r;
+    trace_t *trace;
+    double start;
+    int i, pass;
+
+    start = Sys_ProfileTime();
+    for(pass = 0; pass < passes; pass++) {
+        for(i = 0, r = sv_hullrecords; i < sv_numhullrecords; i++, r++) {
+            trace = &traces[i];
+            memset (trace, 0, sizeof(trace_t));
+            trace->fraction = 1;
+            trace->allsolid = true;
+            VectorCopy (r->p2, trace->endpos);
+
+            if(iterative) {
+                results[i] = SV_HullCheck(r->hull, r->num, 0, 1, r->p1, r->p2, trace);
+            } else {
+                results[i] = SV_RecursiveHullCheck(r->hull, r->num, 0, 1, r->p1, r->p2, trace);
+            }
+        }
+    }
+
+    return Sys_ProfileTime() - start;
+}
+
+/*
+==================
+SV_HullBench_f
+
+hullbench record   : record the hull traces of the next frames on this map
+hullbench [passes] : replay them through the recursive and iterative checks
+==================
+*/
+void SV_HullBench_f(void) {
+    trace_t *oldtraces, *newtraces;
+    qboolean *oldresults, *newresults;
+    double oldtime, newtime;
+    int i, passes, mismatches;
+
+    if(!sv.active) {
+        Con_Printf("no server running\n");
+        return;
+    }
+
+    if(!Q_strcmp(Cmd_Argv(1), "record")) {
+        sv_numhullrecords = 0;
+        sv_hullrecording = true;
+        Con_Printf("hullbench: recording %i traces\n", HULL_RECORDS);
+        return;
+    }
+
+    sv_hullrecording = false;
+    if(!sv_numhullrecords) {
+        Con_Printf("nothing recorded, use hullbench record\n");
+        return;
+    }
+
+    passes = Cmd_Argc() > 1 ? Q_atoi(Cmd_Argv(1)) : 10;
+    if(passes < 1) {
+        passes = 1;
+    }
+
+    oldtraces = Hunk_TempAlloc(sv_numhullrecords * 2 * (sizeof(trace_t) + sizeof(qboolean)));
+    newtraces = oldtraces + sv_numhullrecords;
+    oldresults = (qboolean *)(newtraces + sv_numhullrecords);
+    newresults = oldresults + sv_numhullrecords;
+
+    oldtime = SV_ReplayHullChecks(false, passes, oldtraces, oldresults);
+    newtime = SV_ReplayHullChecks(true, passes, newtraces, newresults);
+
+    mismatches = 0;
+    for(i = 0; i < sv_numhullrecords; i++) {
+        if(oldresults[i] != newresults[i] || memcmp(&oldtraces[i], &newtraces[i], sizeof(trace_t))) {
+            mismatches++;
+        }
+    }
+
+    Con_Printf("%i traces x %i: recursive %.2f ms, iterative %.2f ms, %.2fx\n", sv_numhullrecords, passes,
+               oldtime * 1000, newtime * 1000, newtime > 0 ? oldtime / newtime : 0);
+    Con_Printf("%i results differ\n", mismatches);
+}
+
 /*
 ==================
 SV_ClipMoveToEntity
@@ -687,8 +1563,12 @@ trace_t SV_ClipMoveToEntity(edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs
     VectorSubtract (start, offset, start_l);
     VectorSubtract (end, offset, end_l);
 
+    if(sv_hullrecording) {
+        SV_RecordHullCheck(hull, hull->firstclipnode, start_l, end_l);
+    }
+
     // trace a line through the apropriate clipping hull
-    SV_RecursiveHullCheck(hull, hull->firstclipnode, 0, 1, start_l, end_l, &trace);
+    SV_HullCheck(hull, hull->firstclipnode, 0, 1, start_l, end_l, &trace);
 
     // fix trace up by the offset
     if(trace.fraction != 1) VectorAdd (trace.endpos, offset, trace.endpos);
@@ -703,6 +1583,68 @@ trace_t SV_ClipMoveToEntity(edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs
 
 //===========================================================================
 
+/*
+====================
+SV_ClipToEdict
+
+Returns false once the move is all solid, since nothing after that can
+change it
+====================
+*/
+static qboolean SV_ClipToEdict(edict_t *touch, moveclip_t *clip) {
+    trace_t trace;
+
+    if(touch->v.solid == SOLID_NOT) {
+        return true;
+    }
+    if(touch == clip->passedict) {
+        return true;
+    }
+    if(touch->v.solid == SOLID_TRIGGER) {
+        Sys_Error("Trigger in clipping list");
+    }
+
+    if(clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP) {
+        return true;
+    }
+
+    if(clip->boxmins[0] > touch->v.absmax[0] || clip->boxmins[1] > touch->v.absmax[1] ||
+       clip->boxmins[2] > touch->v.absmax[2] || clip->boxmaxs[0] < touch->v.absmin[0] ||
+       clip->boxmaxs[1] < touch->v.absmin[1] || clip->boxmaxs[2] < touch->v.absmin[2]) {
+        return true;
+    }
+
+    if(clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0]) {
+        return true;
+    }    // points never interact
+
+    // might intersect, so do an exact clip
+    if(clip->trace.allsolid)
+        return false;
+    if(clip->passedict) {
+        if(PROG_TO_EDICT(touch->v.owner) == clip->passedict)
+            return true;    // don't clip against own missiles
+        if(PROG_TO_EDICT(clip->passedict->v.owner) == touch)
+            return true;    // don't clip against owner
+    }
+
+    if((int)touch->v.flags & FL_MONSTER)
+        trace = SV_ClipMoveToEntity(touch, clip->start, clip->mins2, clip->maxs2, clip->end);
+    else
+        trace = SV_ClipMoveToEntity(touch, clip->start, clip->mins, clip->maxs, clip->end);
+    if(trace.allsolid || trace.startsolid || trace.fraction < clip->trace.fraction) {
+        trace.ent = touch;
+        if(clip->trace.startsolid) {
+            clip->trace = trace;
+            clip->trace.startsolid = true;
+        } else
+            clip->trace = trace;
+    } else if(trace.startsolid)
+        clip->trace.startsolid = true;
+
+    return true;
+}
+
 /*
 ====================
 SV_ClipToLinks
@@ -712,73 +1654,76 @@ Mins and maxs enclose the entire area swept by the move
 */
 void SV_ClipToLinks(areanode_t *node, moveclip_t *clip) {
     link_t *l, *next;
-    edict_t *touch;
-    trace_t trace;
+
+    clip->nodes++;
 
 // touch linked edicts
     for(l = node->solid_edicts.next; l != &node->solid_edicts; l = next) {
         next = l->next;
-        touch = EDICT_FROM_AREA(l);
-        if(touch->v.solid == SOLID_NOT) {
-            continue;
+        clip->links++;
+        if(!SV_ClipToEdict(EDICT_FROM_AREA(l), clip)) {
+            return;
         }
-        if(touch == clip->passedict) {
+    }
+
+// recurse down both sides
+    if(node->axis == -1) {
+        return;
+    }
+
+    if(clip->boxmaxs[node->axis] > node->dist) {
+        SV_ClipToLinks(node->children[0], clip);
+    }
+    if(clip->boxmins[node->axis] < node->dist) {
+        SV_ClipToLinks(node->children[1], clip);
+    }
+}
+
+/*
+====================
+SV_GatherLinks
+
+Collects, in SV_ClipToLinks order, the edicts that any of a batch of moves
+could clip against.  The box tests against each single move are left to
+SV_ClipToEdict.
+====================
+*/
+static int SV_GatherLinks(areanode_t *node, moveclip_t *clip, edict_t **list, int count) {
+    link_t *l;
+    edict_t *touch;
+
+    clip->nodes++;
+
+    for(l = node->solid_edicts.next; l != &node->solid_edicts; l = l->next) {
+        touch = EDICT_FROM_AREA(l);
+        clip->links++;
+        if(touch->v.solid == SOLID_NOT || touch == clip->passedict) {
             continue;
         }
-        if(touch->v.solid == SOLID_TRIGGER) {
-            Sys_Error("Trigger in clipping list");
-        }
-
         if(clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP) {
             continue;
         }
-
         if(clip->boxmins[0] > touch->v.absmax[0] || clip->boxmins[1] > touch->v.absmax[1] ||
            clip->boxmins[2] > touch->v.absmax[2] || clip->boxmaxs[0] < touch->v.absmin[0] ||
            clip->boxmaxs[1] < touch->v.absmin[1] || clip->boxmaxs[2] < touch->v.absmin[2]) {
             continue;
         }
-
-        if(clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0]) {
-            continue;
-        }    // points never interact
-
-        // might intersect, so do an exact clip
-        if(clip->trace.allsolid)
-            return;
-        if(clip->passedict) {
-            if(PROG_TO_EDICT(touch->v.owner) == clip->passedict)
-                continue;    // don't clip against own missiles
-            if(PROG_TO_EDICT(clip->passedict->v.owner) == touch)
-                continue;    // don't clip against owner
+        if(count < MAX_EDICTS) {
+            list[count++] = touch;
         }
-
-        if((int)touch->v.flags & FL_MONSTER)
-            trace = SV_ClipMoveToEntity(touch, clip->start, clip->mins2, clip->maxs2, clip->end);
-        else
-            trace = SV_ClipMoveToEntity(touch, clip->start, clip->mins, clip->maxs, clip->end);
-        if(trace.allsolid || trace.startsolid || trace.fraction < clip->trace.fraction) {
-            trace.ent = touch;
-            if(clip->trace.startsolid) {
-                clip->trace = trace;
-                clip->trace.startsolid = true;
-            } else
-                clip->trace = trace;
-        } else if(trace.startsolid)
-            clip->trace.startsolid = true;
     }
 
-// recurse down both sides
     if(node->axis == -1) {
-        return;
+        return count;
     }
 
     if(clip->boxmaxs[node->axis] > node->dist) {
-        SV_ClipToLinks(node->children[0], clip);
+        count = SV_GatherLinks(node->children[0], clip, list, count);
     }
     if(clip->boxmins[node->axis] < node->dist) {
-        SV_ClipToLinks(node->children[1], clip);
+        count = SV_GatherLinks(node->children[1], clip, list, count);
     }
+    return count;
 }
 
 /*
@@ -802,41 +1747,349 @@ void SV_MoveBounds(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, vec3_t bo
 
 /*
 ==================
-SV_Move
+SV_TraceKey
 ==================
 */
-trace_t SV_Move(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict) {
-    moveclip_t clip;
+static void SV_TraceKey(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict,
+                        tracekey_t *key) {
+    VectorCopy (start, key->start);
+    VectorCopy (end, key->end);
+    VectorCopy (mins, key->mins);
+    VectorCopy (maxs, key->maxs);
+    key->type = type;
+    key->passent = passedict ? ((byte *)passedict - (byte *)sv.edicts) / pr_edict_size : -1;
+}
+
+/*
+==================
+SV_TraceSlot
+
+Finds where a move is kept in the trace cache.  The slot only holds its
+result if its generation is current and its key matches.
+==================
+*/
+static cachedtrace_t *SV_TraceSlot(tracekey_t *key) {
+    unsigned int hash;
+    int *words;
     int i;
 
-    memset (&clip, 0, sizeof(moveclip_t));
+    hash = 2166136261u;
+    words = (int *)key;
+    for(i = 0; i < sizeof(tracekey_t) / sizeof(int); i++) {
+        hash ^= words[i];
+        hash *= 16777619u;
+    }
 
-// clip to world
-    clip.trace = SV_ClipMoveToEntity(sv.edicts, start, mins, maxs, end);
+    return &sv_traces[(hash ^ (hash >> 16)) & (TRACE_CACHE - 1)];
+}
+
+static qboolean SV_TraceCached(cachedtrace_t *slot, tracekey_t *key) {
+    return slot->generation == sv_tracegen && !memcmp(&slot->key, key, sizeof(tracekey_t));
+}
 
-    clip.start = start;
-    clip.end = end;
-    clip.mins = mins;
-    clip.maxs = maxs;
-    clip.type = type;
-    clip.passedict = passedict;
+/*
+==================
+SV_InvalidateTraces
+
+==================
+*/
+void SV_InvalidateTraces(void) {
+    if(!++sv_tracegen) {
+        memset (sv_traces, 0, sizeof(sv_traces));
+        sv_tracegen = 1;
+    }
+}
+
+/*
+==================
+SV_InitMoveClip
+==================
+*/
+static void SV_InitMoveClip(moveclip_t *clip, vec3_t mins, vec3_t maxs, int type, edict_t *passedict) {
+    int i;
+
+    memset (clip, 0, sizeof(moveclip_t));
+
+    clip->mins = mins;
+    clip->maxs = maxs;
+    clip->type = type;
+    clip->passedict = passedict;
 
     if(type == MOVE_MISSILE) {
         for(i = 0; i < 3; i++) {
-            clip.mins2[i] = -15;
-            clip.maxs2[i] = 15;
+            clip->mins2[i] = -15;
+            clip->maxs2[i] = 15;
         }
     } else {
-        VectorCopy (mins, clip.mins2);
-        VectorCopy (maxs, clip.maxs2);
+        VectorCopy (mins, clip->mins2);
+        VectorCopy (maxs, clip->maxs2);
+    }
+}
+
+/*
+==================
+SV_CountMove
+==================
+*/
+static void SV_CountMove(moveclip_t *clip, int moves) {
+    sv_areastats.moves += moves;
+    sv_areastats.movenodes += clip->nodes;
+    sv_areastats.movelinks += clip->links;
+    if(clip->links > sv_areastats.maxmovelinks) {
+        sv_areastats.maxmovelinks = clip->links;
     }
+}
+
+/*
+==================
+SV_ClipMove
+
+The work behind SV_Move, which leaves the cache and the stats alone
+==================
+*/
+static trace_t SV_ClipMove(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict,
+                           moveclip_t *clip) {
+    SV_InitMoveClip(clip, mins, maxs, type, passedict);
+
+// clip to world
+    clip->trace = SV_ClipMoveToEntity(sv.edicts, start, mins, maxs, end);
+
+    clip->start = start;
+    clip->end = end;
 
 // create the bounding box of the entire move
-    SV_MoveBounds(start, clip.mins2, clip.maxs2, end, clip.boxmins, clip.boxmaxs);
+    SV_MoveBounds(start, clip->mins2, clip->maxs2, end, clip->boxmins, clip->boxmaxs);
 
 // clip to entities
-    SV_ClipToLinks(sv_areanodes, &clip);
+    SV_ClipToLinks(sv_areanodes, clip);
+
+    return clip->trace;
+}
+
+/*
+==================
+SV_SpeculationClean
+
+True if no solid edict has changed inside the box since the speculative
+moves were traced
+==================
+*/
+static qboolean SV_SpeculationClean(vec3_t boxmins, vec3_t boxmaxs) {
+    dirtybox_t *d;
+    edict_t *ent;
+    vec3_t mins, maxs;
+    int i;
+
+    for(i = 0, d = sv_dirty; i < sv_numdirty; i++, d++) {
+        if(boxmins[0] <= d->maxs[0] && boxmins[1] <= d->maxs[1] && boxmins[2] <= d->maxs[2] &&
+           boxmaxs[0] >= d->mins[0] && boxmaxs[1] >= d->mins[1] && boxmaxs[2] >= d->mins[2]) {
+            return false;
+        }
+    }
+
+// loose edicts may have had their abs box stored to since they were marked
+    for(i = 0; i < sv_numloose; i++) {
+        if(sv_loosestate[sv_loose[i]] != LOOSE_YES) {
+            continue;
+        }
+        ent = EDICT_NUM(sv_loose[i]);
+        if(ent->free || ent->v.solid == SOLID_NOT || ent->v.solid == SOLID_TRIGGER) {
+            continue;
+        }
+        SV_EdictBounds(ent, mins, maxs);
+        if(boxmins[0] <= maxs[0] && boxmins[1] <= maxs[1] && boxmins[2] <= maxs[2] &&
+           boxmaxs[0] >= mins[0] && boxmaxs[1] >= mins[1] && boxmaxs[2] >= mins[2]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+==================
+SV_Move
+==================
+*/
+trace_t SV_Move(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict) {
+    moveclip_t clip;
+    cachedtrace_t *slot;
+    speculated_t *spec;
+    tracekey_t key;
+
+    if(sv_speculating && passedict) {
+        spec = &sv_speculated[((byte *)passedict - (byte *)sv.edicts) / pr_edict_size];
+        SV_TraceKey(start, mins, maxs, end, type, passedict, &key);
+        if(spec->frame == sv_specframe && !memcmp(&spec->key, &key, sizeof(tracekey_t))) {
+            spec->frame = 0;
+            if(SV_SpeculationClean(spec->boxmins, spec->boxmaxs)) {
+                for(; spec->backups; spec->backups--) {
+                    Con_DPrintf("backup past 0\n");
+                }
+                sv_areastats.speculatedused++;
+                return spec->trace;
+            }
+        }
+    }
+
+    slot = NULL;
+    if(sv_tracecache.value) {
+        SV_TraceKey(start, mins, maxs, end, type, passedict, &key);
+        slot = SV_TraceSlot(&key);
+        if(SV_TraceCached(slot, &key)) {
+            sv_areastats.cachedmoves++;
+            return slot->trace;
+        }
+    }
+
+    SV_ClipMove(start, mins, maxs, end, type, passedict, &clip);
+    SV_CountMove(&clip, 1);
+
+    if(slot) {
+        slot->generation = sv_tracegen;
+        slot->key = key;
+        slot->trace = clip.trace;
+    }
 
     return clip.trace;
 }
 
+/*
+==================
+SV_StartSpeculation
+
+Called before the SV_SpeculateMove calls of a frame
+==================
+*/
+void SV_StartSpeculation(int count) {
+    if(++sv_specframe <= 0) {
+        memset (sv_speculated, 0, sizeof(sv_speculated));
+        sv_specframe = 1;
+    }
+
+    sv_numdirty = 0;
+    sv_speculating = true;
+    sv_areastats.speculated += count;
+}
+
+/*
+==================
+SV_EndSpeculation
+
+==================
+*/
+void SV_EndSpeculation(void) {
+    sv_speculating = false;
+}
+
+/*
+==================
+SV_SpeculateMove
+
+Traces a move for passedict ahead of time, for a later SV_Move with the
+same arguments to pick up.  Safe to call from the worker pool, as long as
+nothing else is running.
+==================
+*/
+void SV_SpeculateMove(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict) {
+    moveclip_t clip;
+    speculated_t *spec;
+
+    spec = &sv_speculated[((byte *)passedict - (byte *)sv.edicts) / pr_edict_size];
+    SV_TraceKey(start, mins, maxs, end, type, passedict, &spec->key);
+
+    sv_backups = 0;
+    sv_inspeculation = true;
+    spec->trace = SV_ClipMove(start, mins, maxs, end, type, passedict, &clip);
+    sv_inspeculation = false;
+    spec->backups = sv_backups;
+
+    VectorCopy (clip.boxmins, spec->boxmins);
+    VectorCopy (clip.boxmaxs, spec->boxmaxs);
+    spec->frame = sv_specframe;
+}
+
+/*
+==================
+SV_MoveBatch
+
+Traces several moves of the same size and type with a single walk of the
+area nodes.  Each trace comes out exactly as SV_Move would return it.
+==================
+*/
+void SV_MoveBatch(int count, vec3_t *start, vec3_t mins, vec3_t maxs, vec3_t *end, int type, edict_t *passedict,
+                  trace_t *traces) {
+    moveclip_t clip;
+    cachedtrace_t *slots[MOVE_BATCH];
+    tracekey_t keys[MOVE_BATCH];
+    qboolean pending[MOVE_BATCH];
+    edict_t *links[MAX_EDICTS];
+    vec3_t boxmins, boxmaxs;
+    int i, j, numlinks, misses;
+
+    if(count > MOVE_BATCH) {
+        Sys_Error("SV_MoveBatch: %i moves", count);
+    }
+
+    SV_InitMoveClip(&clip, mins, maxs, type, passedict);
+
+// take what the cache already has, and bound the rest
+    misses = 0;
+    for(i = 0; i < count; i++) {
+        slots[i] = NULL;
+        if(sv_tracecache.value) {
+            SV_TraceKey(start[i], mins, maxs, end[i], type, passedict, &keys[i]);
+            slots[i] = SV_TraceSlot(&keys[i]);
+            if(SV_TraceCached(slots[i], &keys[i])) {
+                sv_areastats.cachedmoves++;
+                traces[i] = slots[i]->trace;
+                pending[i] = false;
+                continue;
+            }
+        }
+        pending[i] = true;
+
+        SV_MoveBounds(start[i], clip.mins2, clip.maxs2, end[i], boxmins, boxmaxs);
+        for(j = 0; j < 3; j++) {
+            if(!misses || boxmins[j] < clip.boxmins[j]) {
+                clip.boxmins[j] = boxmins[j];
+            }
+            if(!misses || boxmaxs[j] > clip.boxmaxs[j]) {
+                clip.boxmaxs[j] = boxmaxs[j];
+            }
+        }
+        misses++;
+    }
+
+    if(!misses) {
+        return;
+    }
+
+    numlinks = SV_GatherLinks(sv_areanodes, &clip, links, 0);
+
+    for(i = 0; i < count; i++) {
+        if(!pending[i]) {
+            continue;
+        }
+
+        clip.trace = SV_ClipMoveToEntity(sv.edicts, start[i], mins, maxs, end[i]);
+        clip.start = start[i];
+        clip.end = end[i];
+        SV_MoveBounds(start[i], clip.mins2, clip.maxs2, end[i], clip.boxmins, clip.boxmaxs);
+
+        for(j = 0; j < numlinks; j++) {
+            if(!SV_ClipToEdict(links[j], &clip)) {
+                break;
+            }
+        }
+
+        traces[i] = clip.trace;
+        if(slots[i]) {
+            slots[i]->generation = sv_tracegen;
+            slots[i]->key = keys[i];
+            slots[i]->trace = clip.trace;
+        }
+    }
+
+    SV_CountMove(&clip, misses);
+}
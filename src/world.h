@@ -41,9 +41,19 @@ typedef struct {
 #define    MOVE_NOMONSTERS    1
 #define    MOVE_MISSILE    2
 
+#define MOVE_BATCH      8    // most moves SV_MoveBatch takes at once
+
+extern cvar_t sv_areasplit;
+extern cvar_t sv_tracecache;
+
 void SV_ClearWorld(void);
 // called after the world model has been loaded, before linking any entities
 
+void SV_SplitAreaNodes(void);
+// divides crowded area leafs, called before each server frame
+
+void SV_AreaStats_f(void);
+
 void SV_UnlinkEdict(edict_t *ent);
 // call before removing an entity, and before trying to move one,
 // so it doesn't clip against itself
@@ -55,8 +65,30 @@ void SV_LinkEdict(edict_t *ent, qboolean touch_triggers);
 // sets ent->v.absmin and ent->v.absmax
 // if touchtriggers, calls prog functions for the intersected triggers
 
+void SV_MarkLoose(edict_t *ent);
+// call when origin, mins, maxs, solid or the abs box may have changed without a relink,
+// so SV_FindRadius still finds the entity
+
+void SV_InvalidateTraces(void);
+// forgets every cached move, done at the start of every frame
+
+void SV_EdictChanged(edict_t *ent);
+// call when something about ent that moves clip against changes without a
+// relink, such as a field store that isn't caught by SV_MarkLoose.
+// SV_LinkEdict, SV_UnlinkEdict and SV_MarkLoose already do this.
+
+void SV_FindRadius(vec3_t org, float rad, unsigned int *hits);
+// sets a bit per entity number for every entity findradius has to test
+
+void SV_PVSEdicts(byte *pvs, unsigned int *hits);
+// sets a bit per entity number for every entity touching a leaf in pvs
+
 int SV_PointContents(vec3_t p);
 qboolean SV_RecursiveHullCheck(hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace);
+qboolean SV_HullCheck(hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace);
+// the same trace without recursion, over hull->nodes
+
+void SV_HullBench_f(void);
 
 int SV_TruePointContents(vec3_t p);
 // returns the CONTENTS_* value from the world at the given point.
@@ -78,4 +110,20 @@ trace_t SV_Move(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, ed
 
 // passedict is explicitly excluded from clipping checks (normally NULL)
 
+// moves are kept until SV_InvalidateTraces, so repeating one in the same
+// frame is cheap
+
+void SV_StartSpeculation(int count);
+void SV_SpeculateMove(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict);
+void SV_EndSpeculation(void);
+// SV_SpeculateMove traces a move that passedict is expected to make later in
+// the frame, and may be called from the worker pool between the other two.
+// SV_Move hands the result back if no solid edict has changed inside the
+// area of the move since.
+
+void SV_MoveBatch(int count, vec3_t *start, vec3_t mins, vec3_t maxs, vec3_t *end, int type, edict_t *passedict,
+                  trace_t *traces);
+// count moves of the same size, type and passedict, up to MOVE_BATCH, with
+// one walk of the area nodes
+
 #endif // !WORLD_H
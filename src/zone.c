@@ -43,6 +43,103 @@ typedef struct {
 void Cache_FreeLow(int new_low_hunk);
 void Cache_FreeHigh(int new_high_hunk);
 
+/*
+==============================================================================
+
+						ALLOCATOR STATISTICS
+
+Running totals for each allocator, plus per-name totals for named hunk and
+cache allocations.  "live" and "peak" are bytes including headers; "bytes"
+is the sum of requested sizes.  The frame counters are reset by
+Memory_Frame after it writes the optional CSV line.
+==============================================================================
+*/
+
+typedef struct {
+    int calls;
+    int frees;
+    long long bytes;
+    int live;
+    int peak;
+    int evictions;        // cache only
+    int moves;            // cache only, Cache_Move and compaction
+    double movetime;      // seconds spent moving cache blocks
+    int framecalls;
+    int framefrees;
+    int framemoves;
+    double framemovetime;
+} memstat_t;
+
+#define MEMSTAT_NAMES   256    // must be a power of two
+
+typedef struct {
+    char name[17];        // "h:" or "c:" prefixed
+    int calls;
+    long long bytes;
+} memname_t;
+
+static memstat_t memstat_hunk, memstat_cache, memstat_zone;
+static memname_t memstat_names[MEMSTAT_NAMES];
+static int memstat_numnames;
+static FILE *memstat_csv;
+
+static void Memory_Live(memstat_t *st, int delta) {
+    st->live += delta;
+    if(st->live > st->peak) {
+        st->peak = st->live;
+    }
+}
+
+static void Memory_Count(memstat_t *st, int size) {
+    st->calls++;
+    st->framecalls++;
+    st->bytes += size;
+}
+
+/*
+========================
+Memory_TallyName
+
+Adds an allocation to the per-name totals; once the table is full further
+names are lumped together under the last slot.
+========================
+*/
+static void Memory_TallyName(char kind, char *name, int namelen, int size) {
+    char key[17];
+    int i, n;
+    memname_t *mn;
+
+    key[0] = kind;
+    key[1] = ':';
+    for(n = 0; n < namelen && n < (int)sizeof(key) - 3 && name[n]; n++) {
+        key[n + 2] = name[n];
+    }
+    key[n + 2] = 0;
+
+    // one slot always stays empty so the probe terminates
+    i = COM_HashString(key) & (MEMSTAT_NAMES - 1);
+    while(1) {
+        mn = &memstat_names[i];
+        if(!strcmp(mn->name, key)) {
+            break;
+        }
+        if(!mn->name[0]) {
+            if(memstat_numnames >= MEMSTAT_NAMES - 2 && strcmp(key, "?:other")) {
+                strcpy(key, "?:other");
+                i = COM_HashString(key) & (MEMSTAT_NAMES - 1);
+                continue;
+            }
+            strcpy(mn->name, key);
+            memstat_numnames++;
+            break;
+        }
+        i = (i + 1) & (MEMSTAT_NAMES - 1);
+    }
+
+    mn->calls++;
+    mn->bytes += size;
+}
+
 /*
 ==============================================================================
 
@@ -61,6 +158,216 @@ all big things are allocated on the hunk.
 memzone_t *mainzone;
 
 void Z_ClearZone(memzone_t *zone, int size);
+static void *Z_ZoneAlloc(int size, int tag);
+static void Z_ZoneFree(memblock_t *block);
+
+/*
+==============================================================================
+
+						SMALL BLOCK CLASSES
+
+Requests up to SLAB_MAXSIZE bytes are rounded up to one of a few size
+classes and served from pages that are themselves ordinary zone blocks, so
+the rover list only ever sees page sized allocations.  Each chunk carries a
+memblock_t header with SLABID instead of ZONEID, and its prev pointer aims
+at the owning page, which lets Z_Free tell the two apart in O(1).
+
+A page with free chunks sits on its class's list; a full page is unlinked
+until something in it is freed.  One empty page per class is kept around
+to stop alloc/free pairs from thrashing the zone.
+==============================================================================
+*/
+
+#define SLABID          0x51ab1d
+#define SLAB_PAGETAG    0x51ab     // zone tag for pages
+#define SLAB_PAGESIZE   8192
+#define SLAB_MAXSIZE    256
+#define SLAB_CLASSES    8
+
+typedef struct zslab_s {
+    int sclass;
+    int used;            // chunks handed out
+    int count;           // chunks in the page
+    int pad;
+    memblock_t *free;    // free chunks, linked through next
+    struct zslab_s *next, *prev;    // pages of this class with free chunks
+} zslab_t;
+
+typedef struct {
+    int size;            // largest request served
+    int chunksize;       // including header and trash marker
+    zslab_t *pages;      // pages with free chunks
+    int numpages;
+    int used;
+    int peak;
+    int allocs;
+} zslabclass_t;
+
+static zslabclass_t zslabclasses[SLAB_CLASSES] = {
+    { 16 }, { 32 }, { 48 }, { 64 }, { 96 }, { 128 }, { 192 }, { 256 }
+};
+static byte zslabindex[SLAB_MAXSIZE / 16 + 1];  // (size + 15) / 16 -> class
+
+/*
+========================
+Z_InitSlabs
+========================
+*/
+static void Z_InitSlabs(void) {
+    int i, c;
+    zslabclass_t *sc;
+
+    for(i = 0; i < SLAB_CLASSES; i++) {
+        sc = &zslabclasses[i];
+        sc->chunksize = (sc->size + sizeof(memblock_t) + 4 + 7) & ~7;
+        sc->pages = NULL;
+        sc->numpages = sc->used = sc->peak = sc->allocs = 0;
+    }
+
+    for(i = 0, c = 0; i <= SLAB_MAXSIZE / 16; i++) {
+        while(zslabclasses[c].size < i * 16) {
+            c++;
+        }
+        zslabindex[i] = c;
+    }
+}
+
+static void Z_SlabLink(zslabclass_t *sc, zslab_t *page) {
+    page->prev = NULL;
+    page->next = sc->pages;
+    if(sc->pages) {
+        sc->pages->prev = page;
+    }
+    sc->pages = page;
+}
+
+static void Z_SlabUnlink(zslabclass_t *sc, zslab_t *page) {
+    if(page->prev) {
+        page->prev->next = page->next;
+    } else {
+        sc->pages = page->next;
+    }
+    if(page->next) {
+        page->next->prev = page->prev;
+    }
+    page->next = page->prev = NULL;
+}
+
+/*
+========================
+Z_SlabNewPage
+========================
+*/
+static zslab_t *Z_SlabNewPage(int sclass) {
+    zslabclass_t *sc = &zslabclasses[sclass];
+    zslab_t *page;
+    memblock_t *chunk;
+    byte *data;
+    int i;
+
+    page = Z_ZoneAlloc(SLAB_PAGESIZE, SLAB_PAGETAG);
+    if(!page) {
+        return NULL;
+    }
+
+    data = (byte *)page + ((sizeof(zslab_t) + 7) & ~7);
+    page->sclass = sclass;
+    page->used = 0;
+    page->count = (SLAB_PAGESIZE - (data - (byte *)page)) / sc->chunksize;
+    page->free = NULL;
+
+    for(i = page->count - 1; i >= 0; i--) {
+        chunk = (memblock_t *)(data + i * sc->chunksize);
+        chunk->size = sc->chunksize;
+        chunk->tag = 0;
+        chunk->id = SLABID;
+        chunk->prev = (memblock_t *)page;
+        chunk->next = page->free;
+        page->free = chunk;
+    }
+
+    Z_SlabLink(sc, page);
+    sc->numpages++;
+
+    return page;
+}
+
+/*
+========================
+Z_SlabAlloc
+========================
+*/
+static void *Z_SlabAlloc(int size, int tag) {
+    zslabclass_t *sc;
+    zslab_t *page;
+    memblock_t *chunk;
+    int sclass;
+
+    sclass = zslabindex[(size + 15) >> 4];
+    sc = &zslabclasses[sclass];
+
+    page = sc->pages;
+    if(!page) {
+        page = Z_SlabNewPage(sclass);
+        if(!page) {
+            return NULL;
+        }
+    }
+
+    chunk = page->free;
+    page->free = chunk->next;
+    chunk->next = NULL;
+    chunk->tag = tag;
+    if(++page->used == page->count) {
+        Z_SlabUnlink(sc, page);
+    }
+
+    sc->allocs++;
+    if(++sc->used > sc->peak) {
+        sc->peak = sc->used;
+    }
+
+// marker for memory trash testing
+    *(int *)((byte *)chunk + chunk->size - 4) = SLABID;
+
+    return (void *)((byte *)chunk + sizeof(memblock_t));
+}
+
+/*
+========================
+Z_SlabFree
+========================
+*/
+static void Z_SlabFree(memblock_t *chunk) {
+    zslabclass_t *sc;
+    zslab_t *page;
+
+    page = (zslab_t *)chunk->prev;
+    if(page->sclass < 0 || page->sclass >= SLAB_CLASSES) {
+        Sys_Error("Z_Free: bad slab page");
+    }
+    sc = &zslabclasses[page->sclass];
+
+    if(*(int *)((byte *)chunk + chunk->size - 4) != SLABID) {
+        Sys_Error("Z_Free: trashed slab chunk");
+    }
+
+    chunk->tag = 0;
+    chunk->next = page->free;
+    page->free = chunk;
+    sc->used--;
+
+    if(page->used-- == page->count) {
+        Z_SlabLink(sc, page);        // was full
+    }
+
+    // give the page back if the class has another one to fall back on
+    if(!page->used && (page->next || page->prev)) {
+        Z_SlabUnlink(sc, page);
+        sc->numpages--;
+        Z_ZoneFree((memblock_t *)page - 1);    // pages aren't counted as zone use
+    }
+}
 
 /*
 ========================
@@ -78,6 +385,8 @@ void Z_ClearZone(memzone_t *zone, int size) {
     zone->blocklist.size = 0;
     zone->rover = block;
 
+    Z_InitSlabs();
+
     block->prev = block->next = &zone->blocklist;
     block->tag = 0;            // free block
     block->id = ZONEID;
@@ -90,13 +399,39 @@ Z_Free
 ========================
 */
 void Z_Free(void *ptr) {
-    memblock_t *block, *other;
+    memblock_t *block;
 
     if(!ptr) {
         Sys_Error("Z_Free: NULL pointer");
     }
 
     block = (memblock_t *)((byte *)ptr - sizeof(memblock_t));
+    if((block->id == SLABID || block->id == ZONEID) && block->tag) {
+        memstat_zone.frees++;
+        memstat_zone.framefrees++;
+        Memory_Live(&memstat_zone, -block->size);
+    }
+    if(block->id == SLABID) {
+        if(block->tag == 0) {
+            Sys_Error("Z_Free: freed a freed pointer");
+        }
+        Z_SlabFree(block);
+        return;
+    }
+
+    Z_ZoneFree(block);
+}
+
+/*
+========================
+Z_ZoneFree
+
+Returns a block to the rover list, without the stats Z_Free keeps
+========================
+*/
+static void Z_ZoneFree(memblock_t *block) {
+    memblock_t *other;
+
     if(block->id != ZONEID) {
         Sys_Error("Z_Free: freed a pointer without ZONEID");
     }
@@ -136,7 +471,9 @@ Z_Malloc
 void *Z_Malloc(int size) {
     void *buf;
 
-    Z_CheckHeap();    // DEBUG
+    if(size > SLAB_MAXSIZE) {
+        Z_CheckHeap();    // DEBUG
+    }
     buf = Z_TagMalloc(size, 1);
     if(!buf) {
         Sys_Error("Z_Malloc: failed on allocation of %i bytes", size);
@@ -147,13 +484,39 @@ void *Z_Malloc(int size) {
 }
 
 void *Z_TagMalloc(int size, int tag) {
-    int extra;
-    memblock_t *start, *rover, *new, *base;
+    void *buf;
 
     if(!tag) {
         Sys_Error("Z_TagMalloc: tried to use a 0 tag");
     }
 
+    buf = NULL;
+    if(size >= 0 && size <= SLAB_MAXSIZE) {
+        buf = Z_SlabAlloc(size, tag);
+    }
+    if(!buf) {
+        buf = Z_ZoneAlloc(size, tag);
+    }
+
+    if(buf) {
+        Memory_Count(&memstat_zone, size);
+        Memory_Live(&memstat_zone, ((memblock_t *)buf - 1)->size);
+    }
+
+    return buf;
+}
+
+/*
+========================
+Z_ZoneAlloc
+
+First fit search of the rover list
+========================
+*/
+static void *Z_ZoneAlloc(int size, int tag) {
+    int extra;
+    memblock_t *start, *rover, *new, *base;
+
 //
 // scan through the block list looking for the first free block
 // of sufficient size
@@ -211,6 +574,8 @@ Z_Print
 */
 void Z_Print(memzone_t *zone) {
     memblock_t *block;
+    zslabclass_t *sc;
+    int i;
 
     Con_Printf("zone size: %i  location: %p\n", mainzone->size, mainzone);
 
@@ -227,6 +592,37 @@ void Z_Print(memzone_t *zone) {
         if(!block->tag && !block->next->tag)
             Con_Printf("ERROR: two consecutive free blocks\n");
     }
+
+    Con_Printf("class  pages   used   peak     allocs\n");
+    for(i = 0; i < SLAB_CLASSES; i++) {
+        sc = &zslabclasses[i];
+        Con_Printf("%5i %6i %6i %6i %10i\n", sc->size, sc->numpages, sc->used, sc->peak, sc->allocs);
+    }
+}
+
+/*
+========================
+Z_CheckSlab
+========================
+*/
+static void Z_CheckSlab(zslab_t *page) {
+    memblock_t *chunk;
+    int numfree;
+
+    if(page->sclass < 0 || page->sclass >= SLAB_CLASSES)
+        Sys_Error("Z_CheckHeap: bad slab class\n");
+    if(page->used < 0 || page->used > page->count)
+        Sys_Error("Z_CheckHeap: bad slab use count\n");
+
+    numfree = 0;
+    for(chunk = page->free; chunk; chunk = chunk->next) {
+        if(chunk->id != SLABID || chunk->tag || chunk->prev != (memblock_t *)page)
+            Sys_Error("Z_CheckHeap: bad free slab chunk\n");
+        if(++numfree > page->count)
+            break;
+    }
+    if(numfree != page->count - page->used)
+        Sys_Error("Z_CheckHeap: slab free list doesn't match use count\n");
 }
 
 /*
@@ -247,6 +643,8 @@ void Z_CheckHeap(void) {
             Sys_Error("Z_CheckHeap: next block doesn't have proper back link\n");
         if(!block->tag && !block->next->tag)
             Sys_Error("Z_CheckHeap: two consecutive free blocks\n");
+        if(block->tag == SLAB_PAGETAG)
+            Z_CheckSlab((zslab_t *)(block + 1));
     }
 }
 
@@ -260,12 +658,37 @@ typedef struct {
     char name[8];
 } hunk_t;
 
+#define HUNK_ARENA_SIZE  (16 * 1024 * 1024)  // minimum growth step
+#define HUNK_CACHE_RESERVE  (8 * 1024 * 1024)    // at most a quarter of the primary block
+
+/*
+When the block handed to Memory_Init runs out, further low or high hunk
+allocations spill into arenas allocated on demand.  Each arena remembers
+the mark it starts at, so marks stay a single increasing number across the
+chain and freeing to a mark releases whole arenas above it.  The cache only
+ever lives in the primary block, so while arenas are allowed the hunk spills
+early enough to leave hunk_cachereserve of it for the cache.
+*/
+typedef struct hunkarena_s {
+    byte *base;        // 16 byte aligned
+    int size;
+    int used;
+    int mark;          // hunk mark at the bottom of this arena
+    void *alloc;       // pointer to free
+    struct hunkarena_s *prev;
+} hunkarena_t;
+
 byte *hunk_base;
 int hunk_size;
 
 int hunk_low_used;
 int hunk_high_used;
 
+hunkarena_t *hunk_lowarena;     // most recent spill arena, NULL if none
+hunkarena_t *hunk_higharena;
+qboolean hunk_grow;
+int hunk_cachereserve;          // primary block kept free for the cache
+
 qboolean hunk_tempactive;
 int hunk_tempmark;
 
@@ -278,20 +701,136 @@ Hunk_Check
 Run consistancy and sentinal trahing checks
 ==============
 */
-void Hunk_Check(void) {
+static void Hunk_CheckRange(byte *base, int used, int size) {
     hunk_t *h;
 
-    for(h = (hunk_t *)hunk_base; (byte *)h != hunk_base + hunk_low_used;) {
+    for(h = (hunk_t *)base; (byte *)h != base + used;) {
         if(h->sentinal != HUNK_SENTINAL) {
             Sys_Error("Hunk_Check: trahsed sentinal");
         }
-        if(h->size < 16 || h->size + (byte *)h - hunk_base > hunk_size) {
+        if(h->size < 16 || h->size + (byte *)h - base > size) {
             Sys_Error("Hunk_Check: bad size");
         }
         h = (hunk_t *)((byte *)h + h->size);
     }
 }
 
+void Hunk_Check(void) {
+    hunkarena_t *a;
+
+    Hunk_CheckRange(hunk_base, hunk_low_used, hunk_size);
+    for(a = hunk_lowarena; a; a = a->prev) {
+        Hunk_CheckRange(a->base, a->used, a->size);
+    }
+    for(a = hunk_higharena; a; a = a->prev) {
+        Hunk_CheckRange(a->base + a->size - a->used, a->used, a->size);
+    }
+}
+
+/*
+==============
+Hunk_NewArena
+
+Chains a fresh arena big enough for size bytes onto the given list
+==============
+*/
+static hunkarena_t *Hunk_NewArena(hunkarena_t **list, int size, int mark) {
+    hunkarena_t *a;
+    int arenasize;
+
+    arenasize = size > HUNK_ARENA_SIZE ? size : HUNK_ARENA_SIZE;
+
+    a = malloc(sizeof(*a));
+    if(!a) {
+        return NULL;
+    }
+    a->alloc = malloc(arenasize + 15);
+    if(!a->alloc) {
+        free(a);
+        return NULL;
+    }
+    a->base = (byte *)(((uintptr_t)a->alloc + 15) & ~(uintptr_t)15);
+    a->size = arenasize;
+    a->used = 0;
+    a->mark = mark;
+    a->prev = *list;
+    *list = a;
+
+    Con_DPrintf("Hunk: added %i byte arena at mark %i\n", arenasize, mark);
+    return a;
+}
+
+/*
+==============
+Hunk_FreeArenas
+
+Releases every arena on the list that lies entirely above mark, and returns
+the arena containing mark, or NULL if it falls inside the primary block
+==============
+*/
+static hunkarena_t *Hunk_FreeArenas(hunkarena_t **list, int mark) {
+    hunkarena_t *a;
+
+    while(*list && mark <= (*list)->mark) {
+        a = *list;
+        *list = a->prev;
+        free(a->alloc);
+        free(a);
+    }
+
+    return *list;
+}
+
+/*
+==============
+Hunk_ArenaAlloc
+
+Returns size bytes from the top arena on the list, chaining a new one if
+needed.  High arenas are filled downwards like the primary high hunk.
+==============
+*/
+static hunk_t *Hunk_ArenaAlloc(hunkarena_t **list, int size, int mark, qboolean high) {
+    hunkarena_t *a;
+
+    a = *list;
+    if(!a || a->size - a->used < size) {
+        if(a) {
+            mark = a->mark + a->used;
+        }
+        a = Hunk_NewArena(list, size, mark);
+        if(!a) {
+            return NULL;
+        }
+    }
+
+    a->used += size;
+    if(high) {
+        return (hunk_t *)(a->base + a->size - a->used);
+    }
+    return (hunk_t *)(a->base + a->used - size);
+}
+
+/*
+==============
+Hunk_Spills
+
+True if size more bytes have to come from the arenas on the list
+==============
+*/
+static qboolean Hunk_Spills(hunkarena_t *list, int size) {
+    int left;
+
+    if(list) {
+        return true;        // keep the marks ordered
+    }
+
+    left = hunk_size - hunk_low_used - hunk_high_used - size;
+    if(hunk_grow) {
+        return left < hunk_cachereserve;
+    }
+    return left < 0;
+}
+
 /*
 ==============
 Hunk_Print
@@ -302,6 +841,7 @@ Otherwise, allocations with the same name will be totaled up before printing.
 */
 void Hunk_Print(qboolean all) {
     hunk_t *h, *next, *endlow, *starthigh, *endhigh;
+    hunkarena_t *a;
     int sum;
     int totalblocks;
     char name[9];
@@ -371,10 +911,19 @@ void Hunk_Print(qboolean all) {
         h = next;
     }
 
+    for(a = hunk_lowarena; a; a = a->prev) {
+        Con_Printf("          :%8i low arena (%i used)\n", a->size, a->used);
+    }
+    for(a = hunk_higharena; a; a = a->prev) {
+        Con_Printf("          :%8i high arena (%i used)\n", a->size, a->used);
+    }
+
     Con_Printf("-------------------------\n");
     Con_Printf("%8i total blocks\n", totalblocks);
 }
 
+static void Hunk_UpdateStats(void);
+
 /*
 ===================
 Hunk_AllocName
@@ -393,14 +942,24 @@ void *Hunk_AllocName(int size, char *name) {
 
     size = sizeof(hunk_t) + ((size + 15) & ~15);
 
-    if(hunk_size - hunk_low_used - hunk_high_used < size) {
-        Sys_Error("Hunk_Alloc: failed on %i bytes", size);
-    }
+    if(Hunk_Spills(hunk_lowarena, size)) {
+        h = NULL;
+        if(hunk_grow) {
+            h = Hunk_ArenaAlloc(&hunk_lowarena, size, hunk_low_used, false);
+        }
+        if(!h) {
+            Sys_Error("Hunk_Alloc: failed on %i bytes", size);
+        }
+    } else {
+        h = (hunk_t *)(hunk_base + hunk_low_used);
+        hunk_low_used += size;
 
-    h = (hunk_t *)(hunk_base + hunk_low_used);
-    hunk_low_used += size;
+        Cache_FreeLow(hunk_low_used);
+    }
 
-    Cache_FreeLow(hunk_low_used);
+    Memory_Count(&memstat_hunk, size);
+    Memory_TallyName('h', name, 8, size);
+    Hunk_UpdateStats();
 
     memset (h, 0, size);
 
@@ -420,16 +979,97 @@ void *Hunk_Alloc(int size) {
     return Hunk_AllocName(size, "unknown");
 }
 
+/*
+===================
+Hunk_UpdateStats
+
+Hunk memory is only released by resetting marks, so live usage is simply
+both marks added together
+===================
+*/
+static void Hunk_UpdateStats(void) {
+    int low, high;
+
+    low = hunk_lowarena ? hunk_lowarena->mark + hunk_lowarena->used : hunk_low_used;
+    high = hunk_higharena ? hunk_higharena->mark + hunk_higharena->used : hunk_high_used;
+    Memory_Live(&memstat_hunk, low + high - memstat_hunk.live);
+}
+
+/*
+===================
+Hunk_LowMark
+
+The mark counts bytes across the primary block and every arena, so once the
+hunk has spilled, mark arithmetic only describes memory that is in one piece
+if Hunk_LowContiguous says so
+===================
+*/
 int Hunk_LowMark(void) {
+    if(hunk_lowarena) {
+        return hunk_lowarena->mark + hunk_lowarena->used;
+    }
     return hunk_low_used;
 }
 
+/*
+===================
+Hunk_LowContiguous
+
+True if everything allocated since mark is in a single block, so that it can
+be addressed from its first allocation or copied out in one piece
+===================
+*/
+qboolean Hunk_LowContiguous(int mark) {
+    if(!hunk_lowarena) {
+        return true;        // all in the primary block
+    }
+    return mark >= hunk_lowarena->mark;
+}
+
+/*
+===================
+Hunk_LowReserve
+
+Makes sure the next size bytes of low hunk, counting allocation headers, come
+from a single block, chaining an arena that can hold all of it if needed
+===================
+*/
+void Hunk_LowReserve(int size) {
+    if(!hunk_grow) {
+        return;             // never spills
+    }
+
+    if(hunk_lowarena) {
+        if(hunk_lowarena->size - hunk_lowarena->used >= size) {
+            return;
+        }
+    } else if(!Hunk_Spills(NULL, size)) {
+        return;
+    }
+
+    if(!Hunk_NewArena(&hunk_lowarena, size, Hunk_LowMark())) {
+        Sys_Error("Hunk_LowReserve: failed on %i bytes", size);
+    }
+}
+
 void Hunk_FreeToLowMark(int mark) {
-    if(mark < 0 || mark > hunk_low_used) {
+    hunkarena_t *a;
+
+    if(mark < 0 || mark > Hunk_LowMark()) {
         Sys_Error("Hunk_FreeToLowMark: bad mark %i", mark);
     }
+
+    a = Hunk_FreeArenas(&hunk_lowarena, mark);
+    if(a) {
+        memset (a->base + mark - a->mark, 0, a->used - (mark - a->mark));
+        a->used = mark - a->mark;
+        Hunk_UpdateStats();
+        return;
+    }
+
     memset (hunk_base + mark, 0, hunk_low_used - mark);
     hunk_low_used = mark;
+    Hunk_UpdateStats();
 }
 
 int Hunk_HighMark(void) {
@@ -438,19 +1078,36 @@ int Hunk_HighMark(void) {
         Hunk_FreeToHighMark(hunk_tempmark);
     }
 
+    if(hunk_higharena) {
+        return hunk_higharena->mark + hunk_higharena->used;
+    }
     return hunk_high_used;
 }
 
 void Hunk_FreeToHighMark(int mark) {
+    hunkarena_t *a;
+    int used;
+
     if(hunk_tempactive) {
         hunk_tempactive = false;
         Hunk_FreeToHighMark(hunk_tempmark);
     }
-    if(mark < 0 || mark > hunk_high_used) {
+    if(mark < 0 || mark > Hunk_HighMark()) {
         Sys_Error("Hunk_FreeToHighMark: bad mark %i", mark);
     }
+
+    a = Hunk_FreeArenas(&hunk_higharena, mark);
+    if(a) {
+        used = mark - a->mark;
+        memset (a->base + a->size - a->used, 0, a->used - used);
+        a->used = used;
+        Hunk_UpdateStats();
+        return;
+    }
+
     memset (hunk_base + hunk_size - hunk_high_used, 0, hunk_high_used - mark);
     hunk_high_used = mark;
+    Hunk_UpdateStats();
 }
 
 /*
@@ -476,15 +1133,25 @@ void *Hunk_HighAllocName(int size, char *name) {
 
     size = sizeof(hunk_t) + ((size + 15) & ~15);
 
-    if(hunk_size - hunk_low_used - hunk_high_used < size) {
-        Con_Printf("Hunk_HighAlloc: failed on %i bytes\n", size);
-        return NULL;
-    }
+    if(Hunk_Spills(hunk_higharena, size)) {
+        h = NULL;
+        if(hunk_grow) {
+            h = Hunk_ArenaAlloc(&hunk_higharena, size, hunk_high_used, true);
+        }
+        if(!h) {
+            Con_Printf("Hunk_HighAlloc: failed on %i bytes\n", size);
+            return NULL;
+        }
+    } else {
+        hunk_high_used += size;
+        Cache_FreeHigh(hunk_high_used);
 
-    hunk_high_used += size;
-    Cache_FreeHigh(hunk_high_used);
+        h = (hunk_t *)(hunk_base + hunk_size - hunk_high_used);
+    }
 
-    h = (hunk_t *)(hunk_base + hunk_size - hunk_high_used);
+    Memory_Count(&memstat_hunk, size);
+    Memory_TallyName('h', name, 8, size);
+    Hunk_UpdateStats();
 
     memset (h, 0, size);
     h->size = size;
@@ -540,6 +1207,20 @@ cache_system_t *Cache_TryAlloc(int size, qboolean nobottom);
 
 cache_system_t cache_head;
 
+cvar_t cache_compact = { "cache_compact", "262144" };    // bytes moved per frame
+
+#define CACHE_VICTIMSCAN    32    // LRU entries considered by Cache_Alloc
+
+static void Cache_CountMove(double start) {
+    double t;
+
+    t = Sys_FloatTime() - start;
+    memstat_cache.moves++;
+    memstat_cache.framemoves++;
+    memstat_cache.movetime += t;
+    memstat_cache.framemovetime += t;
+}
+
 /*
 ===========
 Cache_Move
@@ -547,6 +1228,9 @@ Cache_Move
 */
 void Cache_Move(cache_system_t *c) {
     cache_system_t *new;
+    double start;
+
+    start = Sys_FloatTime();
 
 // we are clearing up space at the bottom, so only allocate it late
     new = Cache_TryAlloc(c->size, true);
@@ -563,6 +1247,8 @@ void Cache_Move(cache_system_t *c) {
 
         Cache_Free(c->user);        // tough luck...
     }
+
+    Cache_CountMove(start);
 }
 
 /*
@@ -661,6 +1347,7 @@ cache_system_t *Cache_TryAlloc(int size, qboolean nobottom) {
         new->prev = new->next = &cache_head;
 
         Cache_MakeLRU(new);
+        Memory_Live(&memstat_cache, size);
         return new;
     }
 
@@ -681,6 +1368,7 @@ cache_system_t *Cache_TryAlloc(int size, qboolean nobottom) {
                 cs->prev = new;
 
                 Cache_MakeLRU(new);
+                Memory_Live(&memstat_cache, size);
 
                 return new;
             }
@@ -702,6 +1390,7 @@ cache_system_t *Cache_TryAlloc(int size, qboolean nobottom) {
         cache_head.prev = new;
 
         Cache_MakeLRU(new);
+        Memory_Live(&memstat_cache, size);
 
         return new;
     }
@@ -750,9 +1439,58 @@ void Cache_Report(void) {
 ============
 Cache_Compact
 
+============
+*/
+static cache_system_t *Cache_Slide(cache_system_t *c, byte *dest) {
+    cache_system_t *new;
+
+    new = (cache_system_t *)dest;
+    memmove (new, c, c->size);
+
+    new->prev->next = new;
+    new->next->prev = new;
+    new->lru_prev->lru_next = new;
+    new->lru_next->lru_prev = new;
+    new->user->data = (void *)(new + 1);
+
+    return new;
+}
+
+/*
+============
+Cache_Compact
+
+Slides cache blocks down over the gaps left by freed entries, so free
+space collects above the cache instead of being scattered between blocks.
+At most cache_compact bytes are moved per call (a larger block still moves
+if it is the first one), so the work is spread over several frames.
 ============
 */
 void Cache_Compact(void) {
+    cache_system_t *c;
+    byte *low;
+    int moved, budget;
+    double start;
+
+    budget = (int)cache_compact.value;
+    if(budget <= 0) {
+        return;
+    }
+
+    moved = 0;
+    low = hunk_base + hunk_low_used;
+    for(c = cache_head.next; c != &cache_head; c = c->next) {
+        if((byte *)c != low) {
+            if(moved && moved + c->size > budget) {
+                break;
+            }
+            start = Sys_FloatTime();
+            c = Cache_Slide(c, low);
+            Cache_CountMove(start);
+            moved += c->size;
+        }
+        low = (byte *)c + c->size;
+    }
 }
 
 /*
@@ -784,6 +1522,10 @@ void Cache_Free(cache_user_t *c) {
 
     cs = ((cache_system_t *)c->data) - 1;
 
+    memstat_cache.frees++;
+    memstat_cache.framefrees++;
+    Memory_Live(&memstat_cache, -cs->size);
+
     cs->prev->next = cs->next;
     cs->next->prev = cs->prev;
     cs->next = cs->prev = NULL;
@@ -814,6 +1556,41 @@ void *Cache_Check(cache_user_t *c) {
     return c->data;
 }
 
+/*
+==============
+Cache_Victim
+
+Picks the entry to throw out when an allocation of size bytes doesn't fit.
+Among the oldest entries, the first one whose removal opens a hole big
+enough is preferred over plain LRU order, so one eviction usually does
+instead of a string of them.
+==============
+*/
+static cache_system_t *Cache_Victim(int size) {
+    cache_system_t *cs;
+    byte *start, *end;
+    int i;
+
+    for(cs = cache_head.lru_prev, i = 0; cs != &cache_head && i < CACHE_VICTIMSCAN; cs = cs->lru_prev, i++) {
+        if(cs->prev == &cache_head) {
+            start = hunk_base + hunk_low_used;
+        } else {
+            start = (byte *)cs->prev + cs->prev->size;
+        }
+        if(cs->next == &cache_head) {
+            end = hunk_base + hunk_size - hunk_high_used;
+        } else {
+            end = (byte *)cs->next;
+        }
+
+        if(end - start >= size) {
+            return cs;
+        }
+    }
+
+    return cache_head.lru_prev;
+}
+
 /*
 ==============
 Cache_Alloc
@@ -836,6 +1613,8 @@ void *Cache_Alloc(cache_user_t *c, int size, char *name) {
     while(1) {
         cs = Cache_TryAlloc(size, false);
         if(cs) {
+            Memory_Count(&memstat_cache, size);
+            Memory_TallyName('c', name, sizeof(cs->name) - 1, size);
             strncpy (cs->name, name, sizeof(cs->name) - 1);
             c->data = (void *)(cs + 1);
             cs->user = c;
@@ -847,7 +1626,8 @@ void *Cache_Alloc(cache_user_t *c, int size, char *name) {
             Sys_Error("Cache_Alloc: out of memory");
         }
         // not enough memory at all
-        Cache_Free(cache_head.lru_prev->user);
+        Cache_Free(Cache_Victim(size)->user);
+        memstat_cache.evictions++;
     }
 
     return Cache_Check(c);
@@ -855,6 +1635,93 @@ void *Cache_Alloc(cache_user_t *c, int size, char *name) {
 
 //============================================================================
 
+static void Memory_PrintStat(char *label, memstat_t *st) {
+    Con_Printf("%-6s %9i %9i %11.0f %9i %9i\n", label, st->calls, st->frees, (double)st->bytes, st->live, st->peak);
+}
+
+/*
+========================
+Memory_Stats_f
+
+memstats            print allocator totals
+memstats names      also list per-name hunk and cache totals
+memstats csv <file> append one line per frame to <file> in the game dir
+memstats csv        stop writing csv
+========================
+*/
+void Memory_Stats_f(void) {
+    char name[MAX_OSPATH];
+    memname_t *mn;
+    int i, result;
+
+    if(!Q_strcmp(Cmd_Argv(1), "csv")) {
+        if(memstat_csv) {
+            fclose(memstat_csv);
+            memstat_csv = NULL;
+            Con_Printf("memstats: csv closed\n");
+        }
+        if(Cmd_Argc() < 3) {
+            return;
+        }
+
+        result = snprintf(name, MAX_OSPATH, "%s/%s", com_gamedir, Cmd_Argv(2));
+        if(!CHECK_SAFE_PRINT(result, MAX_OSPATH - 4)) {
+            Con_Printf("memstats: path too long.\n");
+            return;
+        }
+        COM_DefaultExtension(name, ".csv");
+        memstat_csv = fopen(name, "w");
+        if(!memstat_csv) {
+            Con_Printf("memstats: couldn't open %s\n", name);
+            return;
+        }
+        fprintf(memstat_csv, "frame,time,hunk_live,hunk_calls,cache_live,cache_calls,cache_frees,"
+                             "cache_evictions,cache_moves,cache_move_ms,zone_live,zone_calls,zone_frees\n");
+        Con_Printf("memstats: writing %s\n", name);
+        return;
+    }
+
+    Con_Printf("       %9s %9s %11s %9s %9s\n", "calls", "frees", "bytes", "live", "peak");
+    Memory_PrintStat("hunk", &memstat_hunk);
+    Memory_PrintStat("cache", &memstat_cache);
+    Memory_PrintStat("zone", &memstat_zone);
+    Con_Printf("%i cache evictions, %i moves in %.3f ms\n", memstat_cache.evictions, memstat_cache.moves,
+               memstat_cache.movetime * 1000);
+
+    if(!Q_strcmp(Cmd_Argv(1), "names")) {
+        for(i = 0; i < MEMSTAT_NAMES; i++) {
+            mn = &memstat_names[i];
+            if(mn->name[0]) {
+                Con_Printf("%-18s %7i %11.0f\n", mn->name, mn->calls, (double)mn->bytes);
+            }
+        }
+    }
+}
+
+/*
+========================
+Memory_Frame
+
+Runs this frame's share of cache compaction, writes the csv line if
+enabled, and resets the frame counters
+========================
+*/
+void Memory_Frame(void) {
+    Cache_Compact();
+
+    if(memstat_csv) {
+        fprintf(memstat_csv, "%i,%f,%i,%i,%i,%i,%i,%i,%i,%f,%i,%i,%i\n", host_framecount, realtime,
+                memstat_hunk.live, memstat_hunk.framecalls,
+                memstat_cache.live, memstat_cache.framecalls, memstat_cache.framefrees, memstat_cache.evictions,
+                memstat_cache.framemoves, memstat_cache.framemovetime * 1000,
+                memstat_zone.live, memstat_zone.framecalls, memstat_zone.framefrees);
+    }
+
+    memstat_hunk.framecalls = memstat_hunk.framefrees = 0;
+    memstat_cache.framecalls = memstat_cache.framefrees = memstat_cache.framemoves = 0;
+    memstat_cache.framemovetime = 0;
+    memstat_zone.framecalls = memstat_zone.framefrees = 0;
+}
 
 /*
 ========================
@@ -869,6 +1736,8 @@ void Memory_Init(void *buf, int size) {
     hunk_size = size;
     hunk_low_used = 0;
     hunk_high_used = 0;
+    hunk_grow = !COM_CheckParm("-nohunkgrow");
+    hunk_cachereserve = size / 4 < HUNK_CACHE_RESERVE ? size / 4 : HUNK_CACHE_RESERVE;
 
     Cache_Init();
     p = COM_CheckParm("-zone");
@@ -881,5 +1750,8 @@ void Memory_Init(void *buf, int size) {
     }
     mainzone = Hunk_AllocName(zonesize, "zone");
     Z_ClearZone(mainzone, zonesize);
+
+    Cmd_AddCommand("memstats", Memory_Stats_f);
+    Cvar_RegisterVariable(&cache_compact);
 }
 
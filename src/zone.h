@@ -28,7 +28,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 H_??? The hunk manages the entire memory block given to quake.  It must be
 contiguous.  Memory can be allocated from either the low or high end in a
 stack fashion.  The only way memory is released is by resetting one of the
-pointers.
+pointers.  If the block runs out, further allocations spill into arenas
+malloced on demand (disable with -nohunkgrow); marks remain valid across
+them, but the memory between two marks is no longer guaranteed to be in one
+piece.  Code that copies or offsets everything allocated since a mark has to
+check Hunk_LowContiguous, and can Hunk_LowReserve room for a retry.
 
 Hunk allocations should be given a name, so the Hunk_Print () function
 can display usage.
@@ -88,6 +92,7 @@ Zone block
 */
 
 void Memory_Init(void *buf, int size);
+void Memory_Frame(void);        // per frame cache compaction and allocator stats
 
 void Z_Free(void *ptr);
 void *Z_Malloc(int size);            // returns 0 filled memory
@@ -104,6 +109,8 @@ void *Hunk_HighAllocName(int size, char *name);
 
 int Hunk_LowMark(void);
 void Hunk_FreeToLowMark(int mark);
+qboolean Hunk_LowContiguous(int mark);    // everything since mark is in one block
+void Hunk_LowReserve(int size);            // the next size bytes will be in one block
 
 int Hunk_HighMark(void);
 void Hunk_FreeToHighMark(int mark);